@@ -4,6 +4,11 @@ newoption {
 	description = "Build with emscripten"
 }
 
+newoption {
+	trigger = "rt-guard",
+	description = "Count allocations and mutex locks on the audio thread"
+}
+
 local util = dofile("scripts/util.lua")
 local iplug2 = require("thirdparty/iPlug2/lua/iplug2").init()
 
@@ -48,6 +53,14 @@ iplug2.workspace "RetroPlug"
 			"-mmacosx-version-min=10.9"
 		}
 
+	filter "options:rt-guard"
+		defines { "RP_RT_GUARD" }
+
+	-- Makes the plugin's malloc/free and mutex hooks take precedence over the host's
+	filter { "options:rt-guard", "system:linux" }
+		links { "dl" }
+		linkoptions { "-Wl,-Bsymbolic-functions" }
+
 	configuration { "windows" }
 		defines { "RP_WINDOWS" }
 		cppdialect "C++latest"
@@ -277,6 +290,95 @@ if _OPTIONS["emscripten"] == nil then
 			includedirs { "src/compiler" }
 			files { "src/compiler/**.h", "src/compiler/**.c", "src/compiler/**.cpp" }
 			links { "lua" }
+
+		-- Renders projects to audio files without a host or display
+		project "RetroPlugRender"
+			kind "ConsoleApp"
+			dependson { "RetroPlug" }
+
+			defines { "GB_INTERNAL", "GB_DISABLE_TIMEKEEPING" }
+
+			sysincludedirs {
+				"thirdparty",
+				"thirdparty/lua-5.3.5/src",
+				"thirdparty/liblsdj/liblsdj/include/lsdj",
+				"thirdparty/minizip-ng",
+				"thirdparty/spdlog/include",
+				"thirdparty/sol",
+				"thirdparty/SameBoy/Core",
+				"thirdparty/xxhash"
+			}
+
+			includedirs {
+				"config",
+				"src",
+				"src/retroplug"
+			}
+
+			files { "src/render/**.h", "src/render/**.cpp" }
+
+			links {
+				"RetroPlug",
+				"SameBoy",
+				"liblsdj",
+				"lua",
+				"minizip"
+			}
+
+			configuration { "linux" }
+				links { "pthread", "dl" }
+
+			configuration { "macosx" }
+				links { "z" }
+
+			configuration { "windows" }
+				disablewarnings { "4996", "4250", "4018", "4267", "4068", "4150" }
+
+			configuration {}
+
+		project "RetroPlugBench"
+			kind "ConsoleApp"
+			dependson { "RetroPlug" }
+
+			defines { "GB_INTERNAL", "GB_DISABLE_TIMEKEEPING" }
+
+			sysincludedirs {
+				"thirdparty",
+				"thirdparty/lua-5.3.5/src",
+				"thirdparty/liblsdj/liblsdj/include/lsdj",
+				"thirdparty/minizip-ng",
+				"thirdparty/spdlog/include",
+				"thirdparty/sol",
+				"thirdparty/SameBoy/Core",
+				"thirdparty/xxhash"
+			}
+
+			includedirs {
+				"config",
+				"src",
+				"src/retroplug"
+			}
+
+			files { "src/bench/**.h", "src/bench/**.cpp" }
+
+			links {
+				"RetroPlug",
+				"SameBoy",
+				"liblsdj",
+				"lua",
+				"minizip"
+			}
+
+			configuration { "linux" }
+				links { "pthread", "dl" }
+
+			configuration { "macosx" }
+				links { "z" }
+
+			configuration { "windows" }
+				disablewarnings { "4996", "4250", "4018", "4267", "4068", "4150" }
+
+			configuration {}
 end
 
 if _ACTION ~= "xcode4" then
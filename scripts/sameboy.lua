@@ -84,9 +84,13 @@ project "SameBoy"
 
 	defines { "GB_INTERNAL", "GB_DISABLE_TIMEKEEPING", [[GB_VERSION="]] .. getVersion() .. [["]] }
 
+	-- Batched interpreter loop in sm83_cpu.c, which relies on computed goto (GCC and clang only)
+	defines { "GB_FAST_INTERPRETER" }
+
 	sysincludedirs {
 		SAMEBOY_DIR .. "Core",
-		XXHASH_DIR
+		XXHASH_DIR,
+		"../thirdparty/spdlog/include"
 	}
 
 	includedirs {
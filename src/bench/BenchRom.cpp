@@ -0,0 +1,89 @@
+#include "BenchRom.h"
+
+#include <string.h>
+#include <stdint.h>
+
+namespace BenchRom {
+	const size_t ROM_SIZE = 32 * 1024;
+
+	// The boot ROM refuses to start a cartridge without it
+	const uint8_t NINTENDO_LOGO[] = {
+		0xCE, 0xED, 0x66, 0x66, 0xCC, 0x0D, 0x00, 0x0B, 0x03, 0x73, 0x00, 0x83, 0x00, 0x0C, 0x00, 0x0D,
+		0x00, 0x08, 0x11, 0x1F, 0x88, 0x89, 0x00, 0x0E, 0xDC, 0xCC, 0x6E, 0xE6, 0xDD, 0xDD, 0xD9, 0x99,
+		0xBB, 0xBB, 0x67, 0x63, 0x6E, 0x0E, 0xEC, 0xCC, 0xDD, 0xDC, 0x99, 0x9F, 0xBB, 0xB9, 0x33, 0x3E
+	};
+
+	const uint8_t ENTRY[] = {
+		0x00,				// nop
+		0xC3, 0x50, 0x01	// jp $0150
+	};
+
+	const uint8_t PROGRAM[] = {
+		0xF3,				// di
+		0x31, 0xFE, 0xFF,	// ld sp, $FFFE
+		0x3E, 0x0A,			// ld a, $0A
+		0xEA, 0x00, 0x00,	// ld ($0000), a	; enable cart RAM
+		0x3E, 0x80,			// ld a, $80
+		0xE0, 0x26,			// ldh (NR52), a	; sound on
+		0x3E, 0x77,			// ld a, $77
+		0xE0, 0x24,			// ldh (NR50), a	; full volume
+		0x3E, 0xFF,			// ld a, $FF
+		0xE0, 0x25,			// ldh (NR51), a	; all channels to both sides
+		0x3E, 0x80,			// ld a, $80
+		0xE0, 0x11,			// ldh (NR11), a	; 50% duty
+		0x3E, 0xF0,			// ld a, $F0
+		0xE0, 0x12,			// ldh (NR12), a	; max volume, no envelope
+		0x3E, 0x87,			// ld a, $87
+		0xE0, 0x14,			// ldh (NR14), a	; trigger
+		0x3E, 0x40,			// ld a, $40
+		0xE0, 0x16,			// ldh (NR21), a	; 25% duty
+		0x3E, 0xF0,			// ld a, $F0
+		0xE0, 0x17,			// ldh (NR22), a
+		0x3E, 0x86,			// ld a, $86
+		0xE0, 0x19,			// ldh (NR24), a	; trigger
+		0x3E, 0x91,			// ld a, $91
+		0xE0, 0x40,			// ldh (LCDC), a	; LCD and background on
+		0x06, 0x00,			// ld b, 0
+		// loop:
+		0x21, 0x00, 0xA0,	// ld hl, $A000
+		0x11, 0x00, 0x00,	// ld de, $0000
+		0x0E, 0x00,			// ld c, 0
+		// copy:
+		0x1A,				// ld a, (de)
+		0xA8,				// xor b
+		0x22,				// ld (hl+), a
+		0x13,				// inc de
+		0x0D,				// dec c
+		0x20, 0xF9,			// jr nz, copy
+		0x78,				// ld a, b
+		0xE0, 0x13,			// ldh (NR13), a	; sweep the pitch of both channels
+		0x04,				// inc b
+		0x2F,				// cpl
+		0xE0, 0x18,			// ldh (NR23), a
+		0x18, 0xE8			// jr loop
+	};
+
+	std::vector<char> build() {
+		std::vector<char> rom(ROM_SIZE, 0);
+		uint8_t* d = (uint8_t*)rom.data();
+
+		memcpy(d + 0x100, ENTRY, sizeof(ENTRY));
+		memcpy(d + 0x104, NINTENDO_LOGO, sizeof(NINTENDO_LOGO));
+		memcpy(d + 0x134, "RPBENCH", 7);
+		d[0x143] = 0x80; // Runs in colour mode on a CGB
+		d[0x147] = 0x1B; // MBC5 + RAM + battery
+		d[0x148] = 0x00; // 32KB ROM
+		d[0x149] = 0x04; // 128KB RAM, same as LSDj
+
+		uint8_t checksum = 0;
+		for (size_t i = 0x134; i <= 0x14C; ++i) {
+			checksum = checksum - d[i] - 1;
+		}
+
+		d[0x14D] = checksum;
+
+		memcpy(d + 0x150, PROGRAM, sizeof(PROGRAM));
+
+		return rom;
+	}
+}
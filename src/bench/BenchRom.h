@@ -0,0 +1,11 @@
+#pragma once
+
+#include <vector>
+
+// A small homebrew ROM that is assembled in code, so the benchmarks don't need any files.  It
+// keeps both square channels playing while sweeping their pitch, and copies a page of ROM in to
+// battery backed cart RAM in a loop with the LCD on.  The CPU, APU, PPU and MBC all have work to
+// do, much like a tracker playing a song.
+namespace BenchRom {
+	std::vector<char> build();
+}
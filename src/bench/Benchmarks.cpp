@@ -0,0 +1,391 @@
+#include "Benchmarks.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <spdlog/spdlog.h>
+
+#include "Report.h"
+#include "messaging.h"
+#include "micromsg/nodemanager.h"
+#include "model/ProcessingContext.h"
+#include "plugs/SameBoyPlug.h"
+
+extern "C" {
+#include <gb.h>
+}
+
+using Clock = std::chrono::steady_clock;
+
+const size_t BLOCK_SIZES[] = { 32, 64, 128, 256, 512, 1024, 2048, 4096 };
+const size_t EMULATION_BLOCK_SIZE = 1024;
+// Kept below the capacity of the queues between nodes
+const size_t MESSAGE_BATCH_SIZE = 64;
+const size_t MESSAGE_COUNT = 1000000;
+const size_t STATE_ITERATIONS = 200;
+
+// Runs before every measurement so boot ROM and cold cache effects are left out
+const double WARMUP_SECONDS = 0.5;
+
+static double elapsedUs(Clock::time_point start) {
+	return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+}
+
+static const char* getModelName(GameboyModel model) {
+	switch (model) {
+		case GameboyModel::DmgB: return "dmgB";
+		case GameboyModel::CgbC: return "cgbC";
+		case GameboyModel::CgbE: return "cgbE";
+		case GameboyModel::Agb: return "agb";
+		default: return "auto";
+	}
+}
+
+static SameBoyPlugPtr createSystem(const std::vector<char>& rom, GameboyModel model, double sampleRate, bool gameLink = false) {
+	SameBoySettings settings;
+	settings.model = model;
+	settings.gameLink = gameLink;
+
+	SameBoyPlugPtr plug = std::make_shared<SameBoyPlug>();
+	plug->prepare(model);
+	plug->setSampleRate(sampleRate);
+	plug->loadRom(rom.data(), rom.size(), settings, true);
+
+	return plug;
+}
+
+static void warmUp(SameBoyPlug* plug, double sampleRate) {
+	size_t frames = (size_t)(WARMUP_SECONDS * sampleRate);
+	for (size_t i = 0; i < frames; i += EMULATION_BLOCK_SIZE) {
+		plug->update(EMULATION_BLOCK_SIZE);
+	}
+}
+
+namespace Benchmarks {
+	void emulation(const BenchOptions& options, const std::vector<char>& rom) {
+		size_t blockCount = (size_t)(options.seconds * options.sampleRate / EMULATION_BLOCK_SIZE) + 1;
+		double emulatedSeconds = (double)(blockCount * EMULATION_BLOCK_SIZE) / options.sampleRate;
+
+		for (GameboyModel model : { GameboyModel::DmgB, GameboyModel::CgbE }) {
+			for (bool video : { false, true }) {
+				spdlog::info("emulation: {} video {}", getModelName(model), video ? "on" : "off");
+
+				SameBoyPlugPtr plug = createSystem(rom, model, options.sampleRate);
+				plug->disableRendering(!video);
+				warmUp(plug.get(), options.sampleRate);
+
+				Clock::time_point start = Clock::now();
+				for (size_t i = 0; i < blockCount; ++i) {
+					plug->update(EMULATION_BLOCK_SIZE);
+				}
+
+				double seconds = elapsedUs(start) / 1000000.0;
+				double realtime = emulatedSeconds / seconds;
+				uint32_t clockRate = GB_get_unmultiplied_clock_rate(plug->getState()->gb);
+
+				Report("emulation")
+					.set("model", getModelName(model))
+					.set("video", video)
+					.set("emulatedSeconds", emulatedSeconds)
+					.set("wallSeconds", seconds)
+					.set("realtimeFactor", realtime)
+					.set("cyclesPerSecond", realtime * clockRate)
+					.print();
+			}
+		}
+	}
+
+	void interpreter(const BenchOptions& options, const std::vector<char>& rom) {
+		size_t blockCount = (size_t)(options.seconds * options.sampleRate / EMULATION_BLOCK_SIZE) + 1;
+		double emulatedSeconds = (double)(blockCount * EMULATION_BLOCK_SIZE) / options.sampleRate;
+
+		for (GameboyModel model : { GameboyModel::DmgB, GameboyModel::CgbE }) {
+			double cyclesPerSecond[2] = { 0 };
+			std::vector<char> states[2];
+
+			// main() turns the boot state cache on, so booting a first system caches its post-boot
+			// state and both runs start from the same one
+			createSystem(rom, model, options.sampleRate);
+
+			for (bool fast : { false, true }) {
+				spdlog::info("interpreter: {} fast {}", getModelName(model), fast ? "on" : "off");
+
+				SameBoyPlugPtr plug = createSystem(rom, model, options.sampleRate);
+				plug->disableRendering(true);
+				GB_set_fast_interpreter_enabled(plug->getState()->gb, fast);
+				warmUp(plug.get(), options.sampleRate);
+
+				Clock::time_point start = Clock::now();
+				for (size_t i = 0; i < blockCount; ++i) {
+					plug->update(EMULATION_BLOCK_SIZE);
+				}
+
+				double seconds = elapsedUs(start) / 1000000.0;
+				uint32_t clockRate = GB_get_unmultiplied_clock_rate(plug->getState()->gb);
+				cyclesPerSecond[fast] = emulatedSeconds / seconds * clockRate;
+
+				// The RTC follows the wall clock, so it would differ between the runs
+				plug->getState()->gb->last_rtc_second = 0;
+				states[fast].resize(plug->saveStateSize());
+				plug->saveState(states[fast].data(), states[fast].size());
+
+				Report("interpreter")
+					.set("model", getModelName(model))
+					.set("fast", fast)
+					.set("emulatedSeconds", emulatedSeconds)
+					.set("wallSeconds", seconds)
+					.set("cyclesPerSecond", cyclesPerSecond[fast])
+					.print();
+			}
+
+			Report("interpreter")
+				.set("model", getModelName(model))
+				.set("speedup", cyclesPerSecond[1] / cyclesPerSecond[0])
+				.set("statesMatch", states[0] == states[1])
+				.print();
+		}
+	}
+
+	void process(const BenchOptions& options, const std::vector<char>& rom) {
+		for (size_t systemCount = 1; systemCount <= 4; ++systemCount) {
+			for (size_t blockSize : BLOCK_SIZES) {
+				spdlog::info("process: {} systems, {} frame blocks", systemCount, blockSize);
+
+				micromsg::NodeManager<NodeTypes> bus;
+				registerCalls(bus);
+				bus.createNode(NodeTypes::Ui, { NodeTypes::Audio });
+				Node* node = bus.createNode(NodeTypes::Audio, { NodeTypes::Ui });
+				bus.start();
+
+				ProcessingContext ctx;
+				ctx.setNode(node);
+				ctx.setAudioSettings(AudioSettings { 2, blockSize, options.sampleRate, blockSize });
+
+				ProcessingSettings settings;
+				settings.workerThreads = options.workerThreads;
+				ctx.setProcessingSettings(settings);
+
+				for (size_t i = 0; i < systemCount; ++i) {
+					ctx.swapSystem((SystemIndex)i, createSystem(rom, GameboyModel::CgbE, options.sampleRate));
+				}
+
+				// As it is with the UI open
+				ctx.setRenderingEnabled(true);
+
+				std::vector<float> left(blockSize);
+				std::vector<float> right(blockSize);
+				float* outputs[2] = { left.data(), right.data() };
+
+				size_t warmupBlocks = (size_t)(WARMUP_SECONDS * options.sampleRate / blockSize) + 1;
+				size_t blockCount = (size_t)(options.seconds * options.sampleRate / blockSize) + 1;
+
+				std::vector<double> times;
+				times.reserve(blockCount);
+
+				for (size_t i = 0; i < warmupBlocks + blockCount; ++i) {
+					std::fill(left.begin(), left.end(), 0.0f);
+					std::fill(right.begin(), right.end(), 0.0f);
+
+					Clock::time_point start = Clock::now();
+					ctx.process(outputs, blockSize);
+					double us = elapsedUs(start);
+
+					if (i >= warmupBlocks) {
+						times.push_back(us);
+					}
+				}
+
+				TimingStats stats = computeStats(times);
+				double deadlineUs = blockSize / options.sampleRate * 1000000.0;
+
+				Report("process")
+					.set("systems", systemCount)
+					.set("blockSize", blockSize)
+					.set("workerThreads", options.workerThreads)
+					.set("blocks", blockCount)
+					.set("deadlineUs", deadlineUs)
+					.set("blockUs", stats)
+					.set("loadMean", stats.mean / deadlineUs)
+					.set("loadP99", stats.p99 / deadlineUs)
+					.set("overruns", (size_t)std::count_if(times.begin(), times.end(), [&](double t) { return t > deadlineUs; }))
+					.print();
+			}
+		}
+	}
+
+	void link(const BenchOptions& options, const std::vector<char>& rom) {
+		const size_t blockSize = EMULATION_BLOCK_SIZE;
+		size_t blockCount = (size_t)(options.seconds * options.sampleRate / blockSize) + 1;
+
+		for (size_t systemCount : { 2, 4 }) {
+			for (bool linked : { false, true }) {
+				spdlog::info("link: {} systems {}", systemCount, linked ? "linked" : "unlinked");
+
+				std::vector<SameBoyPlugPtr> systems;
+				SameBoyPlug* plugs[MAX_SYSTEMS] = { nullptr };
+
+				for (size_t i = 0; i < systemCount; ++i) {
+					systems.push_back(createSystem(rom, GameboyModel::CgbE, options.sampleRate, linked));
+					plugs[i] = systems.back().get();
+					warmUp(plugs[i], options.sampleRate);
+				}
+
+				if (linked) {
+					for (size_t i = 0; i < systemCount; ++i) {
+						std::vector<SameBoyPlugPtr> targets;
+						for (size_t j = 0; j < systemCount; ++j) {
+							if (j != i) {
+								targets.push_back(systems[j]);
+							}
+						}
+
+						systems[i]->setLinkTargets(targets);
+					}
+				}
+
+				std::vector<double> times;
+				times.reserve(blockCount);
+
+				for (size_t i = 0; i < blockCount; ++i) {
+					Clock::time_point start = Clock::now();
+
+					if (linked) {
+						plugs[0]->updateMultiple(plugs, systemCount, blockSize);
+					} else {
+						for (size_t j = 0; j < systemCount; ++j) {
+							plugs[j]->update(blockSize);
+						}
+					}
+
+					times.push_back(elapsedUs(start));
+				}
+
+				TimingStats stats = computeStats(times);
+
+				Report("link")
+					.set("systems", systemCount)
+					.set("linked", linked)
+					.set("blockSize", blockSize)
+					.set("blockUs", stats)
+					.set("realtimeFactor", (blockSize / options.sampleRate * 1000000.0) / stats.mean)
+					.print();
+			}
+		}
+	}
+
+	void messaging(const BenchOptions& options) {
+		spdlog::info("messaging");
+
+		micromsg::NodeManager<NodeTypes> bus;
+		// One request slot is reserved by the node, so leave some headroom
+		bus.addCall<calls::SetActive>(MESSAGE_BATCH_SIZE * 2);
+		bus.addCall<calls::TakeSystem>(MESSAGE_BATCH_SIZE * 2);
+
+		Node* ui = bus.createNode(NodeTypes::Ui, { NodeTypes::Audio });
+		Node* audio = bus.createNode(NodeTypes::Audio, { NodeTypes::Ui });
+
+		size_t received = 0;
+		size_t responses = 0;
+
+		audio->on<calls::SetActive>([&](const SystemIndex&) { received++; });
+		audio->on<calls::TakeSystem>([&](const SystemIndex&, SameBoyPlugPtr&) { received++; });
+
+		bus.start();
+
+		size_t batchCount = MESSAGE_COUNT / MESSAGE_BATCH_SIZE;
+		size_t messageCount = batchCount * MESSAGE_BATCH_SIZE;
+
+		// Pushes go one way, and are freed by the receiver
+		double pushUs = 0;
+		double pullUs = 0;
+
+		for (size_t i = 0; i < batchCount; ++i) {
+			Clock::time_point start = Clock::now();
+			for (size_t j = 0; j < MESSAGE_BATCH_SIZE; ++j) {
+				ui->push<calls::SetActive>(NodeTypes::Audio, (SystemIndex)j);
+			}
+
+			pushUs += elapsedUs(start);
+
+			start = Clock::now();
+			audio->pull();
+			pullUs += elapsedUs(start);
+		}
+
+		bool pushesValid = received == messageCount;
+
+		Report("messaging")
+			.set("call", "push")
+			.set("messages", messageCount)
+			.set("valid", pushesValid)
+			.set("pushNs", pushUs * 1000.0 / messageCount)
+			.set("pullNs", pullUs * 1000.0 / messageCount)
+			.set("messagesPerSecond", messageCount / ((pushUs + pullUs) / 1000000.0))
+			.print();
+
+		// Requests make a round trip, the responses are handled when the sender pulls
+		received = 0;
+		Clock::time_point start = Clock::now();
+
+		for (size_t i = 0; i < batchCount; ++i) {
+			for (size_t j = 0; j < MESSAGE_BATCH_SIZE; ++j) {
+				ui->request<calls::TakeSystem>(NodeTypes::Audio, (SystemIndex)j, [&](const SameBoyPlugPtr&) { responses++; });
+			}
+
+			audio->pull();
+			ui->pull();
+		}
+
+		double requestUs = elapsedUs(start);
+
+		Report("messaging")
+			.set("call", "request")
+			.set("messages", messageCount)
+			.set("valid", received == messageCount && responses == messageCount)
+			.set("roundTripNs", requestUs * 1000.0 / messageCount)
+			.set("messagesPerSecond", messageCount / (requestUs / 1000000.0))
+			.print();
+	}
+
+	void state(const BenchOptions& options, const std::vector<char>& rom) {
+		for (GameboyModel model : { GameboyModel::DmgB, GameboyModel::CgbE }) {
+			spdlog::info("state: {}", getModelName(model));
+
+			SameBoyPlugPtr source = createSystem(rom, model, options.sampleRate);
+			SameBoyPlugPtr target = createSystem(rom, model, options.sampleRate);
+			warmUp(source.get(), options.sampleRate);
+
+			std::vector<char> buffer(source->saveStateSize());
+			std::vector<double> saveTimes;
+			std::vector<double> loadTimes;
+			std::vector<double> copyTimes;
+
+			for (size_t i = 0; i < STATE_ITERATIONS; ++i) {
+				// Keeps the state changing between iterations
+				source->update(256);
+
+				Clock::time_point start = Clock::now();
+				source->saveState(buffer.data(), buffer.size());
+				saveTimes.push_back(elapsedUs(start));
+
+				start = Clock::now();
+				target->loadState(buffer.data(), buffer.size());
+				loadTimes.push_back(elapsedUs(start));
+
+				start = Clock::now();
+				target->copyStateFrom(*source);
+				copyTimes.push_back(elapsedUs(start));
+			}
+
+			Report("state")
+				.set("model", getModelName(model))
+				.set("stateBytes", buffer.size())
+				.set("sramBytes", source->sramSize())
+				.set("saveUs", computeStats(saveTimes))
+				.set("loadUs", computeStats(loadTimes))
+				.set("copyUs", computeStats(copyTimes))
+				.print();
+		}
+	}
+}
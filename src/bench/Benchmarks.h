@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+#include <stddef.h>
+
+struct BenchOptions {
+	// Emulated seconds run for each measurement
+	double seconds = 5;
+
+	double sampleRate = 48000;
+
+	// Worker threads used by the processing benchmark
+	size_t workerThreads = 0;
+};
+
+// Each benchmark prints one report per configuration it measures.  `rom` is the image every
+// system runs.
+namespace Benchmarks {
+	// Emulated clock cycles per second of wall time for a single system on one core, with and
+	// without video, on DMG and CGB models
+	void emulation(const BenchOptions& options, const std::vector<char>& rom);
+
+	// Emulated clock cycles per second for a single system without video, with the core's batched
+	// interpreter loop turned off and on.  Both runs must end in the same state.
+	void interpreter(const BenchOptions& options, const std::vector<char>& rom);
+
+	// Time spent in ProcessingContext::process per block for 1 - 4 systems at 32 - 4096 frame
+	// blocks, including the load against the block's deadline
+	void process(const BenchOptions& options, const std::vector<char>& rom);
+
+	// Running 2 and 4 systems one after the other versus in lockstep with updateMultiple
+	void link(const BenchOptions& options, const std::vector<char>& rom);
+
+	// Push/pull and request/response throughput between two message nodes
+	void messaging(const BenchOptions& options);
+
+	// Save state, load state and direct copy latency
+	void state(const BenchOptions& options, const std::vector<char>& rom);
+}
@@ -0,0 +1,98 @@
+#include "Report.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+
+TimingStats computeStats(std::vector<double>& samples) {
+	TimingStats stats;
+	if (samples.empty()) {
+		return stats;
+	}
+
+	std::sort(samples.begin(), samples.end());
+
+	double total = 0;
+	for (double s : samples) {
+		total += s;
+	}
+
+	auto percentile = [&](double p) {
+		size_t idx = (size_t)ceil(p * samples.size()) - 1;
+		return samples[std::min(idx, samples.size() - 1)];
+	};
+
+	stats.min = samples.front();
+	stats.mean = total / samples.size();
+	stats.p50 = percentile(0.5);
+	stats.p99 = percentile(0.99);
+	stats.max = samples.back();
+
+	return stats;
+}
+
+Report::Report(const std::string& benchmark) {
+	_json = "{";
+	set("benchmark", benchmark);
+}
+
+void Report::addKey(const char* key) {
+	if (_json.size() > 1) {
+		_json += ",";
+	}
+
+	_json += "\"";
+	_json += key;
+	_json += "\":";
+}
+
+Report& Report::set(const char* key, const std::string& value) {
+	addKey(key);
+	_json += "\"";
+
+	for (char c : value) {
+		if (c == '"' || c == '\\') {
+			_json += '\\';
+		}
+
+		_json += c;
+	}
+
+	_json += "\"";
+	return *this;
+}
+
+Report& Report::set(const char* key, double value) {
+	char buf[32];
+	snprintf(buf, sizeof(buf), "%.6g", std::isfinite(value) ? value : 0.0);
+	addKey(key);
+	_json += buf;
+	return *this;
+}
+
+Report& Report::set(const char* key, int64_t value) {
+	addKey(key);
+	_json += std::to_string(value);
+	return *this;
+}
+
+Report& Report::set(const char* key, bool value) {
+	addKey(key);
+	_json += value ? "true" : "false";
+	return *this;
+}
+
+Report& Report::set(const char* prefix, const TimingStats& stats) {
+	std::string p = prefix;
+	set((p + "Min").c_str(), stats.min);
+	set((p + "Mean").c_str(), stats.mean);
+	set((p + "P50").c_str(), stats.p50);
+	set((p + "P99").c_str(), stats.p99);
+	set((p + "Max").c_str(), stats.max);
+	return *this;
+}
+
+void Report::print() const {
+	fprintf(stdout, "%s}\n", _json.c_str());
+	fflush(stdout);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+struct TimingStats {
+	double min = 0;
+	double mean = 0;
+	double p50 = 0;
+	double p99 = 0;
+	double max = 0;
+};
+
+// Sorts `samples` in place
+TimingStats computeStats(std::vector<double>& samples);
+
+// A single benchmark result, printed to stdout as one line of JSON so runs can be collected and
+// compared between versions
+class Report {
+private:
+	std::string _json;
+
+public:
+	Report(const std::string& benchmark);
+
+	Report& set(const char* key, const std::string& value);
+	Report& set(const char* key, const char* value) { return set(key, std::string(value)); }
+	Report& set(const char* key, double value);
+	Report& set(const char* key, int64_t value);
+	Report& set(const char* key, size_t value) { return set(key, (int64_t)value); }
+	Report& set(const char* key, int value) { return set(key, (int64_t)value); }
+	Report& set(const char* key, bool value);
+
+	// Adds <prefix>Min, <prefix>Mean, <prefix>P50, <prefix>P99 and <prefix>Max
+	Report& set(const char* prefix, const TimingStats& stats);
+
+	void print() const;
+
+private:
+	void addKey(const char* key);
+};
@@ -0,0 +1,151 @@
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdlib.h>
+
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+#include "config.h"
+#include "BenchRom.h"
+#include "Benchmarks.h"
+#include "Report.h"
+#include "model/BootStateCache.h"
+
+const char* BENCHMARK_NAMES[] = { "emulation", "interpreter", "process", "link", "messaging", "state" };
+
+static void printUsage() {
+	fprintf(stderr,
+		"Measures the performance of the emulator and audio path.  Results are printed to stdout,\n"
+		"one JSON object per line.\n"
+		"\n"
+		"Usage: RetroPlugBench [benchmark...] [options]\n"
+		"\n"
+		"Benchmarks (all are run by default):\n"
+		"  emulation   Emulated cycles per second for a single system, with and without video\n"
+		"  interpreter Emulated cycles per second with the core's batched interpreter off and on\n"
+		"  process     Time per audio block for 1 - 4 systems at 32 - 4096 frame blocks\n"
+		"  link        Separate versus linked systems\n"
+		"  messaging   Message throughput between the UI and audio nodes\n"
+		"  state       Save state, load state and copy latency\n"
+		"\n"
+		"Options:\n"
+		"  -s, --seconds <seconds>  Emulated time per measurement (default 5)\n"
+		"  -r, --rate <hz>          Sample rate (default 48000)\n"
+		"  -w, --workers <count>    Worker threads for the process benchmark (default 0)\n"
+	);
+}
+
+static bool parseNumber(const char* str, double& target) {
+	char* end = nullptr;
+	double v = strtod(str, &end);
+	if (end == str || *end != '\0' || v < 0) {
+		return false;
+	}
+
+	target = v;
+	return true;
+}
+
+static bool isBenchmark(const std::string& name) {
+	for (const char* b : BENCHMARK_NAMES) {
+		if (name == b) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static bool parseArgs(int argc, char** argv, BenchOptions& options, std::vector<std::string>& benchmarks) {
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+
+		auto number = [&](double& target) {
+			if (i + 1 >= argc) {
+				fprintf(stderr, "Missing value for %s\n", arg.c_str());
+				return false;
+			}
+
+			const char* v = argv[++i];
+			if (!parseNumber(v, target)) {
+				fprintf(stderr, "Invalid value for %s: %s\n", arg.c_str(), v);
+				return false;
+			}
+
+			return true;
+		};
+
+		double n = 0;
+
+		if (arg == "-s" || arg == "--seconds") {
+			if (!number(options.seconds) || options.seconds <= 0) return false;
+		} else if (arg == "-r" || arg == "--rate") {
+			if (!number(options.sampleRate) || options.sampleRate < 1) return false;
+		} else if (arg == "-w" || arg == "--workers") {
+			if (!number(n)) return false;
+			options.workerThreads = (size_t)n;
+		} else if (arg == "-h" || arg == "--help") {
+			return false;
+		} else if (isBenchmark(arg)) {
+			benchmarks.push_back(arg);
+		} else {
+			fprintf(stderr, "Unknown benchmark or option %s\n", arg.c_str());
+			return false;
+		}
+	}
+
+	if (benchmarks.empty()) {
+		benchmarks.assign(std::begin(BENCHMARK_NAMES), std::end(BENCHMARK_NAMES));
+	}
+
+	return true;
+}
+
+int main(int argc, char** argv) {
+	BenchOptions options;
+	std::vector<std::string> benchmarks;
+	if (!parseArgs(argc, argv, options, benchmarks)) {
+		printUsage();
+		return 1;
+	}
+
+	// Progress goes to stderr so stdout only has results on it.  The message bus logs handler
+	// registration to std::cout, so that is moved too.
+	auto logger = std::make_shared<spdlog::logger>("", std::make_shared<spdlog::sinks::stderr_color_sink_mt>());
+	spdlog::set_default_logger(logger);
+	std::cout.rdbuf(std::cerr.rdbuf());
+
+	// Systems start from a cached post-boot state after the first, same as in the plugin
+	BootStateCache::configure(true, "");
+
+	std::vector<char> rom = BenchRom::build();
+
+	Report("info")
+		.set("version", PLUG_VERSION_STR)
+		.set("cores", (size_t)std::thread::hardware_concurrency())
+		.set("seconds", options.seconds)
+		.set("sampleRate", options.sampleRate)
+		.set("workerThreads", options.workerThreads)
+		.print();
+
+	for (const std::string& name : benchmarks) {
+		if (name == "emulation") {
+			Benchmarks::emulation(options, rom);
+		} else if (name == "interpreter") {
+			Benchmarks::interpreter(options, rom);
+		} else if (name == "process") {
+			Benchmarks::process(options, rom);
+		} else if (name == "link") {
+			Benchmarks::link(options, rom);
+		} else if (name == "messaging") {
+			Benchmarks::messaging(options);
+		} else if (name == "state") {
+			Benchmarks::state(options, rom);
+		}
+	}
+
+	return 0;
+}
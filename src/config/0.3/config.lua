@@ -21,5 +21,17 @@
 		midiRouting = "sendToAll",
 		layout = "auto",
 		includeRom = true
+	},
+	-- Audio engine settings
+	audio = {
+		workerThreads = 0, -- Extra threads used to run unlinked systems in parallel (0 = disabled)
+		lookaheadBlocks = 0, -- Host blocks rendered ahead on a separate thread, adds latency (0 = disabled)
+		rewindSeconds = 0, -- Seconds of rewind history kept per system (0 = disabled)
+		rewindMemoryMb = 64, -- Memory shared by the rewind history of all systems
+		sramAutosaveSeconds = 10, -- Seconds between writes of changed SRAM to a system's .sav file (0 = disabled)
+		indexedVideo = false, -- Systems output 8 bit palette indices that are expanded to RGBA when drawn
+		systemCount = 4, -- Maximum number of systems in a project (1 - 16)
+		bootStates = "memory", -- Start systems from a cached post-boot state instead of running the boot ROM ("off", "memory" or "disk")
+		timingOverlay = false -- Time each part of every audio block and show min/avg/p99/max over the systems
 	}
 }
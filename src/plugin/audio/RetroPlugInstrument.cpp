@@ -54,11 +54,23 @@ void RetroPlugInstrument::ProcessBlock(sample** inputs, sample** outputs, int fr
 	static_assert(sizeof(TimeInfo) == sizeof(iplug::ITimeInfo), "Time info size is incorrect");
 	memcpy(&timeInfo, &mTimeInfo, sizeof(TimeInfo));
 
-	_controller.audioController()->process(outputs, (size_t)frameCount);
+	AudioController* audioController = _controller.audioController();
+	audioController->setOffline(GetRenderingOffline());
+	audioController->process(outputs, (size_t)frameCount);
 }
 
 void RetroPlugInstrument::OnIdle() {
-	
+	AudioController* audioController = _controller.audioController();
+
+	// Lookahead rendering can be toggled at any time from the config, so the latency
+	// reported to the host is kept in sync here.
+	int latency = (int)audioController->getLatency();
+	if (latency != GetLatency()) {
+		SetLatency(latency);
+	}
+
+	// The host asks for offline rendering on the audio thread, which can't start threads
+	audioController->updateWorkerThreads();
 }
 
 bool RetroPlugInstrument::OnKeyDown(const IKeyPress& key) {
@@ -109,16 +121,11 @@ int RetroPlugInstrument::UnserializeState(const IByteChunk& chunk, int pos) {
 void RetroPlugInstrument::ProcessMidiMsg(const IMidiMsg& msg) {
 	TRACE;
 
-	_controller.getMenuLock()->lock(); // Temporary
-	if (_controller.audioLua()) {
-		_controller.audioLua()->onMidi(msg.mOffset, msg.mStatus, msg.mData1, msg.mData2);
-	}
-	
-	_controller.getMenuLock()->unlock();
+	_controller.audioController()->onMidi(msg.mOffset, msg.mStatus, msg.mData1, msg.mData2);
 }
 
 void RetroPlugInstrument::OnReset() {
-	AudioSettings settings = { (size_t)NOutChansConnected(), 0, GetSampleRate() };
+	AudioSettings settings = { (size_t)NOutChansConnected(), 0, GetSampleRate(), (size_t)GetBlockSize() };
 	_controller.audioController()->setAudioSettings(settings);
 }
 #endif
@@ -56,24 +56,7 @@ RetroPlugController::RetroPlugController(double sampleRate)
 	spdlog::set_default_logger(logger);
 	spdlog::flush_every(std::chrono::seconds(5));
 
-	_bus.addCall<calls::LoadRom>(4);
-	_bus.addCall<calls::SwapSystem>(4);
-	_bus.addCall<calls::TakeSystem>(4);
-	_bus.addCall<calls::DuplicateSystem>(1);
-	_bus.addCall<calls::ResetSystem>(4);
-	_bus.addCall<calls::TransmitVideo>(16);
-	_bus.addCall<calls::UpdateProjectSettings>(4);
-	_bus.addCall<calls::UpdateSystemSettings>(4);
-	_bus.addCall<calls::PressButtons>(32);
-	_bus.addCall<calls::FetchState>(4);
-	_bus.addCall<calls::ContextMenuResult>(1);
-	_bus.addCall<calls::SwapLuaContext>(4);
-	_bus.addCall<calls::SetActive>(4);
-	_bus.addCall<calls::SetRom>(4);
-	_bus.addCall<calls::SetSram>(4);
-	_bus.addCall<calls::SetState>(4);
-	_bus.addCall<calls::EnableRendering>(1);
-	_bus.addCall<calls::SramChanged>(4);
+	registerCalls(_bus);
 
 	_proxy.setNode(_bus.createNode(NodeTypes::Ui, { NodeTypes::Audio }));
 	_audioController.setNode(_bus.createNode(NodeTypes::Audio, { NodeTypes::Ui }));
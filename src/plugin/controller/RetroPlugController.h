@@ -45,8 +45,6 @@ public:
 		return _timeInfo;
 	}
 
-	std::mutex* getMenuLock() { return _audioController.getLock(); }
-
 	void update(double delta);
 
 	void init(iplug::igraphics::IRECT bounds);
@@ -0,0 +1,89 @@
+#include "FrameAtlas.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <string.h>
+
+#include "util/PixelExpander.h"
+
+FrameAtlas::FrameAtlas(Dimension2 frameSize, size_t slotCount)
+	: _frameSize(frameSize), _slotCount(slotCount), _pixels((size_t)frameSize.w * slotCount * frameSize.h, 0)
+{
+}
+
+void FrameAtlas::setSlotCount(size_t slotCount) {
+	if (slotCount == _slotCount) {
+		return;
+	}
+
+	_slotCount = slotCount;
+	_pixels.assign((size_t)_frameSize.w * slotCount * _frameSize.h, 0);
+	_dirtyRows = DirtyRows { 0, (uint32_t)_frameSize.h };
+}
+
+void FrameAtlas::write(SystemIndex idx, VideoFormat format, const uint8_t* frame, DirtyRows rows) {
+	size_t frameW = (size_t)_frameSize.w;
+	size_t stride = frameW * _slotCount;
+	assert((size_t)idx < _slotCount);
+	uint32_t* target = _pixels.data() + idx * frameW;
+
+	rows.bottom = std::min(rows.bottom, (uint32_t)_frameSize.h);
+	if (rows.empty()) {
+		return;
+	}
+
+	if (format == VideoFormat::Indexed) {
+		assert(_frameSize.w == INDEXED_FRAME_WIDTH && _frameSize.h == INDEXED_FRAME_HEIGHT);
+		PixelExpander::expandFrame((const IndexedFrame*)frame, target, stride, rows.top, rows.bottom);
+	} else {
+		const uint32_t* pixels = (const uint32_t*)frame;
+		for (uint32_t y = rows.top; y < rows.bottom; ++y) {
+			memcpy(target + y * stride, pixels + y * frameW, frameW * sizeof(uint32_t));
+		}
+	}
+
+	_dirtyRows = _dirtyRows.merge(rows);
+}
+
+void FrameAtlas::upload(NVGcontext* vg) {
+	if (_dirtyRows.empty()) {
+		return;
+	}
+
+	int width = _frameSize.w * (int)_slotCount;
+	const unsigned char* data = (const unsigned char*)_pixels.data();
+
+	if (_imageId != -1 && _imageWidth != width) {
+		nvgDeleteImage(vg, _imageId);
+		_imageId = -1;
+	}
+
+	if (_imageId == -1) {
+		_imageId = nvgCreateImageRGBA(vg, width, _frameSize.h, NVG_IMAGE_NEAREST, data);
+		_imageWidth = width;
+	} else {
+		// nvgUpdateImage always sends the whole texture, so go to the renderer directly to
+		// only send the lines that changed.  The renderer offsets in to data itself.
+		NVGparams* params = nvgInternalParams(vg);
+		params->renderUpdateTexture(params->userPtr, _imageId, 0, (int)_dirtyRows.top, width, (int)(_dirtyRows.bottom - _dirtyRows.top), data);
+	}
+
+	_dirtyRows = DirtyRows();
+}
+
+void FrameAtlas::destroy(NVGcontext* vg) {
+	if (_imageId != -1) {
+		nvgDeleteImage(vg, _imageId);
+		_imageId = -1;
+	}
+
+	_dirtyRows = DirtyRows { 0, (uint32_t)_frameSize.h };
+}
+
+NVGpaint FrameAtlas::getPaint(NVGcontext* vg, SystemIndex idx, float x, float y, int zoom, float alpha) const {
+	float w = (float)(_frameSize.w * zoom);
+	float h = (float)(_frameSize.h * zoom);
+
+	// The pattern covers the whole atlas, offset so the system's slot lands at (x, y)
+	return nvgImagePattern(vg, x - w * idx, y, w * _slotCount, h, 0, _imageId, alpha);
+}
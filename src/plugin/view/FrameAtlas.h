@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+#include "nanovg.h"
+#include "Constants.h"
+#include "Types.h"
+#include "util/VideoTripleBuffer.h"
+
+// Every system's latest frame packed side by side in a single texture, so a UI frame uploads
+// at most one image no matter how many systems are running.
+class FrameAtlas {
+private:
+	Dimension2 _frameSize;
+	size_t _slotCount;
+	std::vector<uint32_t> _pixels;
+	int _imageId = -1;
+	int _imageWidth = 0;
+	DirtyRows _dirtyRows;
+
+public:
+	FrameAtlas(Dimension2 frameSize, size_t slotCount);
+
+	// Changes the number of slots.  The contents are cleared and the texture is recreated on
+	// the next upload, so every slot has to be written again.
+	void setSlotCount(size_t slotCount);
+
+	size_t getSlotCount() const { return _slotCount; }
+
+	// Copies lines of a frame in to the system's slot, expanding them to RGBA if the frame is
+	// indexed.  Nothing is uploaded until upload() is called.
+	void write(SystemIndex idx, VideoFormat format, const uint8_t* frame, DirtyRows rows);
+
+	// Sends the lines written since the last upload to the texture
+	void upload(NVGcontext* vg);
+
+	void destroy(NVGcontext* vg);
+
+	const Dimension2& getFrameSize() const { return _frameSize; }
+
+	bool valid() const { return _imageId != -1; }
+
+	// A paint that draws the system's slot with its top left corner at (x, y)
+	NVGpaint getPaint(NVGcontext* vg, SystemIndex idx, float x, float y, int zoom, float alpha) const;
+};
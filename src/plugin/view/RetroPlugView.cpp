@@ -19,30 +19,23 @@ const size_t DEFAULT_SRAM_SIZE = 0x20000;
 
 const double VIDEO_STREAM_TIMEOUT = 1000.0;
 
+const float TIMING_ROW_HEIGHT = 14.0f;
+const float TIMING_NAME_WIDTH = 70.0f;
+const float TIMING_COLUMN_WIDTH = 48.0f;
+const float TIMING_PADDING = 6.0f;
+
 RetroPlugView::RetroPlugView(IRECT b, UiLuaContext* lua, AudioContextProxy* proxy, AudioController* audioController)
-	: IControl(b), _lua(lua), _proxy(proxy), _audioController(audioController)
+	: IControl(b), _lua(lua), _proxy(proxy), _audioController(audioController), _atlas({ FRAME_WIDTH, FRAME_HEIGHT }, DEFAULT_SYSTEM_COUNT)
 {
-	proxy->videoCallback = [&](const VideoStream& video) {
-		const auto& systems = _proxy->getProject()->systems;
-
-		for (const SystemDescPtr& system : systems) {
-			if (system->state == SystemState::Running) {
-				const VideoBuffer& videoBuffer = video.buffers[system->idx];
-
-				if (videoBuffer.hasData) {
-					_views[system->idx]->WriteFrame(videoBuffer);
-				}
-			}
-		}
-
-		_timeSinceVideo = 0;
-	};
-
 	_proxy->setRenderingEnabled(true);
 }
 
 RetroPlugView::~RetroPlugView() {
 	_proxy->setRenderingEnabled(false);
+
+	if (GetUI()) {
+		_atlas.destroy((NVGcontext*)GetUI()->GetDrawContext());
+	}
 }
 
 void RetroPlugView::OnInit() {
@@ -123,16 +116,36 @@ void RetroPlugView::Draw(IGraphics& g) {
 	_proxy->update(delta);
 	_lua->update(delta);
 
-	_timeSinceVideo += delta;
+	// Systems don't output video while the host is bouncing, which isn't a lost feed
+	if (_audioController->isOffline()) {
+		_timeSinceVideo = 0;
+	} else {
+		_timeSinceVideo += delta;
+	}
 
 	const auto& systems = _proxy->getProject()->systems;
+
+	// Frames are read straight out of the systems' video buffers and packed in to the atlas,
+	// which is then uploaded once for all systems.  Systems only publish frames that changed, so
+	// a static screen still counts as a live feed as long as frames are being finished.
+	for (const SystemDescPtr& system : systems) {
+		if (system->video) {
+			bool visible = system->state == SystemState::Running || system->state == SystemState::VideoFeedLost;
+			if (_views[system->idx]->UpdateFrame(system->instanceId, *system->video, _atlas, visible)) {
+				_timeSinceVideo = 0;
+			}
+		}
+	}
+
+	_atlas.upload((NVGcontext*)g.GetDrawContext());
+
 	for (size_t i = 0; i < systems.size(); ++i) {
 		SystemView* view = _views[i];
 		const SystemDescPtr& system = systems[i];
 
 		if (system->state == SystemState::Running) {
 			if (_timeSinceVideo < VIDEO_STREAM_TIMEOUT) {
-				view->Draw(g, delta);
+				view->Draw(g, _atlas, delta);
 			} else {
 				system->state = SystemState::VideoFeedLost;
 				view->ShowText("Audio timeout", "Check DAW settings");
@@ -141,11 +154,86 @@ void RetroPlugView::Draw(IGraphics& g) {
 		} else if (system->state == SystemState::VideoFeedLost) {
 			if (_timeSinceVideo < VIDEO_STREAM_TIMEOUT) {
 				view->HideText();
-				view->Draw(g, delta);
+				view->Draw(g, _atlas, delta);
 				system->state = SystemState::Running;
 			}
 		}
 	}
+
+	const ProcessTimingStats* timings = _proxy->getTimingStats();
+	if (timings) {
+		DrawTimings(g, *timings);
+	}
+}
+
+void RetroPlugView::DrawTimings(IGraphics& g, const ProcessTimingStats& stats) {
+	const char* columns[] = { "min", "avg", "p99", "max", "p99 %" };
+	const size_t columnCount = sizeof(columns) / sizeof(columns[0]);
+
+	// Phases that never take any time (such as rewind when it's disabled) are left out
+	std::vector<std::pair<std::string, const PhaseStats*>> rows;
+	for (size_t i = 0; i < PROCESS_PHASE_COUNT; ++i) {
+		if (stats.phases[i].max > 0) {
+			rows.push_back({ getProcessPhaseName((ProcessPhase)i), &stats.phases[i] });
+		}
+	}
+
+	for (size_t i = 0; i < stats.systemCount; ++i) {
+		if (stats.systems[i].max > 0) {
+			rows.push_back({ "System " + std::to_string(i + 1), &stats.systems[i] });
+		}
+	}
+
+	float x = TIMING_PADDING;
+	float y = TIMING_PADDING;
+	float w = TIMING_NAME_WIDTH + TIMING_COLUMN_WIDTH * columnCount + TIMING_PADDING * 2;
+	bool lookaheadErrors = stats.lookaheadUnderruns > 0 || stats.lookaheadOverflowFrames > 0;
+	float h = TIMING_ROW_HEIGHT * (rows.size() + (lookaheadErrors ? 3 : 2)) + TIMING_PADDING * 2;
+
+	g.FillRect(IColor(192, 0, 0, 0), IRECT(x, y, x + w, y + h));
+	x += TIMING_PADDING;
+	y += TIMING_PADDING;
+
+	IText name(12, COLOR_WHITE, "Roboto-Regular", EAlign::Near, EVAlign::Top);
+	IText value(12, COLOR_WHITE, "Roboto-Regular", EAlign::Far, EVAlign::Top);
+	IText over(12, COLOR_RED, "Roboto-Regular", EAlign::Far, EVAlign::Top);
+	IText overName(12, COLOR_RED, "Roboto-Regular", EAlign::Near, EVAlign::Top);
+
+	char text[128];
+	snprintf(text, sizeof(text), "Deadline %.0f us, %d overruns in %d blocks", stats.deadline, (int)stats.overruns, (int)stats.blockCount);
+	g.DrawText(stats.overruns > 0 ? overName : name, text, IRECT(x, y, x + w, y + TIMING_ROW_HEIGHT));
+	y += TIMING_ROW_HEIGHT;
+
+	if (lookaheadErrors) {
+		snprintf(text, sizeof(text), "Lookahead: %d underruns, %d samples dropped", (int)stats.lookaheadUnderruns, (int)stats.lookaheadOverflowFrames);
+		g.DrawText(overName, text, IRECT(x, y, x + w, y + TIMING_ROW_HEIGHT));
+		y += TIMING_ROW_HEIGHT;
+	}
+
+	for (size_t i = 0; i < columnCount; ++i) {
+		float cx = x + TIMING_NAME_WIDTH + TIMING_COLUMN_WIDTH * i;
+		g.DrawText(value, columns[i], IRECT(cx, y, cx + TIMING_COLUMN_WIDTH, y + TIMING_ROW_HEIGHT));
+	}
+
+	y += TIMING_ROW_HEIGHT;
+
+	for (const auto& row : rows) {
+		const PhaseStats& s = *row.second;
+		double load = stats.deadline > 0 ? s.p99 / stats.deadline * 100.0 : 0;
+		double values[] = { s.min, s.mean, s.p99, s.max, load };
+
+		g.DrawText(name, row.first.c_str(), IRECT(x, y, x + TIMING_NAME_WIDTH, y + TIMING_ROW_HEIGHT));
+
+		for (size_t i = 0; i < columnCount; ++i) {
+			float cx = x + TIMING_NAME_WIDTH + TIMING_COLUMN_WIDTH * i;
+			bool late = i == 3 && s.max > stats.deadline;
+
+			snprintf(text, sizeof(text), i == columnCount - 1 ? "%.1f" : "%.0f", values[i]);
+			g.DrawText(late ? over : value, text, IRECT(cx, y, cx + TIMING_COLUMN_WIDTH, y + TIMING_ROW_HEIGHT));
+		}
+
+		y += TIMING_ROW_HEIGHT;
+	}
 }
 
 void RetroPlugView::ProcessDialog() {
@@ -189,14 +277,22 @@ void RetroPlugView::ProcessDialog() {
 }
 
 void RetroPlugView::UpdateLayout() {
-	if (_views.empty()) {
-		for (size_t i = 0; i < MAX_SYSTEMS; ++i) {
-			_views.push_back(new SystemView(i, GetUI()));
+	// Views are only added, so lowering the system count leaves the extra ones hidden
+	size_t slotCount = _proxy->getSystemCount();
+	while (_views.size() < slotCount) {
+		_views.push_back(new SystemView((SystemIndex)_views.size(), GetUI()));
+	}
+
+	if (_atlas.getSlotCount() != slotCount) {
+		_atlas.setSlotCount(slotCount);
+
+		for (SystemView* view : _views) {
+			view->InvalidateSlot();
 		}
 	}
 
 	int zoom = _proxy->getProject()->settings.zoom;
-	for (size_t i = 0; i < MAX_SYSTEMS; ++i) {
+	for (size_t i = 0; i < _views.size(); ++i) {
 		_views[i]->HideText();
 		_views[i]->SetZoom(zoom);
 	}
@@ -232,17 +328,17 @@ void RetroPlugView::UpdateLayout() {
 		}
 	}
 
+	// Grids are as close to square as possible, filled a row at a time
+	size_t gridColumns = (size_t)std::ceil(std::sqrt((double)count));
+	size_t gridRows = (count + gridColumns - 1) / gridColumns;
+
 	if (layout == SystemLayout::Row) {
 		windowW = count * frameW;
 	} else if (layout == SystemLayout::Column) {
 		windowH = count * frameH;
 	} else if (layout == SystemLayout::Grid) {
-		if (count > 2) {
-			windowW = 2 * frameW;
-			windowH = 2 * frameH;
-		} else {
-			windowW = count * frameW;
-		}
+		windowW = gridColumns * frameW;
+		windowH = gridRows * frameH;
 	}
 
 	GetUI()->SetSizeConstraints(frameW, windowW, frameH, windowH);
@@ -261,12 +357,8 @@ void RetroPlugView::UpdateLayout() {
 		} else if (layout == SystemLayout::Column) {
 			gridY = i;
 		} else {
-			if (i < 2) {
-				gridX = i;
-			} else {
-				gridX = i - 2;
-				gridY = 1;
-			}
+			gridX = i % gridColumns;
+			gridY = i / gridColumns;
 		}
 
 		int x = gridX * frameW;
@@ -5,6 +5,7 @@
 #include <stack>
 #include "IControl.h"
 #include "SystemView.h"
+#include "FrameAtlas.h"
 //#include "controller/RetroPlugController.h"
 #include "util/cxxtimer.hpp"
 #include "platform/FileDialog.h"
@@ -20,6 +21,7 @@ class RetroPlugView : public IControl {
 private:
 	AudioContextProxy* _proxy;
 	std::vector<SystemView*> _views;
+	FrameAtlas _atlas;
 	SystemIndex _activeIdx = NO_ACTIVE_SYSTEM;
 
 	EHost _host;
@@ -72,4 +74,7 @@ private:
 	void UpdateSelected();
 
 	void ProcessDialog();
+
+	// Draws the audio block timings in the top left corner
+	void DrawTimings(IGraphics& g, const ProcessTimingStats& stats);
 };
@@ -23,48 +23,46 @@ SystemView::~SystemView() {
 }
 
 void SystemView::DeleteFrame() {
-	if (_imageId != -1) {
+	if (_hasFrame) {
 		NVGcontext* ctx = (NVGcontext*)_graphics->GetDrawContext();
-		nvgDeleteImage(ctx, _imageId);
 		nvgBeginPath(ctx);
 		nvgRect(ctx, _area.L, _area.T, _area.W(), _area.H());
 		NVGcolor black = { 0, 0, 0, 1 };
 		nvgFillColor(ctx, black);
 		nvgFill(ctx);
 
-		_imageId = -1;
-	}
-
-	if (_frameBuffer) {
-		delete[] _frameBuffer;
-		_frameBuffer = nullptr;
-		_frameBufferSize = 0;
+		_hasFrame = false;
 	}
 }
 
-void SystemView::WriteFrame(const VideoBuffer& buffer) {
-	const char* frameData = buffer.data.get();
-	if (frameData) {
-		if (buffer.data.count() > _frameBufferSize) {
-			if (_frameBuffer) {
-				delete[] _frameBuffer;
-			}
-
-			_dimensions = buffer.dimensions;
+bool SystemView::UpdateFrame(uint64_t instanceId, VideoTripleBuffer& video, FrameAtlas& atlas, bool visible) {
+	bool fresh = video.acquire();
 
-			_frameBufferSize = buffer.data.count();
-			_frameBuffer = new char[_frameBufferSize];
+	// Dirty lines are relative to the previous frame from the same instance, so a slot that was
+	// written from another instance (or skipped frames while hidden) needs the whole frame
+	if (instanceId != _instanceId) {
+		_instanceId = instanceId;
+		_slotValid = false;
+	}
 
-			if (_imageId != -1) {
-				NVGcontext* ctx = (NVGcontext*)_graphics->GetDrawContext();
-				nvgDeleteImage(ctx, _imageId);
-				_imageId = -1;
-			}
+	if (visible && video.hasFrontBuffer()) {
+		if (!_slotValid) {
+			atlas.write(_index, video.format(), video.getFrontBuffer(), DirtyRows { 0, (uint32_t)atlas.getFrameSize().h });
+			_slotValid = true;
+		} else if (fresh) {
+			atlas.write(_index, video.format(), video.getFrontBuffer(), video.getFrontRows());
 		}
 
-		memcpy(_frameBuffer, frameData, _frameBufferSize);
-		_frameDirty = true;
+		_hasFrame = true;
+	} else if (fresh) {
+		_slotValid = false;
 	}
+
+	uint32_t frameCount = video.getFrameCount();
+	bool ticked = frameCount != _frameCount;
+	_frameCount = frameCount;
+
+	return ticked;
 }
 
 void SystemView::ShowText(const std::string & row1, const std::string & row2) {
@@ -97,28 +95,18 @@ void SystemView::SetArea(const IRECT & area) {
 	UpdateTextPosition();
 }
 
-void SystemView::Draw(IGraphics& g, double delta) {
+void SystemView::Draw(IGraphics& g, const FrameAtlas& atlas, double delta) {
 	NVGcontext* vg = (NVGcontext*)g.GetDrawContext();
 	if (_index != NO_ACTIVE_SYSTEM) {
-		DrawPixelBuffer(vg);
+		DrawPixelBuffer(vg, atlas);
 	}
 }
 
-void SystemView::DrawPixelBuffer(NVGcontext* vg) {
-	if (_frameDirty && _frameBuffer) {
-		if (_imageId == -1) {
-			_imageId = nvgCreateImageRGBA(vg, _dimensions.w, _dimensions.h, NVG_IMAGE_NEAREST, (const unsigned char*)_frameBuffer);
-		} else {
-			nvgUpdateImage(vg, _imageId, (const unsigned char*)_frameBuffer);
-		}
-
-		_frameDirty = false;
-	}
-
-	if (_imageId != -1) {
+void SystemView::DrawPixelBuffer(NVGcontext* vg, const FrameAtlas& atlas) {
+	if (_hasFrame && atlas.valid()) {
 		nvgBeginPath(vg);
 
-		NVGpaint imgPaint = nvgImagePattern(vg, _area.L, _area.T, (float)(_dimensions.w * _zoom), (float)(_dimensions.h * _zoom), 0, _imageId, _alpha);
+		NVGpaint imgPaint = atlas.getPaint(vg, _index, _area.L, _area.T, _zoom, _alpha);
 		nvgRect(vg, _area.L, _area.T, _area.W(), _area.H());
 		nvgFillPaint(vg, imgPaint);
 		nvgFill(vg);
@@ -5,6 +5,7 @@
 #include "IControl.h"
 #include "nanovg.h"
 #include "util/RomWatcher.h"
+#include "FrameAtlas.h"
 
 #include "luawrapper/UiLuaContext.h"
 //#include "model/AudioContextProxy.h"
@@ -17,19 +18,19 @@ using namespace igraphics;
 
 class SystemView {
 private:
-	int _imageId = -1;
-	NVGpaint _imgPaint;
+	bool _hasFrame = false;
+
+	// The instance the atlas slot was last written from, and whether the slot still matches it.
+	// Ids are never reused, unlike the address of a freed buffer.
+	uint64_t _instanceId = 0;
+	bool _slotValid = false;
+	uint32_t _frameCount = 0;
 	float _alpha = 1.0f;
 
 	IPopupMenu _menu;
 
 	//std::map<std::string, int> _settings;
 
-	Dimension2 _dimensions;
-	char* _frameBuffer = nullptr;
-	size_t _frameBufferSize = 0;
-	bool _frameDirty = false;
-
 	SystemIndex _index;
 
 	IRECT _area;
@@ -46,7 +47,13 @@ public:
 
 	void SetZoom(int zoom) { _zoom = zoom; }
 
-	void WriteFrame(const VideoBuffer& buffer);
+	// Picks up the system's latest frame and, if visible, copies the lines that changed in to this
+	// view's slot of the atlas.  Returns true if the system finished a frame since the last call,
+	// including frames that were identical to the previous one and so never published.
+	bool UpdateFrame(uint64_t instanceId, VideoTripleBuffer& video, FrameAtlas& atlas, bool visible);
+
+	// The next update writes the whole frame, for when the atlas has lost its contents
+	void InvalidateSlot() { _slotValid = false; }
 
 	void ShowText(const std::string& row1, const std::string& row2);
 
@@ -60,12 +67,12 @@ public:
 
 	void SetAlpha(float alpha) { _alpha = alpha; }
 
-	void Draw(IGraphics& g, double delta);
+	void Draw(IGraphics& g, const FrameAtlas& atlas, double delta);
 
 	SystemIndex GetIndex() const { return _index; }
 
 	void DeleteFrame();
 
 private:
-	void DrawPixelBuffer(NVGcontext* vg);
+	void DrawPixelBuffer(NVGcontext* vg, const FrameAtlas& atlas);
 };
@@ -1,10 +1,13 @@
 #include "SameBoyPlug.h"
 
+#include <chrono>
 #include <fstream>
+#include <string.h>
+#include <string_view>
 #include <xxhash.h>
+#include <spdlog/spdlog.h>
 
 #include "retroplug/Constants.h"
-#include "retroplug/util/SampleConverter.h"
 #include "generated/bootroms/agb_boot.h"
 #include "generated/bootroms/cgb_boot.h"
 #include "generated/bootroms/cgb_boot_fast.h"
@@ -16,12 +19,24 @@ extern "C" {
 #include <gb.h>
 }
 
+// Minimum time between serial bytes, in 8MHz ticks
 const size_t LINK_TICKS_MAX = 3907;
 
-const size_t MAX_SERIAL_ITEMS = 128;
-const size_t MAX_BUTTON_ITEMS = 64;
+// One bit period of the external link clock.  Serial bits are clocked in at this rate, and
+// linked systems are scheduled in quanta of this length.
+const int LINK_BIT_TICKS = (int)(LINK_TICKS_MAX / 8);
+
 const GB_model_t DEFAULT_GAMEBOY_MODEL = GB_model_t::GB_MODEL_CGB_C;
 
+// Longest the boot ROM is given to finish when creating a boot state, in 8MHz ticks
+const uint64_t BOOT_TICK_LIMIT = 8388608ULL * 10;
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsedMicros(Clock::time_point start) {
+	return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+}
+
 
 GB_model_t getGameboyModelId(GameboyModel model) {
 	switch (model) {
@@ -53,12 +68,16 @@ std::string_view findBootRom(GameboyModel model, bool fastBoot) {
 	return std::string_view((const char*)cgb_boot, cgb_boot_len);
 }
 
-SameBoyPlug::SameBoyPlug() {
+static_assert(INDEXED_FRAME_WIDTH == PIXEL_WIDTH && INDEXED_FRAME_HEIGHT == PIXEL_HEIGHT, "Indexed frames must match the screen size");
+static_assert(INDEXED_PALETTE_SIZE == GB_INDEXED_PALETTE_SIZE, "Indexed palette size must match the core");
+
+SameBoyPlug::SameBoyPlug(VideoFormat videoFormat) {
 	_dimensions.w = PIXEL_WIDTH;
 	_dimensions.h = PIXEL_HEIGHT;
 
-	//_audioScratchSize = 256;
-	//_audioScratch = new int16_t[_audioScratchSize];
+	size_t frameSize = videoFormat == VideoFormat::Indexed ? sizeof(IndexedFrame) : PIXEL_COUNT * 4;
+	_video = std::make_shared<VideoTripleBuffer>(videoFormat, frameSize);
+	_state.video = _video.get();
 }
 
 void SameBoyPlug::pressButtons(const StreamButtonPress* presses, size_t pressCount) {
@@ -66,8 +85,9 @@ void SameBoyPlug::pressButtons(const StreamButtonPress* presses, size_t pressCou
 
 	for (size_t i = 0; i < pressCount; ++i) {
 		int offset = 0;
-		if (_state.buttonQueue.size() > 0) {
-			offset = _state.buttonQueue.back().offset + _state.buttonQueue.back().duration;
+		if (!_state.buttonQueue.empty()) {
+			OffsetButton last = _state.buttonQueue.back();
+			offset = last.offset + last.duration;
 		}
 
 		_state.buttonQueue.push(OffsetButton {
@@ -83,9 +103,130 @@ static uint32_t rgbEncode(GB_gameboy_t* gb, uint8_t r, uint8_t g, uint8_t b) {
 	return 255 << 24 | b << 16 | g << 8 | r;
 }
 
+// Captures the colours a line's indices refer to, adding a palette to the frame if they differ
+// from the previous line's.  Called before the first pixel of each line is rendered.
+static void indexedLineHandler(GB_gameboy_t* gb, uint8_t line) {
+	SameBoyPlugState* state = (SameBoyPlugState*)GB_get_user_data(gb);
+	IndexedFrame* frame = (IndexedFrame*)state->video->getBackBuffer();
+	if (line >= INDEXED_FRAME_HEIGHT) {
+		return;
+	}
+
+	uint32_t count = frame->paletteCount;
+	if (count < INDEXED_FRAME_HEIGHT) {
+		uint32_t* palette = frame->palettes[count];
+		GB_get_indexed_palette(gb, palette);
+
+		if (count == 0 || memcmp(palette, frame->palettes[count - 1], sizeof(frame->palettes[0])) != 0) {
+			frame->paletteCount = ++count;
+		}
+	}
+
+	frame->linePalettes[line] = (uint8_t)(count - 1);
+}
+
+static void setIndexedOutput(GB_gameboy_t* gb, uint8_t* buffer) {
+	IndexedFrame* frame = (IndexedFrame*)buffer;
+	frame->paletteCount = 0;
+	memset(frame->linePalettes, 0, sizeof(frame->linePalettes));
+	GB_set_pixels_output_indexed(gb, frame->pixels, indexedLineHandler);
+}
+
+// Hashes each line of the back buffer and compares it with the same line of the last published
+// frame.  Indexed lines are hashed along with the colours they refer to, so palette changes count.
+static DirtyRows findDirtyRows(SameBoyPlugState* state) {
+	const uint8_t* buffer = state->video->getBackBuffer();
+	bool indexed = state->video->format() == VideoFormat::Indexed;
+
+	uint64_t paletteHashes[INDEXED_FRAME_HEIGHT];
+	if (indexed) {
+		const IndexedFrame* frame = (const IndexedFrame*)buffer;
+		for (uint32_t i = 0; i < frame->paletteCount; ++i) {
+			paletteHashes[i] = XXH3_64bits(frame->palettes[i], sizeof(frame->palettes[i]));
+		}
+	}
+
+	DirtyRows rows;
+	for (uint32_t y = 0; y < PIXEL_HEIGHT; ++y) {
+		uint64_t hash;
+		if (indexed) {
+			const IndexedFrame* frame = (const IndexedFrame*)buffer;
+			hash = XXH3_64bits_withSeed(frame->pixels + y * PIXEL_WIDTH, PIXEL_WIDTH, paletteHashes[frame->linePalettes[y]]);
+		} else {
+			hash = XXH3_64bits(buffer + y * PIXEL_WIDTH * 4, PIXEL_WIDTH * 4);
+		}
+
+		if (!state->rowHashesValid || hash != state->rowHashes[y]) {
+			if (rows.empty()) {
+				rows.top = y;
+			}
+
+			rows.bottom = y + 1;
+			state->rowHashes[y] = hash;
+		}
+	}
+
+	state->rowHashesValid = true;
+	return rows;
+}
+
 static void vblankHandler(GB_gameboy_t* gb, GB_vblank_type_t type) {
 	SameBoyPlugState* state = (SameBoyPlugState*)GB_get_user_data(gb);
 	state->vblankOccurred = true;
+
+	// Repeated frames keep the previous image on screen, and nothing is drawn while rendering is off
+	if (type == GB_VBLANK_TYPE_REPEAT || state->renderingDisabled) {
+		return;
+	}
+
+	Clock::time_point start;
+	if (state->timingEnabled) {
+		start = Clock::now();
+	}
+
+	VideoTripleBuffer* video = state->video;
+	video->countFrame();
+
+	bool indexed = video->format() == VideoFormat::Indexed;
+	if (indexed) {
+		// Frames where no lines were rendered (the LCD is off) still need a palette
+		IndexedFrame* frame = (IndexedFrame*)video->getBackBuffer();
+		if (frame->paletteCount == 0) {
+			GB_get_indexed_palette(gb, frame->palettes[0]);
+			frame->paletteCount = 1;
+		}
+	}
+
+	// A frame identical to the last one isn't published, the next frame is rendered over it
+	DirtyRows rows = findDirtyRows(state);
+	uint8_t* next = rows.empty() ? video->getBackBuffer() : video->publish(rows);
+
+	if (indexed) {
+		setIndexedOutput(gb, next);
+	} else {
+		GB_set_pixels_output(gb, (uint32_t*)next);
+	}
+
+	if (state->timingEnabled) {
+		state->videoMicros += elapsedMicros(start);
+	}
+}
+
+static void discardSamples(GB_gameboy_t* gb, GB_sample_t* sample) {
+}
+
+// The core's log output would otherwise go to stdout, which the command line tools use.  It is
+// logged at debug level, as the core reports things like writes to unmapped registers, which
+// the boot ROMs and many games do on the audio thread.
+static void logHandler(GB_gameboy_t* gb, const char* string, GB_log_attributes attributes) {
+	std::string_view line(string);
+	while (!line.empty() && line.back() == '\n') {
+		line.remove_suffix(1);
+	}
+
+	if (!line.empty()) {
+		spdlog::debug("SameBoy: {}", line);
+	}
 }
 
 static void audioHandler(GB_gameboy_t* gb, GB_sample_t* sample) {
@@ -98,6 +239,7 @@ static void audioHandler(GB_gameboy_t* gb, GB_sample_t* sample) {
 static void serialStart(GB_gameboy_t* gb, bool bit_received) {
 	SameBoyPlugState* s = (SameBoyPlugState*)GB_get_user_data(gb);
 	s->bitToSend = bit_received;
+	GB_request_run_stop(gb);
 }
 
 static bool serialEnd(GB_gameboy_t* gb) {
@@ -119,13 +261,15 @@ static void loadBootRomHandler(GB_gameboy_t* gb, GB_boot_rom_t type) {
 }
 
 void SameBoyPlug::init(GameboyModel model) {
-	assert(_state.gb == nullptr);
-
-	_state.gb = new GB_gameboy_t();
-
-	GB_init(_state.gb, getGameboyModelId(model));
+	if (_state.gb) {
+		// Prepared ahead of time, possibly as a different model
+		GB_switch_model_and_reset(_state.gb, getGameboyModelId(model));
+	} else {
+		_state.gb = new GB_gameboy_t();
+		GB_init(_state.gb, getGameboyModelId(model));
+	}
 
-	GB_set_pixels_output(_state.gb, (uint32_t*)_state.frameBuffer);
+	setupVideoOutput();
 	GB_set_sample_rate(_state.gb, 44100);
 	GB_set_user_data(_state.gb, &_state);
 
@@ -136,10 +280,52 @@ void SameBoyPlug::init(GameboyModel model) {
 	GB_set_serial_transfer_bit_start_callback(_state.gb, serialStart);
 	GB_set_serial_transfer_bit_end_callback(_state.gb, serialEnd);
 
+	// The debugger polls stdin for commands unless this is cleared
+	GB_set_async_input_callback(_state.gb, nullptr);
+	GB_set_log_callback(_state.gb, logHandler);
+
+	// Otherwise the core formats every line on the audio thread, only for spdlog to drop it
+	GB_set_log_disabled(_state.gb, !spdlog::default_logger_raw()->should_log(spdlog::level::debug));
+
 	GB_set_color_correction_mode(_state.gb, GB_COLOR_CORRECTION_MODERN_BALANCED);
 	GB_set_highpass_filter_mode(_state.gb, GB_HIGHPASS_ACCURATE);
 
 	GB_set_rendering_disabled(_state.gb, true);
+	_state.renderingDisabled = true;
+}
+
+void SameBoyPlug::setupVideoOutput() {
+	_state.rowHashesValid = false;
+
+	if (_video->format() == VideoFormat::Indexed) {
+		setIndexedOutput(_state.gb, _video->getBackBuffer());
+	} else {
+		GB_set_pixels_output(_state.gb, (uint32_t*)_video->getBackBuffer());
+	}
+}
+
+void SameBoyPlug::attachRom(SharedRomPtr rom, const char* data, size_t size) {
+	_rom = std::move(rom);
+	if (!GB_load_rom_shared(_state.gb, _rom->data(), _rom->size())) {
+		_rom = nullptr;
+		GB_load_rom_from_buffer(_state.gb, (const uint8_t*)data, size);
+	}
+
+	size_t sramSize;
+	uint16_t bank;
+	GB_get_direct_access(_state.gb, GB_DIRECT_ACCESS_CART_RAM, &sramSize, &bank);
+
+	_sramPageCount = (sramSize + (1 << GB_MBC_RAM_PAGE_SHIFT) - 1) >> GB_MBC_RAM_PAGE_SHIFT;
+	_dirtyPages.assign((_sramPageCount + 63) / 64, 0);
+	_changedPages.assign(_dirtyPages.size(), 0);
+	GB_set_mbc_ram_dirty_bitmap(_state.gb, _dirtyPages.data(), _dirtyPages.size());
+
+	_batteryScratch.resize((size_t)GB_save_battery_size(_state.gb));
+}
+
+void SameBoyPlug::prepare(GameboyModel model) {
+	_state.model = model;
+	init(model);
 }
 
 void SameBoyPlug::loadRom(const char* data, size_t size, const SameBoySettings& settings, bool fastBoot) {
@@ -149,19 +335,102 @@ void SameBoyPlug::loadRom(const char* data, size_t size, const SameBoySettings&
 	_state.fastBoot = fastBoot;
 
 	init(settings.model);
+	attachRom(shareRom(data, size), data, size);
+
+	// Starting from a cached state skips the boot ROM, and with it the silence that covers it.
+	// The first time a ROM is loaded on a model, the boot ROM is run here to create the state.
+	// The state is loaded either way, so cold and cached loads start from the same point.
+	_bootState = nullptr;
+	if (BootStateCache::enabled()) {
+		uint64_t romHash = _rom ? _rom->hash() : XXH3_64bits(data, size);
+		_bootState = BootStateCache::find(romHash, settings.model, fastBoot);
+
+		if (!_bootState || !restoreBootState()) {
+			_bootState = runBootRom(romHash);
+			if (_bootState && !restoreBootState()) {
+				_bootState = nullptr;
+			}
+		}
+	}
 
-	GB_load_rom_from_buffer(_state.gb, (const uint8_t*)data, size);
-	GB_set_rendering_disabled(_state.gb, false);
+	disableRendering(false);
 
-	_resetSamples = (int)(_sampleRate / 2);
+	_resetSamples = _bootState ? 0 : (int)(_sampleRate / 2);
+}
+
+void SameBoyPlug::loadRomForCopy(const SharedRomPtr& rom, const SameBoySettings& settings, bool fastBoot) {
+	_settings = settings;
+
+	_state.model = settings.model;
+	_state.fastBoot = fastBoot;
+
+	if (!_state.gb || GB_get_model(_state.gb) != getGameboyModelId(settings.model)) {
+		init(settings.model);
+	}
+
+	attachRom(rom, (const char*)rom->data(), rom->romSize());
+
+	// Kept for later resets.  The copied state replaces whatever the core booted in to.
+	_bootState = BootStateCache::find(rom->hash(), settings.model, fastBoot);
+
+	disableRendering(false);
+}
+
+bool SameBoyPlug::copyStateFrom(const SameBoyPlug& source) {
+	if (!GB_copy_state(_state.gb, source._state.gb)) {
+		return false;
+	}
+
+	// The frame being drawn carries on from where the source was
+	if (_video->format() == source._video->format()) {
+		memcpy(_video->getBackBuffer(), source._video->getBackBuffer(), _video->frameSize());
+	}
+
+	// GB_copy_state marks all of the cart RAM as written
+	_state.rowHashesValid = false;
+	_resetSamples = source._resetSamples;
+
+	return true;
+}
+
+SameBoyPlugPtr SameBoyPlug::clone() const {
+	SharedRomPtr rom = _rom;
+	if (!rom) {
+		size_t romSize;
+		uint16_t bank;
+		const char* romData = (const char*)GB_get_direct_access(_state.gb, GB_DIRECT_ACCESS_ROM, &romSize, &bank);
+		rom = shareRom(romData, romSize);
+	}
+
+	SameBoyPlugPtr plug = std::make_shared<SameBoyPlug>(_video->format());
+	plug->setDesc(_desc);
+	plug->loadRomForCopy(rom, _settings, _state.fastBoot);
+	plug->setSampleRate(_sampleRate);
+	plug->setGain(_gain);
+
+	if (!plug->copyStateFrom(*this)) {
+		std::vector<char> state(GB_get_save_state_size(_state.gb));
+		GB_save_state_to_buffer(_state.gb, (uint8_t*)state.data());
+		plug->loadState(state.data(), state.size());
+	}
+
+	return plug;
 }
 
 void SameBoyPlug::reset(GameboyModel model, bool fastBoot) {
 	_settings.model = model;
 
+	// The boot state can only be loaded over the model it was taken on
+	bool restore = _bootState && _bootState->model == model && _state.model == model;
+
 	_state.model = model;
 	_state.fastBoot = fastBoot;
 
+	if (restore && restoreBootState()) {
+		_resetSamples = 0;
+		return;
+	}
+
 	GB_switch_model_and_reset(_state.gb, getGameboyModelId(model));
 
 	_resetSamples = (int)(_sampleRate / 2);
@@ -191,24 +460,59 @@ DataBuffer<char> SameBoyPlug::getSramData() {
 	return DataBuffer<char>((char*)data, size, false);
 }
 
-uint64_t SameBoyPlug::hashSram(size_t start, size_t size) {
-	size_t dataSize;
-	uint16_t bank;
-	char* data = (char*)GB_get_direct_access(_state.gb, GB_DIRECT_ACCESS_CART_RAM, &dataSize, &bank);
+void SameBoyPlug::collectDirtyPages() {
+	bool written = false;
+
+	for (size_t i = 0; i < _dirtyPages.size(); ++i) {
+		if (_dirtyPages[i]) {
+			_changedPages[i] |= _dirtyPages[i];
+			_dirtyPages[i] = 0;
+			written = true;
+		}
+	}
 
-	if (start >= dataSize) {
-		return 0;
+	if (written) {
+		_sramGeneration++;
 	}
-	
-	if (size == 0) {
-		size = dataSize - start;
+}
+
+size_t SameBoyPlug::consumeDirtyPages(uint64_t* target, size_t wordCount) {
+	collectDirtyPages();
+
+	size_t count = 0;
+
+	for (size_t i = 0; i < _changedPages.size(); ++i) {
+		uint64_t bits = _changedPages[i];
+		if (bits) {
+			if (target && i < wordCount) {
+				target[i] |= bits;
+			}
+
+			for (; bits; bits &= bits - 1) {
+				count++;
+			}
+
+			_changedPages[i] = 0;
+		}
 	}
 
-	return XXH3_64bits(data + start, size);
+	return count;
+}
+
+uint64_t SameBoyPlug::getSramGeneration() {
+	collectDirtyPages();
+	return _sramGeneration;
+}
+
+void SameBoyPlug::markAllPagesDirty() {
+	for (size_t i = 0; i < _sramPageCount; ++i) {
+		_dirtyPages[i / 64] |= 1ULL << (i % 64);
+	}
 }
 
 bool SameBoyPlug::loadSram(const char* data, size_t size, bool reset) {
 	GB_load_battery_from_buffer(_state.gb, (const uint8_t*)data, size);
+	markAllPagesDirty();
 
 	if (reset) {
 		this->reset(_settings.model, true);
@@ -240,6 +544,7 @@ size_t SameBoyPlug::saveState(char* target, size_t size) {
 void SameBoyPlug::loadState(const char* source, size_t size) {
 	assert(GB_get_save_state_size(_state.gb) == size);
 	GB_load_state_from_buffer(_state.gb, (const uint8_t*)source, size);
+	markAllPagesDirty();
 }
 
 void SameBoyPlug::setSetting(const std::string& name, int value) {
@@ -269,98 +574,145 @@ void SameBoyPlug::sendSerialByte(int offset, int byte) {
 // This is called from the audio thread
 void SameBoyPlug::update(size_t audioFrames) {
 	_state.vblankOccurred = false;
+	_state.videoMicros = 0;
+
+	Clock::time_point start;
+	if (_state.timingEnabled) {
+		start = Clock::now();
+	}
 
-	int delta = 0;
 	while (_state.currentAudioFrames < audioFrames) {
-		// Send bytes to the link port if required
-		if (_state.linkTicksRemain <= 0) {
-			if (!_state.serialQueue.empty()) {
-				OffsetByte b = _state.serialQueue.front();
-				_state.serialQueue.pop();
-
-				for (int i = b.bitCount - 1; i >= 0; i--) {
-					bool bit = (bool)((b.byte & (1 << i)) >> i);
-					GB_serial_set_data_bit(_state.gb, bit);
-				}
+		int frame = (int)_state.currentAudioFrames;
+
+		// Start clocking in the next serial byte once its offset has been reached and the link
+		// period of the previous byte has passed
+		if (_state.serialBitsRemain == 0 && _state.linkTicksRemain <= 0) {
+			if (!_state.serialQueue.empty() && _state.serialQueue.frontOffset() <= frame) {
+				_state.serialByte = _state.serialQueue.pop();
+				_state.serialBitsRemain = _state.serialByte.bitCount;
+				_state.serialBitTicks = 0;
+				_state.linkTicksRemain = (int)LINK_TICKS_MAX;
 			}
+		}
 
-			_state.linkTicksRemain += LINK_TICKS_MAX;
+		// Bits are sent one at a time at the rate of the external clock
+		if (_state.serialBitsRemain > 0 && _state.serialBitTicks <= 0) {
+			_state.serialBitsRemain--;
+			bool bit = (bool)((_state.serialByte.byte >> _state.serialBitsRemain) & 1);
+			GB_serial_set_data_bit(_state.gb, bit);
+			_state.serialBitTicks += LINK_BIT_TICKS;
 		}
 
 		// Send button presses if required
-		while (!_state.buttonQueue.empty() && _state.buttonQueue.front().offset <= _state.currentAudioFrames) {
-			OffsetButton b = _state.buttonQueue.front();
-			_state.buttonQueue.pop();
+		while (!_state.buttonQueue.empty() && _state.buttonQueue.frontOffset() <= frame) {
+			OffsetButton b = _state.buttonQueue.pop();
 
 			GB_set_key_state(_state.gb, (GB_key_t)b.button, b.down);
 		}
 
-		int ticks = GB_run(_state.gb);
-		delta += ticks;
-		_state.linkTicksRemain -= ticks;
-	}
+		// Let the core run until the next pending event - the next button press, the next serial
+		// bit, the next serial byte, or the end of the block.  Sample offsets are counted against
+		// the samples the APU actually outputs, so events land on the exact sample they target.
+		size_t sampleTarget = audioFrames;
+		if (!_state.buttonQueue.empty()) {
+			sampleTarget = std::min(sampleTarget, (size_t)_state.buttonQueue.frontOffset());
+		}
 
-	size_t buttonRemain = _state.buttonQueue.size();
-	for (size_t i = 0; i < buttonRemain; i++) {
-		OffsetButton button = _state.buttonQueue.front();
-		button.offset -= _state.currentAudioFrames;
-		_state.buttonQueue.push(button);
-		_state.buttonQueue.pop();
-	}
+		uint64_t cycleLimit = 0;
+		if (_state.serialBitsRemain > 0) {
+			cycleLimit = (uint64_t)_state.serialBitTicks;
+		} else if (!_state.serialQueue.empty()) {
+			if (_state.linkTicksRemain > 0) {
+				cycleLimit = (uint64_t)_state.linkTicksRemain;
+			} else {
+				sampleTarget = std::min(sampleTarget, (size_t)_state.serialQueue.frontOffset());
+			}
+		}
 
-	// If there are any serial/midi events that still haven't been processed, set their
-	// offsets to 0 so they get processed immediately at the start of the next frame.
-	size_t serialRemain = _state.serialQueue.size();
-	for (size_t i = 0; i < serialRemain; i++) {
-		OffsetByte b = _state.serialQueue.front();
-		b.offset = 0;
-		_state.serialQueue.push(b);
-		_state.serialQueue.pop();
+		unsigned sampleLimit = (unsigned)(sampleTarget - _state.currentAudioFrames);
+		int ticks = (int)GB_run_until(_state.gb, cycleLimit, sampleLimit);
+
+		_state.linkTicksRemain = std::max(_state.linkTicksRemain - ticks, 0);
+		if (_state.serialBitsRemain > 0) {
+			_state.serialBitTicks -= ticks;
+		}
 	}
+
+	// Any serial/midi events that still haven't been processed end up with offsets <= 0, so
+	// they get processed immediately at the start of the next frame.
+	_state.buttonQueue.rebase((int)_state.currentAudioFrames);
+	_state.serialQueue.rebase((int)_state.currentAudioFrames);
 	
 	updateAV(audioFrames);
+
+	if (_state.timingEnabled) {
+		_state.updateMicros = elapsedMicros(start);
+	}
 }
 
 void SameBoyPlug::updateMultiple(SameBoyPlug** plugs, size_t plugCount, size_t audioFrames) {
 	SameBoyPlugState* st[MAX_SYSTEMS];
+	int clocks[MAX_SYSTEMS] = { 0 };
+
 	for (size_t i = 0; i < plugCount; i++) {
 		st[i] = plugs[i]->getState();
 		st[i]->vblankOccurred = false;
+		st[i]->updateMicros = 0;
+		st[i]->videoMicros = 0;
 	}
 
+	// Systems are advanced in lockstep, one quantum of the link clock at a time.  Each round
+	// first finds the earliest serial bit any system will clock, and ends the round there, so
+	// every system reaches the same point before the bit is exchanged whatever order they run in.
+	int target = 0;
 	size_t complete = 0;
+
 	while (complete != plugCount) {
 		complete = 0;
+		target += LINK_BIT_TICKS;
+
+		for (size_t i = 0; i < plugCount; i++) {
+			if (st[i]->currentAudioFrames < audioFrames && clocks[i] < target) {
+				uint64_t ticks = GB_get_ticks_until_serial_bit(st[i]->gb);
+				if (ticks < (uint64_t)(target - clocks[i])) {
+					target = clocks[i] + (int)ticks;
+				}
+			}
+		}
+
 		for (size_t i = 0; i < plugCount; i++) {
 			SameBoyPlugState* s = st[i];
 
-			if (s->currentAudioFrames < audioFrames) {
-				// Send button presses if required
-				while (!s->buttonQueue.empty() && s->buttonQueue.front().offset <= s->currentAudioFrames) {
-					OffsetButton b = s->buttonQueue.front();
-					s->buttonQueue.pop();
+			if (s->currentAudioFrames >= audioFrames) {
+				complete++;
+				continue;
+			}
+
+			// Send button presses if required
+			while (!s->buttonQueue.empty() && s->buttonQueue.frontOffset() <= (int)s->currentAudioFrames) {
+				OffsetButton b = s->buttonQueue.pop();
+
+				GB_set_key_state(s->gb, (GB_key_t)b.button, b.down);
+			}
 
-					GB_set_key_state(s->gb, (GB_key_t)b.button, b.down);
+			if (clocks[i] < target) {
+				Clock::time_point start;
+				if (s->timingEnabled) {
+					start = Clock::now();
 				}
 
-				GB_run(s->gb);
-			} else {
-				complete++;
+				clocks[i] += (int)GB_run_until(s->gb, target - clocks[i], (unsigned)(audioFrames - s->currentAudioFrames));
+
+				if (s->timingEnabled) {
+					s->updateMicros += elapsedMicros(start);
+				}
 			}
 		}
 	}
 
 	for (size_t i = 0; i < plugCount; i++) {
-		SameBoyPlugState* s = st[i];
-		size_t buttonRemain = s->buttonQueue.size();
-
-		for (size_t i = 0; i < buttonRemain; i++) {
-			OffsetButton button = s->buttonQueue.front();
-			button.offset -= s->currentAudioFrames;
-			s->buttonQueue.push(button);
-			s->buttonQueue.pop();
-		}
-	}	
+		st[i]->buttonQueue.rebase((int)st[i]->currentAudioFrames);
+	}
 
 	for (size_t i = 0; i < plugCount; i++) {
 		plugs[i]->updateAV(audioFrames);
@@ -369,21 +721,37 @@ void SameBoyPlug::updateMultiple(SameBoyPlug** plugs, size_t plugCount, size_t a
 
 void SameBoyPlug::disableRendering(bool disable) {
 	GB_set_rendering_disabled(_state.gb, disable);
+	_state.renderingDisabled = disable;
 }
 
-void SameBoyPlug::setRomData(DataBuffer<char>* data) {
-	size_t size;
-	uint16_t bank;
-	void* rom = GB_get_direct_access(_state.gb, GB_DIRECT_ACCESS_ROM, &size, &bank);
+SharedRomPtr SameBoyPlug::shareRom(const char* data, size_t size) {
+	return RomStore::acquire(data, size, GB_get_padded_rom_size(size));
+}
 
-	if (size <= data->size()) {
-		memcpy(rom, data->data(), data->size());
+bool SameBoyPlug::setRom(SharedRomPtr& rom) {
+	// Replacing a private copy would free it here
+	if (!_rom || !GB_replace_rom_shared(_state.gb, rom->data(), rom->size())) {
+		return false;
 	}
+
+	if (_bootState && _bootState->romHash != rom->hash()) {
+		_bootState = nullptr;
+	}
+
+	std::swap(_rom, rom);
+	return true;
 }
 
 void SameBoyPlug::patchMemory(DirectAccessType::Enum memoryType, DataBuffer<char>* data, size_t offset) {
 	size_t size;
 	uint16_t bank;
+	if (memoryType == DirectAccessType::Rom) {
+		// Other systems may be reading the same ROM, and the boot state may not match any more
+		GB_unshare_rom(_state.gb);
+		_rom = nullptr;
+		_bootState = nullptr;
+	}
+
 	char* target = (char*)GB_get_direct_access(_state.gb, (GB_direct_access_t)memoryType, &size, &bank);
 
 	if (offset + data->size() <= size) {
@@ -391,36 +759,56 @@ void SameBoyPlug::patchMemory(DirectAccessType::Enum memoryType, DataBuffer<char
 	}
 }
 
-void SameBoyPlug::updateAV(int audioFrames) {
-	int sampleCount = audioFrames * 2;
-	/*if (sampleCount > _audioScratchSize) {
-		if (_audioScratch) {
-			delete[] _audioScratch;
-		}
+BootStatePtr SameBoyPlug::runBootRom(uint64_t romHash) {
+	// Nothing is heard of the boot, and rendering is still disabled so nothing is seen either
+	GB_apu_set_sample_callback(_state.gb, discardSamples);
+
+	uint64_t ticks = 0;
+	while (!GB_is_boot_rom_finished(_state.gb) && ticks < BOOT_TICK_LIMIT) {
+		ticks += GB_run(_state.gb);
+	}
+
+	GB_apu_set_sample_callback(_state.gb, audioHandler);
+
+	if (!GB_is_boot_rom_finished(_state.gb)) {
+		return nullptr;
+	}
+
+	std::vector<char> data((size_t)GB_get_save_state_size(_state.gb));
+	GB_save_state_to_buffer(_state.gb, (uint8_t*)data.data());
+
+	return BootStateCache::add(romHash, _settings.model, _state.fastBoot, std::move(data));
+}
+
+bool SameBoyPlug::restoreBootState() {
+	// Like a reset, the battery (cart RAM and RTC) is kept
+	size_t batterySize = (size_t)GB_save_battery_size(_state.gb);
+	if (batterySize > _batteryScratch.size()) {
+		return false;
+	}
+
+	GB_save_battery_to_buffer(_state.gb, _batteryScratch.data(), batterySize);
+	int err = GB_load_state_from_buffer(_state.gb, (const uint8_t*)_bootState->data.data(), _bootState->data.size());
+	GB_load_battery_from_buffer(_state.gb, _batteryScratch.data(), batterySize);
+
+	_state.rowHashesValid = false;
 
-		std::cout << "Resizing to: " << sampleCount * 2 << std::endl;
-		_audioScratch = new int16_t[sampleCount * 2];
-		_audioScratchSize = sampleCount;
-	}*/
+	return err == 0;
+}
+
+void SameBoyPlug::updateAV(int audioFrames) {
+	// Samples stay in the scratch buffer and are converted as they are mixed
+	_audioFrames = (size_t)audioFrames;
+	_audioReady = false;
 
-	if (sampleCount <= AUDIO_SCRATCH_SIZE) {
+	if ((size_t)audioFrames <= AUDIO_SCRATCH_SIZE) {
 		if (_resetSamples <= 0) {
-			SampleConverter::s16_to_f32(_audioBuffer->data->data(), (int16_t*)_state.audioBuffer, sampleCount);
+			_audioReady = true;
 		} else {
-			_audioBuffer->data->clear();
 			_resetSamples -= audioFrames;
 		}
 
 		_state.currentAudioFrames = 0;
-	} else {
-		_audioBuffer->data->clear();
-	}
-
-	if (_videoBuffer->data.get()) {
-		if (_state.vblankOccurred) {
-			memcpy(_videoBuffer->data.get(), _state.frameBuffer, FRAME_BUFFER_SIZE);
-			_videoBuffer->hasData = true;
-		}
 	}
 }
 
@@ -430,10 +818,4 @@ void SameBoyPlug::shutdown() {
 		delete _state.gb;
 		_state.gb = nullptr;
 	}
-
-	if (_audioScratch) {
-		delete[] _audioScratch;
-		_audioScratch = nullptr;
-		_audioScratchSize = 0;
-	}
 }
@@ -1,9 +1,11 @@
 #pragma once
 
 #include <vector>
-#include <queue>
 
 #include "retroplug/Messages.h"
+#include "model/BootStateCache.h"
+#include "util/EventRing.h"
+#include "util/VideoTripleBuffer.h"
 
 struct GB_gameboy_s;
 typedef struct GB_gameboy_s GB_gameboy_t;
@@ -11,14 +13,19 @@ typedef struct GB_gameboy_s GB_gameboy_t;
 const size_t PIXEL_WIDTH = 160;
 const size_t PIXEL_HEIGHT = 144;
 const size_t PIXEL_COUNT = (PIXEL_WIDTH * PIXEL_HEIGHT);
-const size_t FRAME_BUFFER_SIZE = (PIXEL_COUNT * 4);
 const size_t AUDIO_SCRATCH_SIZE = 1024 * 8;
+const size_t MAX_SERIAL_ITEMS = 256;
+const size_t MAX_BUTTON_ITEMS = 256;
 
 class SameBoyPlug;
 using SameBoyPlugPtr = std::shared_ptr<SameBoyPlug>;
 
 struct SameBoyPlugDesc {
 	std::string romName;
+
+	// Matches SystemDesc::instanceId, so messages about this system can be told apart from
+	// messages about whatever replaces it in the same slot
+	uint64_t instanceId = 0;
 };
 
 struct OffsetButton {
@@ -57,14 +64,21 @@ struct DirectAccessType {
 
 struct SameBoyPlugState {
 	GB_gameboy_t* gb = nullptr;
-	char frameBuffer[FRAME_BUFFER_SIZE];
+	VideoTripleBuffer* video = nullptr;
+	bool renderingDisabled = true;
+	uint64_t rowHashes[PIXEL_HEIGHT];
+	bool rowHashesValid = false;
 	GameboySample audioBuffer[AUDIO_SCRATCH_SIZE];
 	size_t currentAudioFrames = 0;
-	std::queue<OffsetButton> buttonQueue;
-	std::queue<OffsetByte> serialQueue;
+	EventRing<OffsetButton, MAX_BUTTON_ITEMS> buttonQueue;
+	EventRing<OffsetByte, MAX_SERIAL_ITEMS> serialQueue;
 	bool vblankOccurred = false;
 	int linkTicksRemain = 0;
 
+	OffsetByte serialByte = {};
+	int serialBitsRemain = 0;
+	int serialBitTicks = 0;
+
 	GameboyModel model = GameboyModel::Auto;
 	bool fastBoot = false;
 
@@ -73,6 +87,12 @@ struct SameBoyPlugState {
 	std::vector<SameBoyPlugState*> linkTargets;
 
 	bool bitToSend;
+
+	// Time spent in the last update, and the part of it spent publishing video frames.  Only
+	// measured when timing is enabled.
+	bool timingEnabled = false;
+	double updateMicros = 0;
+	double videoMicros = 0;
 };
 
 class SameBoyPlug {
@@ -83,31 +103,37 @@ private:
 	SameBoySettings _settings;
 
 	int _resetSamples = 0;
+	size_t _audioFrames = 0;
+	bool _audioReady = false;
+	float _gain = 1.0f;
 
 	double _sampleRate = 48000;
 
 	Dimension2 _dimensions;
-	VideoBuffer* _videoBuffer;
-	AudioBuffer* _audioBuffer;
+	VideoTripleBufferPtr _video;
 
-	int16_t* _audioScratch = nullptr;
-	size_t _audioScratchSize = 0;
+	// The ROM the core reads from, shared with every other system running the same one.  Null if
+	// the core has its own copy.
+	SharedRomPtr _rom;
 
-	uint64_t _sramHash = 0;
+	// One bit per 256 byte page of cart RAM, set by the core when the game writes to a page.
+	// Collected in to _changedPages, which consumeDirtyPages clears, and counted by
+	// _sramGeneration, which anything can compare against without affecting the other readers.
+	std::vector<uint64_t> _dirtyPages;
+	std::vector<uint64_t> _changedPages;
+	uint64_t _sramGeneration = 0;
+	size_t _sramPageCount = 0;
 
-public:
-	SameBoyPlug();
-	~SameBoyPlug() { shutdown(); }
+	// The state of the loaded ROM straight after booting, restored on reset instead of running
+	// the boot ROM again.  Null if the cache is disabled.
+	BootStatePtr _bootState;
 
-	bool sramHasChanged() {
-		uint64_t hash = hashSram();
-		if (hash != _sramHash) {
-			_sramHash = hash;
-			return true;
-		}
+	// Holds the battery while a boot state is restored over it
+	std::vector<uint8_t> _batteryScratch;
 
-		return false;
-	}
+public:
+	SameBoyPlug(VideoFormat videoFormat = VideoFormat::Rgba);
+	~SameBoyPlug() { shutdown(); }
 
 	const SameBoyPlugDesc& getDesc() const { return _desc; }
 
@@ -115,23 +141,51 @@ public:
 
 	void pressButtons(const StreamButtonPress* presses, size_t pressCount);
 
+	// Allocates and initialises the core ahead of loadRom(), which then only has to switch the
+	// model if it differs and load the ROM
+	void prepare(GameboyModel model);
+
 	void loadRom(const char* data, size_t size, const SameBoySettings& settings, bool fastBoot);
 
+	// Loads a ROM without booting it, for a system that copyStateFrom is about to overwrite.  The
+	// model is only switched if the prepared core differs.
+	void loadRomForCopy(const SharedRomPtr& rom, const SameBoySettings& settings, bool fastBoot);
+
+	// Makes this system an exact copy of source, which must be running the same ROM on the same
+	// model.  Nothing is allocated, so this is safe on the audio thread.  Returns false if the
+	// systems aren't compatible.
+	bool copyStateFrom(const SameBoyPlug& source);
+
+	// Creates a new system running the same ROM from exactly the same point as this one
+	SameBoyPlugPtr clone() const;
+
 	bool watchRom() const { return false; }
 
 	Dimension2 getDimensions() const { return _dimensions; }
 
 	SameBoyPlugState* getState() { return &_state; }
 
-	void setBuffers(VideoBuffer* video, AudioBuffer* audio) {
-		_videoBuffer = video;
-		_audioBuffer = audio;
+	// Frames are rendered directly in to this and picked up by the UI
+	VideoTripleBufferPtr getVideo() const { return _video; }
+
+	// Interleaved stereo samples generated by the last update, or nullptr if the system
+	// should be silent for this block.
+	const int16_t* getAudioSamples() const {
+		return _audioReady ? (const int16_t*)_state.audioBuffer : nullptr;
 	}
 
+	size_t getAudioFrameCount() const { return _audioFrames; }
+
+	float getGain() const { return _gain; }
+
+	void setGain(float gain) { _gain = gain; }
+
 	const SameBoySettings& getSettings() const { return _settings; }
 
 	void setSettings(const SameBoySettings& settings) { _settings = settings; }
 
+	// Resets the system.  If there's a boot state for the model, it's restored instead of running
+	// the boot ROM, and the system isn't muted while it starts.
 	void reset(GameboyModel model, bool fast);
 
 	bool active() const { return _state.gb != nullptr; }
@@ -140,6 +194,12 @@ public:
 
 	void sendSerialByte(int offset, int byte);
 
+	// Number of button presses and serial bytes dropped because their queue was full.  These only
+	// ever go up, so callers can compare against the last value they saw.
+	size_t getButtonOverflowCount() const { return _state.buttonQueue.overflowCount(); }
+
+	size_t getSerialOverflowCount() const { return _state.serialQueue.overflowCount(); }
+
 	size_t saveStateSize();
 
 	size_t sramSize();
@@ -148,7 +208,15 @@ public:
 
 	DataBuffer<char> getSramData();
 
-	uint64_t hashSram(size_t start = 0, size_t size = 0);
+	// Returns the number of cart RAM pages written since the last call, and clears them.  If
+	// target is set the dirty page bits are OR'd in to it.
+	size_t consumeDirtyPages(uint64_t* target = nullptr, size_t wordCount = 0);
+
+	// Changes whenever cart RAM has been written since the previous call.  Doesn't clear the
+	// pages returned by consumeDirtyPages.
+	uint64_t getSramGeneration();
+
+	size_t getDirtyPageWordCount() const { return _dirtyPages.size(); }
 
 	bool loadSram(const char* data, size_t size, bool reset);
 
@@ -170,7 +238,21 @@ public:
 
 	void disableRendering(bool disable);
 
-	void setRomData(DataBuffer<char>* data);
+	// Measures how long each update takes, for the audio block profiler
+	void setTimingEnabled(bool enabled) { _state.timingEnabled = enabled; }
+
+	double getUpdateMicros() const { return _state.updateMicros; }
+
+	double getVideoMicros() const { return _state.videoMicros; }
+
+	// Finds or adds a ROM in the store, padded the way the core expects
+	static SharedRomPtr shareRom(const char* data, size_t size);
+
+	// Swaps the ROM contents without resetting.  On success rom is swapped with the ROM that was
+	// being used, so it can be released off the audio thread.  Nothing is allocated or freed, so a
+	// ROM of a different size, or a core with its own copy of the ROM, is rejected and false is
+	// returned.
+	bool setRom(SharedRomPtr& rom);
 
 	void patchMemory(DirectAccessType::Enum memoryType, DataBuffer<char>* data, size_t offset = 0);
 
@@ -178,4 +260,21 @@ private:
 	void updateAV(int audioFrames);
 
 	void init(GameboyModel model);
+
+	void setupVideoOutput();
+
+	// Points the core at the shared ROM, or a private copy of data if it can't share it, and sizes
+	// the cart RAM tracking to match
+	void attachRom(SharedRomPtr rom, const char* data, size_t size);
+
+	void markAllPagesDirty();
+
+	// Moves the pages the core marked in to _changedPages
+	void collectDirtyPages();
+
+	// Runs the boot ROM to completion and adds the resulting state to the cache
+	BootStatePtr runBootRom(uint64_t romHash);
+
+	// Loads the boot state, keeping the battery.  Returns false if the state couldn't be loaded.
+	bool restoreBootState();
 };
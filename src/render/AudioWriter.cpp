@@ -0,0 +1,140 @@
+#include "AudioWriter.h"
+
+#include <algorithm>
+#include <string.h>
+#include <spdlog/spdlog.h>
+
+#ifdef RP_WINDOWS
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+#include "util/xstring.h"
+
+const uint16_t WAVE_FORMAT_PCM = 1;
+const uint16_t WAVE_FORMAT_IEEE_FLOAT = 3;
+
+template <typename T>
+static void putLe(std::vector<char>& target, T value) {
+	for (size_t i = 0; i < sizeof(T); ++i) {
+		target.push_back((char)((uint64_t)value >> (i * 8)));
+	}
+}
+
+bool AudioWriter::open(const std::string& path, AudioFileFormat format, size_t channelCount, double sampleRate) {
+	close();
+
+	if (path == "-") {
+		if (format != AudioFileFormat::RawFloat) {
+			spdlog::error("Only raw audio can be written to stdout");
+			return false;
+		}
+
+#ifdef RP_WINDOWS
+		_setmode(_fileno(stdout), _O_BINARY);
+#endif
+		_file = stdout;
+		_ownsFile = false;
+	} else {
+#ifdef RP_WINDOWS
+		_file = _wfopen(tstr(path).c_str(), L"wb");
+#else
+		_file = fopen(path.c_str(), "wb");
+#endif
+		_ownsFile = true;
+	}
+
+	if (!_file) {
+		spdlog::error("Failed to open {} for writing", path);
+		return false;
+	}
+
+	_format = format;
+	_channelCount = channelCount;
+	_sampleRate = sampleRate;
+	_dataSize = 0;
+
+	// Written with placeholder sizes, which are filled in by close()
+	return _format == AudioFileFormat::RawFloat || writeHeader();
+}
+
+bool AudioWriter::write(const float* const* channels, size_t frameCount) {
+	if (!_file) {
+		return false;
+	}
+
+	size_t sampleSize = _format == AudioFileFormat::Wav16 ? 2 : 4;
+	_scratch.resize(frameCount * _channelCount * sampleSize);
+	char* target = _scratch.data();
+
+	for (size_t i = 0; i < frameCount; ++i) {
+		for (size_t c = 0; c < _channelCount; ++c) {
+			float sample = channels[c][i];
+
+			if (_format == AudioFileFormat::Wav16) {
+				int16_t s = (int16_t)(std::clamp(sample, -1.0f, 1.0f) * 32767.0f);
+				target[0] = (char)(s & 0xFF);
+				target[1] = (char)((s >> 8) & 0xFF);
+			} else {
+				memcpy(target, &sample, sizeof(float));
+			}
+
+			target += sampleSize;
+		}
+	}
+
+	_dataSize += _scratch.size();
+	return fwrite(_scratch.data(), 1, _scratch.size(), _file) == _scratch.size();
+}
+
+bool AudioWriter::close() {
+	if (!_file) {
+		return true;
+	}
+
+	bool valid = true;
+	if (_format != AudioFileFormat::RawFloat) {
+		valid = fseek(_file, 0, SEEK_SET) == 0 && writeHeader();
+	}
+
+	valid = fflush(_file) == 0 && valid;
+
+	if (_ownsFile) {
+		valid = fclose(_file) == 0 && valid;
+	}
+
+	_file = nullptr;
+	return valid;
+}
+
+bool AudioWriter::writeHeader() {
+	bool isFloat = _format == AudioFileFormat::WavFloat;
+	uint16_t bitsPerSample = isFloat ? 32 : 16;
+	uint16_t blockAlign = (uint16_t)(_channelCount * bitsPerSample / 8);
+	uint32_t dataSize = (uint32_t)std::min(_dataSize, (uint64_t)UINT32_MAX - 64);
+
+	// Float data needs a fact chunk, which also keeps the header a fixed size
+	std::vector<char> header;
+	header.insert(header.end(), { 'R', 'I', 'F', 'F' });
+	putLe<uint32_t>(header, (isFloat ? 50 : 36) + dataSize);
+	header.insert(header.end(), { 'W', 'A', 'V', 'E', 'f', 'm', 't', ' ' });
+	putLe<uint32_t>(header, isFloat ? 18 : 16);
+	putLe<uint16_t>(header, isFloat ? WAVE_FORMAT_IEEE_FLOAT : WAVE_FORMAT_PCM);
+	putLe<uint16_t>(header, (uint16_t)_channelCount);
+	putLe<uint32_t>(header, (uint32_t)_sampleRate);
+	putLe<uint32_t>(header, (uint32_t)_sampleRate * blockAlign);
+	putLe<uint16_t>(header, blockAlign);
+	putLe<uint16_t>(header, bitsPerSample);
+
+	if (isFloat) {
+		putLe<uint16_t>(header, 0);
+		header.insert(header.end(), { 'f', 'a', 'c', 't' });
+		putLe<uint32_t>(header, 4);
+		putLe<uint32_t>(header, blockAlign > 0 ? dataSize / blockAlign : 0);
+	}
+
+	header.insert(header.end(), { 'd', 'a', 't', 'a' });
+	putLe<uint32_t>(header, dataSize);
+
+	return fwrite(header.data(), 1, header.size(), _file) == header.size();
+}
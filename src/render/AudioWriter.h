@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <stdio.h>
+
+enum class AudioFileFormat {
+	// 16 bit PCM WAV
+	Wav16,
+
+	// 32 bit float WAV
+	WavFloat,
+
+	// Headerless interleaved 32 bit float, in native byte order
+	RawFloat
+};
+
+// Writes interleaved audio to a WAV or raw file.  A raw file can be written to stdout by passing
+// "-" as the path.
+class AudioWriter {
+private:
+	FILE* _file = nullptr;
+	bool _ownsFile = false;
+	AudioFileFormat _format = AudioFileFormat::Wav16;
+	size_t _channelCount = 0;
+	double _sampleRate = 0;
+	uint64_t _dataSize = 0;
+
+	std::vector<char> _scratch;
+
+public:
+	AudioWriter() {}
+	AudioWriter(const AudioWriter&) = delete;
+	~AudioWriter() { close(); }
+
+	bool open(const std::string& path, AudioFileFormat format, size_t channelCount, double sampleRate);
+
+	// `channels` points to one buffer per channel
+	bool write(const float* const* channels, size_t frameCount);
+
+	// Fills in the WAV header sizes
+	bool close();
+
+private:
+	bool writeHeader();
+};
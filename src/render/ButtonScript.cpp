@@ -0,0 +1,67 @@
+#include "ButtonScript.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <spdlog/spdlog.h>
+
+#include "Constants.h"
+#include "util/xstring.h"
+
+namespace ButtonScript {
+	static bool parseAction(const std::string& name, ButtonAction& action) {
+		if (name.empty() || name == "press") {
+			action = ButtonAction::Press;
+		} else if (name == "down" || name == "hold") {
+			action = ButtonAction::Down;
+		} else if (name == "up" || name == "release") {
+			action = ButtonAction::Up;
+		} else {
+			return false;
+		}
+
+		return true;
+	}
+
+	bool load(const std::string& path, std::vector<ScriptedButton>& events) {
+		std::ifstream f(tstr(path));
+		if (!f.good()) {
+			spdlog::error("Failed to read button script {}", path);
+			return false;
+		}
+
+		std::string line;
+		for (int lineNumber = 1; std::getline(f, line); ++lineNumber) {
+			std::istringstream ss(line);
+
+			std::string first;
+			if (!(ss >> first) || first[0] == '#') {
+				continue;
+			}
+
+			double time = 0;
+			int system = 0;
+			std::string buttonName;
+			std::string actionName;
+			ButtonAction action;
+
+			std::istringstream timeStream(first);
+			bool valid = (timeStream >> time) && time >= 0 && (ss >> system >> buttonName);
+			ss >> actionName;
+
+			ButtonType button = ButtonTypes::fromString(buttonName);
+			if (!valid || system < 1 || system > MAX_SYSTEMS || button == ButtonType::MAX || !parseAction(actionName, action)) {
+				spdlog::error("{}:{}: Expected '<seconds> <system> <button> [press|down|up]' but got '{}'", path, lineNumber, line);
+				return false;
+			}
+
+			events.push_back(ScriptedButton { time, system - 1, button, action });
+		}
+
+		std::stable_sort(events.begin(), events.end(), [](const ScriptedButton& a, const ScriptedButton& b) { return a.time < b.time; });
+
+		spdlog::info("Loaded {} button events from {}", events.size(), path);
+
+		return true;
+	}
+}
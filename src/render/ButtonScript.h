@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Buttons.h"
+#include "Types.h"
+
+enum class ButtonAction {
+	Press,
+	Down,
+	Up
+};
+
+struct ScriptedButton {
+	// Seconds from the start of the render
+	double time;
+	SystemIndex idx;
+	ButtonType button;
+	ButtonAction action;
+};
+
+// A text file of timed button presses, one per line:
+//
+//   <seconds> <system> <button> [press|down|up]
+//
+// Systems are numbered from 1 and buttons use the names in Buttons.h.  The action defaults to
+// press, which holds the button for the default press length.  Lines starting with # are ignored.
+namespace ButtonScript {
+	// Events are sorted by time.  Returns false and logs the offending line on a parse error.
+	bool load(const std::string& path, std::vector<ScriptedButton>& events);
+}
@@ -0,0 +1,265 @@
+#include "MidiFile.h"
+
+#include <algorithm>
+#include <string.h>
+#include <spdlog/spdlog.h>
+
+#include "util/DataBuffer.h"
+#include "util/File.h"
+#include "util/xstring.h"
+
+namespace {
+	struct TickEvent {
+		uint64_t tick;
+		MidiEvent event;
+	};
+
+	struct TickTempo {
+		uint64_t tick;
+		double tempo;
+	};
+
+	// Big endian reader that flags (rather than overruns) truncated data
+	struct ByteReader {
+		const uint8_t* data;
+		size_t size;
+		size_t pos = 0;
+		bool valid = true;
+
+		bool done() const { return pos >= size; }
+
+		uint8_t u8() {
+			if (pos >= size) {
+				valid = false;
+				return 0;
+			}
+
+			return data[pos++];
+		}
+
+		uint32_t be(int bytes) {
+			uint32_t v = 0;
+			for (int i = 0; i < bytes; ++i) {
+				v = (v << 8) | u8();
+			}
+
+			return v;
+		}
+
+		uint32_t vlq() {
+			uint32_t v = 0;
+			for (int i = 0; i < 4; ++i) {
+				uint8_t b = u8();
+				v = (v << 7) | (b & 0x7F);
+				if (!(b & 0x80)) {
+					break;
+				}
+			}
+
+			return v;
+		}
+
+		void skip(size_t count) {
+			if (size - pos < count) {
+				valid = false;
+				pos = size;
+			} else {
+				pos += count;
+			}
+		}
+	};
+
+	bool readTrack(ByteReader& r, std::vector<TickEvent>& events, std::vector<TickTempo>& tempos) {
+		uint64_t tick = 0;
+		uint8_t runningStatus = 0;
+
+		while (r.valid && !r.done()) {
+			tick += r.vlq();
+			uint8_t status = r.u8();
+
+			if (status == 0xFF) {
+				uint8_t type = r.u8();
+				uint32_t size = r.vlq();
+
+				if (type == 0x2F) {
+					break;
+				}
+
+				if (type == 0x51 && size == 3) {
+					uint32_t usPerQuarter = r.be(3);
+					if (usPerQuarter > 0) {
+						tempos.push_back({ tick, 60000000.0 / usPerQuarter });
+					}
+				} else {
+					r.skip(size);
+				}
+
+				continue;
+			}
+
+			if (status == 0xF0 || status == 0xF7) {
+				r.skip(r.vlq());
+				runningStatus = 0;
+				continue;
+			}
+
+			uint8_t data1;
+			if (status & 0x80) {
+				if (status > 0xEF) {
+					return false;
+				}
+
+				runningStatus = status;
+				data1 = r.u8();
+			} else {
+				if (runningStatus == 0) {
+					return false;
+				}
+
+				data1 = status;
+				status = runningStatus;
+			}
+
+			uint8_t data2 = 0;
+			uint8_t type = status & 0xF0;
+			if (type != 0xC0 && type != 0xD0) {
+				data2 = r.u8();
+			}
+
+			events.push_back({ tick, MidiEvent { 0.0, status, data1, data2 } });
+		}
+
+		return r.valid;
+	}
+}
+
+bool MidiFile::load(const std::string& path, double tempo) {
+	_events.clear();
+	_tempos.clear();
+	_tempos.push_back({ 0.0, 0.0, tempo });
+
+	DataBuffer<char> data;
+	if (!readFile(tstr(path), &data)) {
+		spdlog::error("Failed to read MIDI file {}", path);
+		return false;
+	}
+
+	ByteReader r { (const uint8_t*)data.data(), data.size() };
+	if (data.size() < 14 || memcmp(data.data(), "MThd", 4) != 0) {
+		spdlog::error("{} is not a MIDI file", path);
+		return false;
+	}
+
+	r.skip(4);
+	uint32_t headerSize = r.be(4);
+	uint32_t format = r.be(2);
+	uint32_t trackCount = r.be(2);
+	uint32_t division = r.be(2);
+	r.skip(headerSize - 6);
+
+	if (format > 1 || division == 0) {
+		spdlog::error("Unsupported MIDI file {} (format {})", path, format);
+		return false;
+	}
+
+	// SMPTE timing with no ticks per frame would put every event at an infinite time
+	if ((division & 0x8000) && (division & 0xFF) == 0) {
+		spdlog::error("MIDI file {} has SMPTE timing with no ticks per frame", path);
+		return false;
+	}
+
+	std::vector<TickEvent> events;
+	std::vector<TickTempo> tempos;
+
+	for (uint32_t i = 0; i < trackCount && r.valid && !r.done(); ++i) {
+		uint32_t id = r.be(4);
+		uint32_t size = r.be(4);
+		if (size > r.size - r.pos) {
+			r.valid = false;
+			break;
+		}
+
+		if (id == 0x4D54726B) { // MTrk
+			ByteReader track { r.data + r.pos, size };
+			if (!readTrack(track, events, tempos)) {
+				spdlog::error("Failed to read track {} of MIDI file {}", i, path);
+				return false;
+			}
+		}
+
+		r.skip(size);
+	}
+
+	if (!r.valid) {
+		spdlog::error("MIDI file {} is truncated", path);
+		return false;
+	}
+
+	// Tracks were read one after the other, a stable sort keeps their order for events on the same tick
+	std::stable_sort(events.begin(), events.end(), [](const TickEvent& a, const TickEvent& b) { return a.tick < b.tick; });
+	std::stable_sort(tempos.begin(), tempos.end(), [](const TickTempo& a, const TickTempo& b) { return a.tick < b.tick; });
+
+	auto addTempo = [&](double time, double ppq, double bpm) {
+		if (_tempos.back().time == time) {
+			_tempos.back().tempo = bpm;
+		} else {
+			_tempos.push_back({ time, ppq, bpm });
+		}
+	};
+
+	if (division & 0x8000) {
+		// SMPTE timing, ticks are a fixed length regardless of tempo
+		int fps = -(int8_t)(division >> 8);
+		double ticksPerSecond = (fps == 29 ? 29.97 : fps) * (division & 0xFF);
+
+		for (const TickTempo& t : tempos) {
+			double time = t.tick / ticksPerSecond;
+			addTempo(time, getPpq(time), t.tempo);
+		}
+
+		for (TickEvent& e : events) {
+			e.event.time = e.tick / ticksPerSecond;
+		}
+	} else {
+		auto timeAtPpq = [&](double ppq) {
+			const TempoChange* current = &_tempos.front();
+			for (const TempoChange& t : _tempos) {
+				if (t.ppq > ppq) {
+					break;
+				}
+
+				current = &t;
+			}
+
+			return current->time + (ppq - current->ppq) * 60.0 / current->tempo;
+		};
+
+		for (const TickTempo& t : tempos) {
+			double ppq = (double)t.tick / division;
+			addTempo(timeAtPpq(ppq), ppq, t.tempo);
+		}
+
+		for (TickEvent& e : events) {
+			e.event.time = timeAtPpq((double)e.tick / division);
+		}
+	}
+
+	_events.reserve(events.size());
+	for (const TickEvent& e : events) {
+		_events.push_back(e.event);
+	}
+
+	spdlog::info("Loaded {} MIDI events from {}", _events.size(), path);
+
+	return true;
+}
+
+double MidiFile::getPpq(double time) const {
+	const TempoChange& t = findTempo(time);
+	return t.ppq + (time - t.time) * t.tempo / 60.0;
+}
+
+const MidiFile::TempoChange& MidiFile::findTempo(double time) const {
+	auto found = std::upper_bound(_tempos.begin(), _tempos.end(), time, [](double t, const TempoChange& c) { return t < c.time; });
+	return found == _tempos.begin() ? _tempos.front() : *(found - 1);
+}
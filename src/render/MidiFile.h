@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+struct MidiEvent {
+	// Seconds from the start of the file
+	double time;
+	uint8_t status;
+	uint8_t data1;
+	uint8_t data2;
+};
+
+// Reads the channel events and tempo map of a standard MIDI file (format 0 or 1).  Tracks are
+// merged in to a single list ordered by time.  Sysex and meta events other than tempo changes
+// are skipped.
+class MidiFile {
+private:
+	struct TempoChange {
+		double time;
+		double ppq;
+		double tempo;
+	};
+
+	std::vector<MidiEvent> _events;
+	std::vector<TempoChange> _tempos;
+
+public:
+	MidiFile(double tempo = 120.0) { _tempos.push_back({ 0.0, 0.0, tempo }); }
+
+	// `tempo` is used until the file's first tempo change
+	bool load(const std::string& path, double tempo = 120.0);
+
+	const std::vector<MidiEvent>& getEvents() const { return _events; }
+
+	// Time of the last event
+	double getLength() const { return _events.empty() ? 0.0 : _events.back().time; }
+
+	double getTempo(double time) const { return findTempo(time).tempo; }
+
+	// Position in quarter notes
+	double getPpq(double time) const;
+
+private:
+	const TempoChange& findTempo(double time) const;
+};
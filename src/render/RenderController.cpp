@@ -0,0 +1,144 @@
+#include "RenderController.h"
+
+#include <random>
+#include <spdlog/spdlog.h>
+
+#include "luawrapper/ConfigScriptWriter.h"
+#include "util/DataBuffer.h"
+#include "util/File.h"
+#include "util/fs.h"
+
+// Only used when lua scripts are loaded from disk rather than compiled in
+static fs::path getScriptPath() {
+	return fs::path(__FILE__).parent_path().parent_path() / "retroplug" / "scripts";
+}
+
+// The defaults are written to a directory of our own, so a render never adds files to the user's
+// config directory
+static fs::path createTempConfigDir() {
+	std::random_device random;
+	fs::path dir = fs::temp_directory_path() / ("retroplug-render-" + std::to_string(random()));
+	ConfigScriptWriter::write(dir);
+	return dir;
+}
+
+RenderController::RenderController(double sampleRate, const std::string& configPath)
+	: _proxy(&_audioController), _audioController(&_timeInfo, sampleRate), _sampleRate(sampleRate)
+{
+	registerCalls(_bus);
+
+	_proxy.setNode(_bus.createNode(NodeTypes::Ui, { NodeTypes::Audio }));
+	_audioController.setNode(_bus.createNode(NodeTypes::Audio, { NodeTypes::Ui }));
+
+	_bus.start();
+
+	// Nothing is drawn, and systems are spread over the spare cores
+	_audioController.setOffline(true);
+	_audioController.updateWorkerThreads();
+
+	// A render is never rewound, so there's no point recording history for one
+	_proxy.setRewindAllowed(false);
+
+	// An existing config is read but never written to
+	std::string activeConfigPath = configPath;
+	if (!fs::exists(fs::path(configPath) / "config.lua")) {
+		spdlog::info("No config found in {}, using the defaults", configPath);
+		_tempConfigPath = createTempConfigDir().string();
+		activeConfigPath = _tempConfigPath;
+	}
+
+	std::string scriptPath = getScriptPath().string();
+	_uiLua.init(&_proxy, activeConfigPath, scriptPath);
+	_proxy.setScriptDirs(activeConfigPath, scriptPath);
+
+	// The audio lua context has to be swapped in before any systems are added to it
+	flush();
+}
+
+RenderController::~RenderController() {
+	if (!_tempConfigPath.empty()) {
+		std::error_code err;
+		fs::remove_all(_tempConfigPath, err);
+	}
+}
+
+void RenderController::setChannelCount(size_t channelCount) {
+	_channelCount = channelCount;
+
+	// Blocks are rendered back to back, so a max block size of 0 keeps lookahead rendering off
+	// whatever the config says.  There's nothing for it to hide here.
+	_audioController.setAudioSettings(AudioSettings { channelCount, 0, _sampleRate, 0 });
+}
+
+bool RenderController::loadProject(const std::string& path) {
+	DataBufferPtr buffer = std::make_shared<DataBuffer<char>>();
+	if (!readFile(tstr(path), buffer.get())) {
+		spdlog::error("Failed to read project {}", path);
+		return false;
+	}
+
+	_uiLua.loadState(buffer);
+
+	// Systems are swapped in now so MIDI at the very start reaches them
+	flush();
+
+	Project* project = _proxy.getProject();
+	if (project->systems.empty()) {
+		spdlog::error("No systems were loaded from {}", path);
+		return false;
+	}
+
+	for (const SystemDescPtr& system : project->systems) {
+		if (system->state == SystemState::RomMissing) {
+			spdlog::warn("System {} has no ROM and will be silent", system->idx + 1);
+		}
+	}
+
+	return true;
+}
+
+void RenderController::splitOutputs() {
+	_proxy.getProject()->settings.audioRouting = AudioChannelRouting::TwoChannelsPerInstance;
+	_proxy.updateSettings();
+	flush();
+}
+
+bool RenderController::pressButton(const ScriptedButton& ev) {
+	Project* project = _proxy.getProject();
+	if (ev.idx >= (SystemIndex)project->systems.size()) {
+		return false;
+	}
+
+	GameboyButtonStream& buttons = project->systems[ev.idx]->buttons;
+
+	switch (ev.action) {
+		case ButtonAction::Press: buttons.press(ev.button); break;
+		case ButtonAction::Down: buttons.hold(ev.button); break;
+		case ButtonAction::Up: buttons.release(ev.button); break;
+	}
+
+	return true;
+}
+
+void RenderController::process(float** outputs, size_t frameCount, double tempo, double ppq) {
+	for (size_t i = 0; i < _channelCount; ++i) {
+		std::fill(outputs[i], outputs[i] + frameCount, 0.0f);
+	}
+
+	_timeInfo.mTempo = tempo;
+	_timeInfo.mSamplePos = (double)_samplePos;
+	_timeInfo.mPPQPos = ppq;
+	_timeInfo.mTransportIsRunning = true;
+
+	// Sends queued button presses and handles the responses to the last block
+	_proxy.update(0);
+
+	_audioController.process(outputs, frameCount);
+	_samplePos += frameCount;
+}
+
+void RenderController::flush() {
+	_proxy.update(0);
+	_audioController.process(nullptr, 0);
+	_proxy.update(0);
+}
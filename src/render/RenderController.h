@@ -0,0 +1,60 @@
+#pragma once
+
+#include <string>
+
+#include "luawrapper/UiLuaContext.h"
+#include "micromsg/nodemanager.h"
+#include "messaging.h"
+#include "model/AudioContextProxy.h"
+#include "audio/AudioController.h"
+#include "ButtonScript.h"
+
+// Runs the UI and audio sides of the plugin on a single thread without a view or host.  Projects
+// go through the same UI lua code as the plugin, and blocks are rendered back to back as an
+// offline bounce.
+class RenderController {
+private:
+	UiLuaContext _uiLua;
+	AudioContextProxy _proxy;
+	AudioController _audioController;
+	TimeInfo _timeInfo;
+
+	micromsg::NodeManager<NodeTypes> _bus;
+
+	double _sampleRate;
+	size_t _channelCount = 2;
+	size_t _samplePos = 0;
+
+	// Set when there was no config to read, and removed along with the controller
+	std::string _tempConfigPath;
+
+public:
+	RenderController(double sampleRate, const std::string& configPath);
+	~RenderController();
+
+	void setChannelCount(size_t channelCount);
+
+	// Loads a project (or a legacy project) the same way the plugin loads its saved state
+	bool loadProject(const std::string& path);
+
+	// Routes each system to its own output pair, for as many pairs as there are outputs
+	void splitOutputs();
+
+	Project* getProject() { return _proxy.getProject(); }
+
+	// Queued up and sent to the system at the start of the next block
+	bool pressButton(const ScriptedButton& ev);
+
+	// `offset` is relative to the start of the next block
+	void onMidi(int offset, int status, int data1, int data2) {
+		_audioController.onMidi(offset, status, data1, data2);
+	}
+
+	// Renders the next block in to `outputs`, which are cleared first.  Pending messages between the
+	// UI and audio sides are handled before the block.
+	void process(float** outputs, size_t frameCount, double tempo, double ppq);
+
+private:
+	// Lets both sides handle everything that has been sent to them
+	void flush();
+};
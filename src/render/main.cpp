@@ -0,0 +1,294 @@
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+#include "AudioWriter.h"
+#include "ButtonScript.h"
+#include "MidiFile.h"
+#include "RenderController.h"
+#include "util/Paths.h"
+#include "util/fs.h"
+
+// Systems beyond this many share the first stem
+const size_t MAX_STEMS = 4;
+
+struct RenderOptions {
+	std::string projectPath;
+	std::string outputPath;
+	std::string midiPath;
+	std::string buttonPath;
+	std::string configPath;
+	AudioFileFormat format = AudioFileFormat::Wav16;
+	double sampleRate = 48000;
+	size_t blockSize = 1024;
+	double length = 0;
+	double tail = 2;
+	double tempo = 120;
+	bool stems = false;
+	bool quiet = false;
+};
+
+static void printUsage() {
+	fprintf(stderr,
+		"Renders a RetroPlug project to a file, as fast as it can.\n"
+		"\n"
+		"Usage: RetroPlugRender <project> -o <output> [options]\n"
+		"\n"
+		"Options:\n"
+		"  -o, --output <path>     Output file.  Raw audio can be written to stdout with -\n"
+		"  -f, --format <format>   wav (16 bit, default), wav32 (32 bit float) or raw (32 bit float)\n"
+		"  -m, --midi <path>       Standard MIDI file to play in to the project\n"
+		"  -b, --buttons <path>    Button script, one '<seconds> <system> <button> [press|down|up]' per line\n"
+		"  -l, --length <seconds>  Length of the render.  Defaults to the last MIDI or button event plus the tail\n"
+		"  -t, --tail <seconds>    Time rendered after the last event (default 2)\n"
+		"  -r, --rate <hz>         Sample rate (default 48000)\n"
+		"      --block <frames>    Block size (default 1024)\n"
+		"      --tempo <bpm>       Tempo until the MIDI file sets one (default 120)\n"
+		"      --stems             Write each of the first 4 systems to <output>-<n>.<ext>\n"
+		"      --config <dir>      Config directory, defaults to the one the plugin uses\n"
+		"  -q, --quiet             Only log warnings and errors\n"
+	);
+}
+
+static bool parseNumber(const char* str, double& target) {
+	char* end = nullptr;
+	double v = strtod(str, &end);
+	if (end == str || *end != '\0' || v < 0) {
+		return false;
+	}
+
+	target = v;
+	return true;
+}
+
+static bool parseArgs(int argc, char** argv, RenderOptions& options) {
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+
+		auto value = [&]() -> const char* {
+			if (i + 1 >= argc) {
+				fprintf(stderr, "Missing value for %s\n", arg.c_str());
+				return nullptr;
+			}
+
+			return argv[++i];
+		};
+
+		auto number = [&](double& target) {
+			const char* v = value();
+			if (v && parseNumber(v, target)) {
+				return true;
+			}
+
+			if (v) {
+				fprintf(stderr, "Invalid value for %s: %s\n", arg.c_str(), v);
+			}
+
+			return false;
+		};
+
+		const char* v = nullptr;
+		double n = 0;
+
+		if (arg == "-o" || arg == "--output") {
+			if (!(v = value())) return false;
+			options.outputPath = v;
+		} else if (arg == "-f" || arg == "--format") {
+			if (!(v = value())) return false;
+			std::string format = v;
+
+			if (format == "wav") {
+				options.format = AudioFileFormat::Wav16;
+			} else if (format == "wav32") {
+				options.format = AudioFileFormat::WavFloat;
+			} else if (format == "raw") {
+				options.format = AudioFileFormat::RawFloat;
+			} else {
+				fprintf(stderr, "Unknown format %s\n", v);
+				return false;
+			}
+		} else if (arg == "-m" || arg == "--midi") {
+			if (!(v = value())) return false;
+			options.midiPath = v;
+		} else if (arg == "-b" || arg == "--buttons") {
+			if (!(v = value())) return false;
+			options.buttonPath = v;
+		} else if (arg == "-l" || arg == "--length") {
+			if (!number(options.length)) return false;
+		} else if (arg == "-t" || arg == "--tail") {
+			if (!number(options.tail)) return false;
+		} else if (arg == "-r" || arg == "--rate") {
+			if (!number(options.sampleRate) || options.sampleRate < 1) return false;
+		} else if (arg == "--block") {
+			if (!number(n) || n < 1) return false;
+			options.blockSize = (size_t)n;
+		} else if (arg == "--tempo") {
+			if (!number(options.tempo) || options.tempo <= 0) return false;
+		} else if (arg == "--config") {
+			if (!(v = value())) return false;
+			options.configPath = v;
+		} else if (arg == "--stems") {
+			options.stems = true;
+		} else if (arg == "-q" || arg == "--quiet") {
+			options.quiet = true;
+		} else if (arg == "-h" || arg == "--help") {
+			return false;
+		} else if (arg[0] == '-' && arg.size() > 1) {
+			fprintf(stderr, "Unknown option %s\n", arg.c_str());
+			return false;
+		} else if (options.projectPath.empty()) {
+			options.projectPath = arg;
+		} else {
+			fprintf(stderr, "Unexpected argument %s\n", arg.c_str());
+			return false;
+		}
+	}
+
+	if (options.projectPath.empty() || options.outputPath.empty()) {
+		return false;
+	}
+
+	if (options.stems && options.outputPath == "-") {
+		fprintf(stderr, "Stems can not be written to stdout\n");
+		return false;
+	}
+
+	return true;
+}
+
+static std::string getStemPath(const std::string& path, size_t idx) {
+	fs::path p(path);
+	return (p.parent_path() / (p.stem().string() + "-" + std::to_string(idx + 1) + p.extension().string())).string();
+}
+
+int main(int argc, char** argv) {
+	RenderOptions options;
+	if (!parseArgs(argc, argv, options)) {
+		printUsage();
+		return 1;
+	}
+
+	// Logs go to stderr so raw audio can be piped from stdout
+	auto logger = std::make_shared<spdlog::logger>("", std::make_shared<spdlog::sinks::stderr_color_sink_mt>());
+	logger->set_level(options.quiet ? spdlog::level::warn : spdlog::level::info);
+	spdlog::set_default_logger(logger);
+
+	MidiFile midi(options.tempo);
+	if (!options.midiPath.empty() && !midi.load(options.midiPath, options.tempo)) {
+		return 1;
+	}
+
+	std::vector<ScriptedButton> buttons;
+	if (!options.buttonPath.empty() && !ButtonScript::load(options.buttonPath, buttons)) {
+		return 1;
+	}
+
+	double length = options.length;
+	if (length == 0) {
+		if (options.midiPath.empty() && buttons.empty()) {
+			spdlog::error("A length is needed when there is no MIDI file or button script");
+			return 1;
+		}
+
+		length = std::max(midi.getLength(), buttons.empty() ? 0.0 : buttons.back().time) + options.tail;
+	}
+
+	std::string configPath = options.configPath.empty() ? getConfigPath().string() : options.configPath;
+	RenderController controller(options.sampleRate, configPath);
+
+	size_t channelCount = options.stems ? MAX_STEMS * 2 : 2;
+	controller.setChannelCount(channelCount);
+
+	if (!controller.loadProject(options.projectPath)) {
+		return 1;
+	}
+
+	// One writer for the mix, or one per system when writing stems
+	std::vector<std::unique_ptr<AudioWriter>> writers;
+	if (options.stems) {
+		controller.splitOutputs();
+
+		size_t stemCount = std::min(controller.getProject()->systems.size(), MAX_STEMS);
+		for (size_t i = 0; i < stemCount; ++i) {
+			writers.push_back(std::make_unique<AudioWriter>());
+			if (!writers.back()->open(getStemPath(options.outputPath, i), options.format, 2, options.sampleRate)) {
+				return 1;
+			}
+		}
+	} else {
+		writers.push_back(std::make_unique<AudioWriter>());
+		if (!writers.back()->open(options.outputPath, options.format, 2, options.sampleRate)) {
+			return 1;
+		}
+	}
+
+	std::vector<std::vector<float>> buffers(channelCount, std::vector<float>(options.blockSize));
+	std::vector<float*> outputs(channelCount);
+	for (size_t i = 0; i < channelCount; ++i) {
+		outputs[i] = buffers[i].data();
+	}
+
+	auto toFrame = [&](double time) { return (size_t)(time * options.sampleRate + 0.5); };
+
+	const std::vector<MidiEvent>& midiEvents = midi.getEvents();
+	size_t midiIdx = 0;
+	size_t buttonIdx = 0;
+	size_t totalFrames = toFrame(length);
+	size_t pos = 0;
+
+	spdlog::info("Rendering {:.2f} seconds from {}", length, options.projectPath);
+	auto start = std::chrono::steady_clock::now();
+
+	while (pos < totalFrames) {
+		// Button presses are picked up at the start of a block, so blocks are split at them
+		while (buttonIdx < buttons.size() && toFrame(buttons[buttonIdx].time) <= pos) {
+			if (!controller.pressButton(buttons[buttonIdx])) {
+				spdlog::warn("Button script refers to system {}, which doesn't exist", buttons[buttonIdx].idx + 1);
+			}
+
+			buttonIdx++;
+		}
+
+		size_t end = std::min(pos + options.blockSize, totalFrames);
+		if (buttonIdx < buttons.size()) {
+			end = std::min(end, toFrame(buttons[buttonIdx].time));
+		}
+
+		while (midiIdx < midiEvents.size() && toFrame(midiEvents[midiIdx].time) < end) {
+			const MidiEvent& ev = midiEvents[midiIdx++];
+			size_t frame = std::max(toFrame(ev.time), pos);
+			controller.onMidi((int)(frame - pos), ev.status, ev.data1, ev.data2);
+		}
+
+		size_t frameCount = end - pos;
+		double time = pos / options.sampleRate;
+		controller.process(outputs.data(), frameCount, midi.getTempo(time), midi.getPpq(time));
+
+		for (size_t i = 0; i < writers.size(); ++i) {
+			if (!writers[i]->write(outputs.data() + i * 2, frameCount)) {
+				spdlog::error("Failed to write audio");
+				return 1;
+			}
+		}
+
+		pos = end;
+	}
+
+	for (auto& writer : writers) {
+		if (!writer->close()) {
+			spdlog::error("Failed to finish writing audio");
+			return 1;
+		}
+	}
+
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	spdlog::info("Rendered {:.2f} seconds in {:.2f} seconds ({:.1f}x realtime)", length, elapsed, elapsed > 0 ? length / elapsed : 0.0);
+
+	return 0;
+}
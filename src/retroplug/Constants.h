@@ -1,6 +1,11 @@
 #pragma once
 
-const int MAX_SYSTEMS = 4;
+// The most systems a plugin instance can be configured to run.  Only sizes fixed tables and
+// message structs, the containers that do real work are sized to the configured count.
+const int MAX_SYSTEMS = 16;
+const int DEFAULT_SYSTEM_COUNT = 4;
+const int MAX_STATE_SIZE = 512 * 1024;
+const int MAX_SRAM_SIZE = 131072;
 
 enum class SystemType {
 	Unknown,
@@ -2,7 +2,9 @@
 
 #include "model/Project.h"
 #include "model/ButtonStream.h"
+#include "model/ProcessTimings.h"
 #include "retroplug/micromsg/allocator/uniqueptr.h"
+#include "util/RomStore.h"
 
 class SameBoyPlug;
 using SameBoyPlugPtr = std::shared_ptr<SameBoyPlug>;
@@ -28,26 +30,15 @@ struct SystemSwapDesc {
 	std::shared_ptr<std::string> componentState;
 };
 
+// The response carries the system that was replaced and the state scratch, so both are released
+// on the UI thread
 struct SystemDuplicateDesc {
 	SystemIndex sourceIdx;
 	SystemIndex targetIdx;
 	SameBoyPlugPtr instance;
-};
-
-struct VideoBuffer {
-	Dimension2 dimensions;
-	micromsg::UniquePtr<char> data;
-	bool hasData = false;
-};
 
-struct VideoStream {
-	VideoBuffer buffers[MAX_SYSTEMS];
-};
-
-struct AudioBuffer {
-	size_t frameCount = 0;
-	size_t channelCount = 0;
-	FloatDataBufferPtr data;
+	// Used to go through a save state when the systems can't be copied directly
+	DataBufferPtr stateScratch;
 };
 
 enum class ResourceType {
@@ -71,6 +62,7 @@ struct FetchStateRequest {
 struct FetchStateResponse {
 	std::array<DataBufferPtr, MAX_SYSTEMS> srams;
 	std::array<DataBufferPtr, MAX_SYSTEMS> states;
+	std::array<DataBufferPtr, MAX_SYSTEMS> stateKeys;
 	std::array<std::string, MAX_SYSTEMS> components;
 };
 
@@ -79,6 +71,12 @@ struct ResetSystemDesc {
 	GameboyModel model;
 };
 
+struct RewindDesc {
+	SystemIndex idx;
+	bool scrub;
+	double value;
+};
+
 struct FetchSramRequest {
 	SystemIndex idx;
 	DataBufferPtr buffer;
@@ -88,6 +86,20 @@ struct SetDataRequest {
 	SystemIndex idx;
 	DataBufferPtr buffer;
 	bool reset;
+
+	// The instance the data came from, for messages sent by the audio thread.  The slot may hold a
+	// different system by the time they arrive.
+	uint64_t instanceId = 0;
+};
+
+// The response carries the ROM the system was using, so it is released on the UI thread
+struct SetRomRequest {
+	SystemIndex idx;
+	SharedRomPtr rom;
+	bool reset;
+
+	// Set in the response when the system is running the new ROM
+	bool swapped = false;
 };
 
 struct ButtonPressState {
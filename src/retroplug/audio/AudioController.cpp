@@ -1,8 +1,14 @@
 #include "AudioController.h"
 
+#include "platform/RtGuard.h"
+
+AudioController::~AudioController() {
+	_lookahead.stop();
+	rtguard::dumpViolations();
+}
+
 void AudioController::setNode(Node* node) {
 	_node = node;
-	node->getAllocator()->reserveChunks(160 * 144 * 4, 16); // Video buffers
 
 	_processingContext.setNode(node);
 
@@ -13,7 +19,7 @@ void AudioController::setNode(Node* node) {
 		}
 
 		other = _lua;
-		ctx->init(&_processingContext, _timeInfo, _sampleRate);
+		ctx->init(&_processingContext, &_renderTimeInfo, _sampleRate);
 		//ctx->setSampleRate(_sampleRate);
 
 		if (!componentData.empty()) {
@@ -31,8 +37,9 @@ void AudioController::setNode(Node* node) {
 		other.componentState = d.componentState;
 	});
 
-	node->on<calls::DuplicateSystem>([&](const SystemDuplicateDesc& d, SameBoyPlugPtr& other) {
-		other = _processingContext.duplicateSystem(d.sourceIdx, d.targetIdx, d.instance);
+	node->on<calls::DuplicateSystem>([&](const SystemDuplicateDesc& d, SystemDuplicateDesc& ret) {
+		ret = d;
+		ret.instance = _processingContext.duplicateSystem(d.sourceIdx, d.targetIdx, d.instance, d.stateScratch.get());
 		_lua->duplicateSystem(d.sourceIdx, d.targetIdx, d.instance);
 	});
 
@@ -65,16 +72,16 @@ void AudioController::setNode(Node* node) {
 		fetchState(req, state);
 	});
 
-	node->on<calls::SetRom>([&](const SetDataRequest& req, DataBufferPtr& ret) {
+	node->on<calls::SetRom>([&](const SetRomRequest& req, SetRomRequest& ret) {
+		ret = req;
+
 		SameBoyPlugPtr inst = _processingContext.getSystem(req.idx);
-		if (inst) {
-			inst->setRomData(req.buffer.get());
+		if (inst && inst->setRom(ret.rom)) {
+			ret.swapped = true;
 			if (req.reset) {
 				inst->reset(inst->getSettings().model, true);
 			}
 		}
-
-		ret = req.buffer;
 	});
 
 	node->on<calls::SetSram>([&](const SetDataRequest& req, DataBufferPtr& ret) {
@@ -102,6 +109,14 @@ void AudioController::setNode(Node* node) {
 		}
 	});
 
+	node->on<calls::Rewind>([&](const RewindDesc& d) {
+		if (d.scrub) {
+			_processingContext.scrub(d.idx, d.value);
+		} else {
+			_processingContext.rewind(d.idx, d.value);
+		}
+	});
+
 	node->on<calls::ContextMenuResult>([&](const int& id) {
 		_lua->onMenuResult(id);
 	});
@@ -110,14 +125,61 @@ void AudioController::setNode(Node* node) {
 void AudioController::setAudioSettings(const AudioSettings& settings) {
 	_processingContext.setAudioSettings(settings);
 	_sampleRate = settings.sampleRate;
+	_audioSettings = settings;
 
 	if (_lua) {
 		_lua->setSampleRate(settings.sampleRate);
 	}
+
+	updateLookahead();
+}
+
+void AudioController::setProcessingSettings(const ProcessingSettings& settings) {
+	// Worker threads are started, and rewind memory allocated, before the lock is taken.  Whatever
+	// they replace is joined and freed after it's released.
+	_processingContext.prepareProcessingSettings(settings);
+
+	{
+		std::scoped_lock l(_lock);
+		_processingContext.applyProcessingSettings(settings);
+		_sramSnapshotter.setSystemCount(_processingContext.getSystemCount());
+	}
+
+	_processingContext.releaseProcessingSettings();
+
+	// The render thread takes _lock, so it must not be held while the thread is joined
+	updateLookahead();
+}
+
+void AudioController::updateLookahead() {
+	std::scoped_lock l(_lookaheadLock);
+
+	size_t latency = _processingContext.getProcessingSettings().lookaheadBlocks * _audioSettings.maxFrameCount;
+	if (latency == _lookahead.getLatency() && _audioSettings.channelCount == _lookahead.getChannelCount()) {
+		return;
+	}
+
+	_lookahead.start(latency, _audioSettings.channelCount, [&](const LookaheadBlock& block, float** outputs) {
+		rtguard::Scope guard("Lookahead render");
+
+		// Only keeps the block apart from the UI thread's calls in to the systems and lua.  Frames
+		// reach the view through each system's VideoTripleBuffer, which never needs this lock.
+		std::scoped_lock l(_lock);
+		_renderTimeInfo = block.timeInfo;
+
+		if (_lua) {
+			for (size_t i = 0; i < block.midiCount; ++i) {
+				const LookaheadMidiEvent& ev = block.midi[i];
+				_lua->onMidi(ev.offset, ev.status, ev.data1, ev.data2);
+			}
+		}
+
+		render(outputs, block.frameCount);
+	});
 }
 
 void AudioController::fetchState(const FetchStateRequest& req, FetchStateResponse& state) {
-	for (size_t i = 0; i < MAX_SYSTEMS; ++i) {
+	for (size_t i = 0; i < _processingContext.getSystemCount(); ++i) {
 		if ((size_t)req.systems[i] & (size_t)ResourceType::Components) {
 			if (_processingContext.getSystem(i)) {
 				state.components[i] = _lua->serializeSystem(i);
@@ -128,18 +190,6 @@ void AudioController::fetchState(const FetchStateRequest& req, FetchStateRespons
 	_processingContext.fetchState(req, state);
 }
 
-bool AudioController::getSram(SystemIndex idx, DataBuffer<char>* target) {
-	std::scoped_lock l(_lock);
-	SameBoyPlugPtr instance = _processingContext.getSystem(idx);
-	if (instance) {
-		return instance->saveSram(target->data(), target->size());
-	} else {
-		std::cout << "Failed to fetch SRAM from instance " << idx << ": instance does not exist" << std::endl;
-	}
-
-	return false;
-}
-
 void AudioController::onMenu(SystemIndex idx, std::vector<Menu*>& menus) {
 	auto ctx = _lua;
 	if (ctx) {
@@ -151,34 +201,74 @@ void AudioController::onMenu(SystemIndex idx, std::vector<Menu*>& menus) {
 	}
 }
 
+void AudioController::onMidi(int offset, int status, int data1, int data2) {
+	rtguard::Scope guard("AudioController::onMidi");
+
+	if (_lookahead.pushMidi(LookaheadMidiEvent { offset, status, data1, data2 })) {
+		return;
+	}
+
+	std::scoped_lock l(_lock);
+	if (_lua) {
+		_lua->onMidi(offset, status, data1, data2);
+	}
+}
+
 void AudioController::process(float** outputs, size_t frameCount) {
-	auto ctx = _lua;
+	rtguard::Scope guard("AudioController::process");
+
+	if (_lookahead.process(outputs, frameCount, *_timeInfo)) {
+		return;
+	}
+
 	// TODO: This mutex is temporary until I find a good way of sending context menus
 	// across threads!
 	_lock.lock();
-	if (ctx && ctx->isValid()) {
-		ctx->update(frameCount);
+	_renderTimeInfo = *_timeInfo;
+	render(outputs, frameCount);
+	_lock.unlock();
+}
+
+void AudioController::setOffline(bool offline) {
+	if (offline != _processingContext.isOffline()) {
+		std::scoped_lock l(_lock);
+		_processingContext.setOffline(offline);
+	}
+}
+
+void AudioController::updateWorkerThreads() {
+	if (_processingContext.needsOfflineWorkers()) {
+		ProcessingSettings settings = _processingContext.getProcessingSettings();
+		setProcessingSettings(settings);
 	}
+}
+
+void AudioController::render(float** outputs, size_t frameCount) {
+	ProcessProfiler& profiler = _processingContext.getProfiler();
+	profiler.beginBlock(frameCount);
 
-	_processingContext.process(outputs, (size_t)frameCount);
+	{
+		ProcessProfiler::Scope total(profiler, ProcessPhase::Total);
 
-	/*for (SystemIndex i = 0; i < MAX_SYSTEMS; ++i) {
-		SameBoyPlugPtr& system = _processingContext.getSystem(i);
+		auto ctx = _lua;
+		if (ctx && ctx->isValid()) {
+			ProcessProfiler::Scope timer(profiler, ProcessPhase::Lua);
+			ctx->update(frameCount);
+		}
 
-		if (system && _node->canPush<calls::SramChanged>()) {
-			// TODO: It appears that doing the hash check is actually slower than just saving the SRAM out and sending it
-			// to the UI thread!  Should probably just send the buffer every time and do the hash check in the UI thread
-			if (system->sramHasChanged()) {
-				DataBufferPtr sramData = std::make_shared<DataBuffer<char>>(system->sramSize());
+		_processingContext.process(outputs, (size_t)frameCount);
 
-				system->saveSram(sramData->data(), sramData->size());
-				_node->push<calls::SramChanged>(NodeTypes::Ui, SetDataRequest {
-					.idx = i,
-					.buffer = sramData
-				});
-			}
+		// The UI isn't sent anything while bouncing.  Cart RAM writes stay marked as dirty, so the
+		// snapshots are taken once the bounce has finished.
+		if (!_processingContext.isOffline()) {
+			ProcessProfiler::Scope timer(profiler, ProcessPhase::Sram);
+			_sramSnapshotter.update(_processingContext, _node, frameCount, _sampleRate);
 		}
-	}*/
+	}
 
-	_lock.unlock();
+	profiler.setLookaheadCounts(_lookahead.getUnderrunCount(), _lookahead.getOverflowFrameCount());
+
+	// Blocks rendered while bouncing are kept, but not sent
+	Node* node = _processingContext.isOffline() ? nullptr : _node;
+	profiler.endBlock(node, _sampleRate, _processingContext.getSystemCount());
 }
@@ -2,6 +2,8 @@
 
 #include <mutex>
 
+#include "audio/LookaheadProcessor.h"
+#include "audio/SramSnapshotter.h"
 #include "luawrapper/AudioLuaContext.h"
 #include "model/ProcessingContext.h"
 #include "messaging.h"
@@ -17,9 +19,17 @@ private:
 	std::mutex _lock;
 	double _sampleRate;
 
+	// The time info of the block currently being rendered.  This differs from _timeInfo (which
+	// the host writes to) when rendering ahead.
+	TimeInfo _renderTimeInfo;
+	AudioSettings _audioSettings = { 2, 0, 44100 };
+	LookaheadProcessor _lookahead;
+	std::mutex _lookaheadLock;
+	SramSnapshotter _sramSnapshotter;
+
 public:
 	AudioController(TimeInfo* timeInfo, double sampleRate): _timeInfo(timeInfo), _sampleRate(sampleRate) {}
-	~AudioController() {}
+	~AudioController();
 
 	std::mutex* getLock() { return &_lock; }
 
@@ -27,13 +37,37 @@ public:
 
 	void setAudioSettings(const AudioSettings& settings);
 
-	void fetchState(const FetchStateRequest& req, FetchStateResponse& state);
+	void setProcessingSettings(const ProcessingSettings& settings);
 
-	bool getSram(SystemIndex idx, DataBuffer<char>* target);
+	void fetchState(const FetchStateRequest& req, FetchStateResponse& state);
 
 	void onMenu(SystemIndex idx, std::vector<Menu*>& menus);
 
+	// Called on the thread that changes the processing settings, as that's where the histories
+	// are freed
+	RewindStats getRewindStats(SystemIndex idx) const { return _processingContext.getRewindStats(idx); }
+
+	void onMidi(int offset, int status, int data1, int data2);
+
 	void process(float** outputs, size_t frameCount);
 
+	// Called by the audio thread before each block with the host's offline render flag
+	void setOffline(bool offline);
+
+	// Starts the extra worker threads for offline rendering once it's first been asked for.
+	// Called regularly from a thread other than the audio thread.
+	void updateWorkerThreads();
+
+	// Safe to call from any thread
+	bool isOffline() const { return _processingContext.isOffline(); }
+
+	// Latency in samples introduced by lookahead rendering
+	size_t getLatency() const { return _lookahead.getLatency(); }
+
 	AudioLuaContextPtr& getLuaContext() { return _lua; }
+
+private:
+	void updateLookahead();
+
+	void render(float** outputs, size_t frameCount);
 };
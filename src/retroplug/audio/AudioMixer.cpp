@@ -0,0 +1,146 @@
+#include "AudioMixer.h"
+
+#include "platform/Cpu.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define RP_MIXER_X86
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__aarch64__) || defined(_M_ARM64)
+#define RP_MIXER_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(RP_MIXER_X86) && (defined(__GNUC__) || defined(__clang__))
+#define RP_TARGET(x) __attribute__((target(x)))
+#else
+#define RP_TARGET(x)
+#endif
+
+// Matches the conversion SameBoy samples have always had: -32768..32767 maps to -1..1
+const float S16_SCALE = 0.00003051804379339284f;
+const float S16_BIAS = 32768.0f * S16_SCALE - 1.0f;
+
+using MixKernel = void(*)(float*, float*, const int16_t*, size_t, float, float);
+
+static void mixScalar(float* left, float* right, const int16_t* source, size_t frameCount, float scale, float bias) {
+	for (size_t i = 0; i < frameCount; ++i) {
+		left[i] += (float)source[i * 2] * scale + bias;
+		right[i] += (float)source[i * 2 + 1] * scale + bias;
+	}
+}
+
+#ifdef RP_MIXER_X86
+RP_TARGET("sse2")
+static void mixSse2(float* left, float* right, const int16_t* source, size_t frameCount, float scale, float bias) {
+	const __m128 vscale = _mm_set1_ps(scale);
+	const __m128 vbias = _mm_set1_ps(bias);
+
+	size_t i = 0;
+	for (; i + 4 <= frameCount; i += 4) {
+		// LRLRLRLR -> sign extended 32 bit -> float
+		__m128i s = _mm_loadu_si128((const __m128i*)(source + i * 2));
+		__m128 a = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16));
+		__m128 b = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16));
+
+		__m128 l = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+		__m128 r = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+
+		l = _mm_add_ps(_mm_mul_ps(l, vscale), vbias);
+		r = _mm_add_ps(_mm_mul_ps(r, vscale), vbias);
+
+		_mm_storeu_ps(left + i, _mm_add_ps(_mm_loadu_ps(left + i), l));
+		_mm_storeu_ps(right + i, _mm_add_ps(_mm_loadu_ps(right + i), r));
+	}
+
+	mixScalar(left + i, right + i, source + i * 2, frameCount - i, scale, bias);
+}
+
+RP_TARGET("avx2")
+static void mixAvx2(float* left, float* right, const int16_t* source, size_t frameCount, float scale, float bias) {
+	const __m256 vscale = _mm256_set1_ps(scale);
+	const __m256 vbias = _mm256_set1_ps(bias);
+
+	size_t i = 0;
+	for (; i + 8 <= frameCount; i += 8) {
+		__m128i s0 = _mm_loadu_si128((const __m128i*)(source + i * 2));
+		__m128i s1 = _mm_loadu_si128((const __m128i*)(source + i * 2 + 8));
+		__m256 a = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(s0));
+		__m256 b = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(s1));
+
+		// Shuffles work within 128 bit lanes, so the pairs need reordering afterwards
+		__m256 l = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+		__m256 r = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+		l = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(l), _MM_SHUFFLE(3, 1, 2, 0)));
+		r = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(r), _MM_SHUFFLE(3, 1, 2, 0)));
+
+		l = _mm256_add_ps(_mm256_mul_ps(l, vscale), vbias);
+		r = _mm256_add_ps(_mm256_mul_ps(r, vscale), vbias);
+
+		_mm256_storeu_ps(left + i, _mm256_add_ps(_mm256_loadu_ps(left + i), l));
+		_mm256_storeu_ps(right + i, _mm256_add_ps(_mm256_loadu_ps(right + i), r));
+	}
+
+	mixSse2(left + i, right + i, source + i * 2, frameCount - i, scale, bias);
+}
+#endif
+
+#ifdef RP_MIXER_NEON
+static void mixNeon(float* left, float* right, const int16_t* source, size_t frameCount, float scale, float bias) {
+	const float32x4_t vscale = vdupq_n_f32(scale);
+	const float32x4_t vbias = vdupq_n_f32(bias);
+
+	size_t i = 0;
+	for (; i + 8 <= frameCount; i += 8) {
+		// vld2 de-interleaves for free
+		int16x8x2_t s = vld2q_s16(source + i * 2);
+
+		float32x4_t l0 = vcvtq_f32_s32(vmovl_s16(vget_low_s16(s.val[0])));
+		float32x4_t l1 = vcvtq_f32_s32(vmovl_s16(vget_high_s16(s.val[0])));
+		float32x4_t r0 = vcvtq_f32_s32(vmovl_s16(vget_low_s16(s.val[1])));
+		float32x4_t r1 = vcvtq_f32_s32(vmovl_s16(vget_high_s16(s.val[1])));
+
+		vst1q_f32(left + i, vmlaq_f32(vaddq_f32(vld1q_f32(left + i), vbias), l0, vscale));
+		vst1q_f32(left + i + 4, vmlaq_f32(vaddq_f32(vld1q_f32(left + i + 4), vbias), l1, vscale));
+		vst1q_f32(right + i, vmlaq_f32(vaddq_f32(vld1q_f32(right + i), vbias), r0, vscale));
+		vst1q_f32(right + i + 4, vmlaq_f32(vaddq_f32(vld1q_f32(right + i + 4), vbias), r1, vscale));
+	}
+
+	mixScalar(left + i, right + i, source + i * 2, frameCount - i, scale, bias);
+}
+#endif
+
+struct KernelDesc {
+	MixKernel func;
+	const char* name;
+};
+
+static KernelDesc selectKernel() {
+#if defined(RP_MIXER_X86)
+	if (cpu::hasAvx2()) {
+		return { mixAvx2, "AVX2" };
+	}
+
+	if (cpu::hasSse2()) {
+		return { mixSse2, "SSE2" };
+	}
+#elif defined(RP_MIXER_NEON)
+	return { mixNeon, "NEON" };
+#endif
+
+	return { mixScalar, "Scalar" };
+}
+
+static const KernelDesc& getKernel() {
+	static KernelDesc kernel = selectKernel();
+	return kernel;
+}
+
+namespace AudioMixer {
+	void mixS16Stereo(float* left, float* right, const int16_t* source, size_t frameCount, float gain) {
+		getKernel().func(left, right, source, frameCount, S16_SCALE * gain, S16_BIAS * gain);
+	}
+
+	const char* getKernelName() {
+		return getKernel().name;
+	}
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace AudioMixer {
+	// Converts interleaved stereo int16 samples to float, applies gain, and adds the result to
+	// the left and right output channels.  The fastest kernel the CPU supports is chosen the
+	// first time this is called.
+	void mixS16Stereo(float* left, float* right, const int16_t* source, size_t frameCount, float gain);
+
+	// Name of the kernel in use, for logging
+	const char* getKernelName();
+}
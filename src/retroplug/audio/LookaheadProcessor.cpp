@@ -0,0 +1,211 @@
+#include "LookaheadProcessor.h"
+
+#include <algorithm>
+#include <spdlog/spdlog.h>
+
+#include "platform/Thread.h"
+
+const int64_t RENDER_WAIT_TIMEOUT_US = 10000;
+
+static size_t nextPowerOfTwo(size_t v) {
+	size_t p = 1;
+	while (p < v) {
+		p <<= 1;
+	}
+
+	return p;
+}
+
+void LookaheadProcessor::start(size_t latency, size_t channelCount, RenderFunc render) {
+	stop();
+
+#ifndef RP_WEB
+	if (latency == 0) {
+		return;
+	}
+
+	_latency = latency;
+	_channelCount = std::min(channelCount, LOOKAHEAD_MAX_CHANNELS);
+	_render = render;
+
+	// The FIFO never holds more than the lookahead plus the block currently being rendered
+	size_t capacity = nextPowerOfTwo(latency + LOOKAHEAD_MAX_BLOCK_SIZE * 2);
+	_fifoMask = capacity - 1;
+
+	for (size_t i = 0; i < LOOKAHEAD_MAX_CHANNELS; ++i) {
+		_fifo[i].assign(capacity, 0.0f);
+		_scratch[i].assign(LOOKAHEAD_MAX_BLOCK_SIZE, 0.0f);
+	}
+
+	// Prefilling with silence is what creates the lookahead
+	_readPos = 0;
+	_writePos = latency;
+	_dropFrames = 0;
+	_underruns = 0;
+	_overflowFrames = 0;
+	_pending.midiCount = 0;
+
+	_running = true;
+	_thread = std::thread(&LookaheadProcessor::renderLoop, this);
+
+	// The host thread does little more than copy samples while lookahead is active, so the
+	// render thread shares its core rather than competing with the processing workers.
+	setupRealtimeThread(_thread, 0, "lookahead render thread");
+
+	_active = true;
+
+	spdlog::info("Started lookahead rendering with {} samples of latency", latency);
+#endif
+}
+
+void LookaheadProcessor::stop() {
+	_active = false;
+
+	while (_hostInside.load()) {
+		std::this_thread::yield();
+	}
+
+	if (!_thread.joinable()) {
+		return;
+	}
+
+	_running = false;
+	_thread.join();
+
+	LookaheadBlock block;
+	while (_blocks.try_dequeue(block)) {}
+
+	size_t underruns = _underruns.load();
+	if (underruns > 0) {
+		spdlog::warn("Lookahead rendering underran {} times", underruns);
+	}
+
+	size_t overflowFrames = _overflowFrames.load();
+	if (overflowFrames > 0) {
+		spdlog::warn("Lookahead rendering dropped {} samples that didn't fit in the FIFO", overflowFrames);
+	}
+}
+
+bool LookaheadProcessor::pushMidi(const LookaheadMidiEvent& ev) {
+	_hostInside = true;
+
+	if (!_active.load()) {
+		_hostInside = false;
+		return false;
+	}
+
+	if (_pending.midiCount < LOOKAHEAD_MAX_MIDI_EVENTS) {
+		_pending.midi[_pending.midiCount++] = ev;
+	}
+
+	_hostInside = false;
+	return true;
+}
+
+bool LookaheadProcessor::process(float** outputs, size_t frameCount, const TimeInfo& timeInfo) {
+	_hostInside = true;
+
+	if (!_active.load()) {
+		_hostInside = false;
+		return false;
+	}
+
+	// Blocks larger than the render scratch are split, with each MIDI event going to the
+	// piece it lands in.
+	LookaheadBlock block;
+	for (size_t offset = 0; offset < frameCount; offset += LOOKAHEAD_MAX_BLOCK_SIZE) {
+		size_t count = std::min(frameCount - offset, LOOKAHEAD_MAX_BLOCK_SIZE);
+		bool last = offset + count == frameCount;
+
+		block.frameCount = count;
+		block.timeInfo = timeInfo;
+		block.midiCount = 0;
+
+		for (size_t i = 0; i < _pending.midiCount; ++i) {
+			LookaheadMidiEvent ev = _pending.midi[i];
+			if ((ev.offset >= (int)offset && ev.offset < (int)(offset + count)) || (last && ev.offset >= (int)(offset + count))) {
+				ev.offset -= (int)offset;
+				block.midi[block.midiCount++] = ev;
+			}
+		}
+
+		if (!_blocks.try_enqueue(block)) {
+			_underruns.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	_pending.midiCount = 0;
+
+	size_t read = _readPos.load(std::memory_order_relaxed);
+	size_t available = _writePos.load(std::memory_order_acquire) - read;
+
+	if (_dropFrames > 0) {
+		size_t dropped = std::min(_dropFrames, available);
+		read += dropped;
+		available -= dropped;
+		_dropFrames -= dropped;
+	}
+
+	size_t count = std::min(available, frameCount);
+	for (size_t c = 0; c < _channelCount; ++c) {
+		const float* source = _fifo[c].data();
+		for (size_t i = 0; i < count; ++i) {
+			outputs[c][i] += source[(read + i) & _fifoMask];
+		}
+	}
+
+	if (count < frameCount) {
+		// The render thread fell behind.  The missing samples stay silent and are skipped when
+		// they arrive so the reported latency remains correct.
+		_dropFrames += frameCount - count;
+		_underruns.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	_readPos.store(read + count, std::memory_order_release);
+
+	_hostInside = false;
+	return true;
+}
+
+void LookaheadProcessor::renderLoop() {
+	LookaheadBlock block;
+	float* channels[LOOKAHEAD_MAX_CHANNELS];
+
+	for (size_t i = 0; i < LOOKAHEAD_MAX_CHANNELS; ++i) {
+		channels[i] = _scratch[i].data();
+	}
+
+	while (_running.load(std::memory_order_acquire)) {
+		if (!_blocks.wait_dequeue_timed(block, RENDER_WAIT_TIMEOUT_US)) {
+			continue;
+		}
+
+		for (size_t i = 0; i < LOOKAHEAD_MAX_CHANNELS; ++i) {
+			std::fill(channels[i], channels[i] + block.frameCount, 0.0f);
+		}
+
+		_render(block, channels);
+		writeFifo(channels, block.frameCount);
+	}
+}
+
+void LookaheadProcessor::writeFifo(float** data, size_t frameCount) {
+	size_t write = _writePos.load(std::memory_order_relaxed);
+	size_t free = _fifoMask + 1 - (write - _readPos.load(std::memory_order_acquire));
+
+	// Only happens when the host sends blocks larger than the FIFO was sized for, and the render
+	// thread gets ahead of the host
+	if (frameCount > free) {
+		_overflowFrames.fetch_add(frameCount - free, std::memory_order_relaxed);
+		frameCount = free;
+	}
+
+	for (size_t c = 0; c < _channelCount; ++c) {
+		float* target = _fifo[c].data();
+		for (size_t i = 0; i < frameCount; ++i) {
+			target[(write + i) & _fifoMask] = data[c][i];
+		}
+	}
+
+	_writePos.store(write + frameCount, std::memory_order_release);
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "luawrapper/AudioLuaContext.h"
+#include "micromsg/readerwriterqueue.h"
+
+const size_t LOOKAHEAD_MAX_CHANNELS = 8;
+const size_t LOOKAHEAD_MAX_MIDI_EVENTS = 128;
+const size_t LOOKAHEAD_MAX_BLOCK_SIZE = 8192;
+const size_t LOOKAHEAD_MAX_QUEUED_BLOCKS = 64;
+
+struct LookaheadMidiEvent {
+	int offset;
+	int status;
+	int data1;
+	int data2;
+};
+
+// Everything the render thread needs to reproduce a host block: its size, the transport state
+// at the start of it, and the MIDI that arrived with it.
+struct LookaheadBlock {
+	size_t frameCount = 0;
+	TimeInfo timeInfo;
+	size_t midiCount = 0;
+	LookaheadMidiEvent midi[LOOKAHEAD_MAX_MIDI_EVENTS];
+};
+
+// Renders host blocks on a dedicated thread a fixed number of samples ahead of the host.  The
+// host callback only queues the block description and copies finished samples out of a FIFO,
+// so a slow block (a heavy linked session, a GC pause in Lua) is absorbed by the lookahead
+// rather than causing a dropout.  The lookahead is reported to the host as plugin latency.
+class LookaheadProcessor {
+public:
+	using RenderFunc = std::function<void(const LookaheadBlock&, float**)>;
+
+private:
+	std::thread _thread;
+	std::atomic_bool _running = false;
+
+	// Guards start/stop against the host callback using the buffers
+	std::atomic_bool _active = false;
+	std::atomic_bool _hostInside = false;
+
+	moodycamel::BlockingReaderWriterQueue<LookaheadBlock> _blocks;
+	LookaheadBlock _pending;
+
+	RenderFunc _render;
+	size_t _channelCount = 0;
+	size_t _latency = 0;
+
+	// Single producer (render thread) / single consumer (host) sample FIFO
+	std::vector<float> _fifo[LOOKAHEAD_MAX_CHANNELS];
+	size_t _fifoMask = 0;
+	std::atomic<size_t> _writePos = 0;
+	std::atomic<size_t> _readPos = 0;
+
+	// Samples that were replaced by silence during an underrun, and still need to be skipped
+	// when they eventually arrive so the latency stays constant.
+	size_t _dropFrames = 0;
+	std::atomic<size_t> _underruns = 0;
+
+	// Rendered samples that didn't fit in the FIFO and were thrown away
+	std::atomic<size_t> _overflowFrames = 0;
+
+	std::vector<float> _scratch[LOOKAHEAD_MAX_CHANNELS];
+
+public:
+	LookaheadProcessor(): _blocks(LOOKAHEAD_MAX_QUEUED_BLOCKS) {}
+	~LookaheadProcessor() { stop(); }
+
+	void start(size_t latency, size_t channelCount, RenderFunc render);
+
+	void stop();
+
+	bool isActive() const { return _active.load(); }
+
+	size_t getLatency() const { return _active.load() ? _latency : 0; }
+
+	size_t getChannelCount() const { return _channelCount; }
+
+	size_t getUnderrunCount() const { return _underruns.load(std::memory_order_relaxed); }
+
+	size_t getOverflowFrameCount() const { return _overflowFrames.load(std::memory_order_relaxed); }
+
+	// Host thread.  Returns false if lookahead is not active and the block should be rendered
+	// directly.
+	bool pushMidi(const LookaheadMidiEvent& ev);
+
+	// Host thread.  Returns false if lookahead is not active and the block should be rendered
+	// directly.
+	bool process(float** outputs, size_t frameCount, const TimeInfo& timeInfo);
+
+private:
+	void renderLoop();
+
+	void writeFifo(float** data, size_t frameCount);
+};
@@ -0,0 +1,71 @@
+#include "ProcessProfiler.h"
+
+void ProcessProfiler::setEnabled(bool enabled) {
+	if (enabled) {
+		for (ProcessTimingSnapshotPtr& snapshot : _snapshots) {
+			if (!snapshot) {
+				snapshot = std::make_shared<ProcessTimingSnapshot>();
+			}
+		}
+	}
+
+	if (enabled != _enabled) {
+		_head = 0;
+		_count = 0;
+		_samplesSinceSnapshot = 0;
+		_enabled = enabled;
+	}
+}
+
+void ProcessProfiler::beginBlock(size_t frameCount) {
+	_current = BlockTiming();
+	_current.frameCount = (uint32_t)frameCount;
+}
+
+void ProcessProfiler::endBlock(Node* node, double sampleRate, size_t systemCount) {
+	if (!_enabled) {
+		return;
+	}
+
+	_blocks[(_head + _count) % PROCESS_TIMING_BLOCKS] = _current;
+	if (_count < PROCESS_TIMING_BLOCKS) {
+		_count++;
+	} else {
+		_head = (_head + 1) % PROCESS_TIMING_BLOCKS;
+	}
+
+	_samplesSinceSnapshot += _current.frameCount;
+	if (_samplesSinceSnapshot < (size_t)(sampleRate * PROFILER_SNAPSHOT_SECONDS) || !node || !node->canPush<calls::ProcessTimings>()) {
+		return;
+	}
+
+	// If the UI is still holding every buffer, try again next block
+	ProcessTimingSnapshotPtr snapshot;
+	if (!acquire(snapshot)) {
+		return;
+	}
+
+	snapshot->sampleRate = sampleRate;
+	snapshot->systemCount = systemCount;
+	snapshot->blockCount = _count;
+	snapshot->lookaheadUnderruns = _lookaheadUnderruns;
+	snapshot->lookaheadOverflowFrames = _lookaheadOverflowFrames;
+
+	for (size_t i = 0; i < _count; ++i) {
+		snapshot->blocks[i] = _blocks[(_head + i) % PROCESS_TIMING_BLOCKS];
+	}
+
+	node->push<calls::ProcessTimings>(NodeTypes::Ui, snapshot);
+	_samplesSinceSnapshot = 0;
+}
+
+ProcessTimingSnapshot* ProcessProfiler::acquire(ProcessTimingSnapshotPtr& target) {
+	for (ProcessTimingSnapshotPtr& snapshot : _snapshots) {
+		if (snapshot && snapshot.use_count() == 1) {
+			target = snapshot;
+			return target.get();
+		}
+	}
+
+	return nullptr;
+}
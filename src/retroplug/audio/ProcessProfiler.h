@@ -0,0 +1,91 @@
+#pragma once
+
+#include <chrono>
+
+#include "Constants.h"
+#include "messaging.h"
+#include "model/ProcessTimings.h"
+
+const size_t PROFILER_SNAPSHOT_BUFFERS = 2;
+
+// How often the timings of the most recent blocks are sent to the UI
+const double PROFILER_SNAPSHOT_SECONDS = 0.5;
+
+// Times the phases of each audio block in to a ring of the most recent blocks, and every so
+// often sends a copy of the ring to the UI.  Everything is allocated when the profiler is
+// enabled, and snapshot buffers are reused once the UI has let go of them, so nothing is
+// allocated or locked on the audio thread.  When disabled nothing is timed.
+class ProcessProfiler {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	// Adds the time from construction to destruction to a phase of the current block
+	class Scope {
+	private:
+		ProcessProfiler& _profiler;
+		ProcessPhase _phase;
+		bool _active;
+		Clock::time_point _start;
+
+	public:
+		Scope(ProcessProfiler& profiler, ProcessPhase phase): _profiler(profiler), _phase(phase), _active(profiler.isEnabled()) {
+			if (_active) {
+				_start = Clock::now();
+			}
+		}
+
+		~Scope() {
+			if (_active) {
+				_profiler.add(_phase, toMicros(Clock::now() - _start));
+			}
+		}
+	};
+
+private:
+	bool _enabled = false;
+
+	BlockTiming _blocks[PROCESS_TIMING_BLOCKS];
+	size_t _head = 0;
+	size_t _count = 0;
+
+	BlockTiming _current;
+
+	ProcessTimingSnapshotPtr _snapshots[PROFILER_SNAPSHOT_BUFFERS];
+	size_t _samplesSinceSnapshot = 0;
+
+	size_t _lookaheadUnderruns = 0;
+	size_t _lookaheadOverflowFrames = 0;
+
+public:
+	// Not called from the audio thread, as the snapshot buffers are allocated the first time the
+	// profiler is enabled
+	void setEnabled(bool enabled);
+
+	bool isEnabled() const { return _enabled; }
+
+	void beginBlock(size_t frameCount);
+
+	void add(ProcessPhase phase, double micros) {
+		_current.phases[(size_t)phase] += (float)micros;
+	}
+
+	void addSystem(SystemIndex idx, double micros) {
+		_current.systems[idx] += (float)micros;
+	}
+
+	// Counters from the lookahead renderer, sent with the next snapshot
+	void setLookaheadCounts(size_t underruns, size_t overflowFrames) {
+		_lookaheadUnderruns = underruns;
+		_lookaheadOverflowFrames = overflowFrames;
+	}
+
+	// Stores the current block, and sends the ring to the UI if it is time to
+	void endBlock(Node* node, double sampleRate, size_t systemCount);
+
+	static double toMicros(Clock::duration duration) {
+		return std::chrono::duration<double, std::micro>(duration).count();
+	}
+
+private:
+	ProcessTimingSnapshot* acquire(ProcessTimingSnapshotPtr& target);
+};
@@ -0,0 +1,68 @@
+#include "SramSnapshotter.h"
+
+#include "model/ProcessingContext.h"
+
+void SramSnapshotter::setSystemCount(size_t count) {
+	for (size_t i = 0; i < count; ++i) {
+		for (size_t j = 0; j < SRAM_BUFFERS_PER_SYSTEM; ++j) {
+			if (!_buffers[i][j]) {
+				_buffers[i][j] = std::make_shared<DataBuffer<char>>(MAX_SRAM_SIZE);
+			}
+		}
+	}
+}
+
+void SramSnapshotter::update(ProcessingContext& ctx, Node* node, size_t frameCount, double sampleRate) {
+	size_t interval = (size_t)(sampleRate * SRAM_SNAPSHOT_SECONDS);
+
+	for (SystemIndex i = 0; i < (SystemIndex)ctx.getSystemCount(); ++i) {
+		SameBoyPlugPtr& system = ctx.getSystem(i);
+		if (!system) {
+			_dirty[i] = false;
+			continue;
+		}
+
+		if (system->consumeDirtyPages() > 0) {
+			_dirty[i] = true;
+		}
+
+		if (_samplesSinceSnapshot[i] < interval) {
+			_samplesSinceSnapshot[i] += frameCount;
+		}
+
+		if (!_dirty[i] || _samplesSinceSnapshot[i] < interval || !node->canPush<calls::SramChanged>()) {
+			continue;
+		}
+
+		size_t size = system->sramSize();
+		if (size == 0 || size > MAX_SRAM_SIZE) {
+			_dirty[i] = false;
+			continue;
+		}
+
+		// If the UI is still holding every buffer, try again next block
+		DataBufferPtr buffer;
+		if (!acquire(i, buffer)) {
+			continue;
+		}
+
+		buffer->resize(size);
+		system->saveSram(buffer->data(), buffer->size());
+
+		node->push<calls::SramChanged>(NodeTypes::Ui, SetDataRequest { i, buffer, false, system->getDesc().instanceId });
+
+		_dirty[i] = false;
+		_samplesSinceSnapshot[i] = 0;
+	}
+}
+
+DataBuffer<char>* SramSnapshotter::acquire(SystemIndex idx, DataBufferPtr& target) {
+	for (DataBufferPtr& buffer : _buffers[idx]) {
+		if (buffer.use_count() == 1) {
+			target = buffer;
+			return target.get();
+		}
+	}
+
+	return nullptr;
+}
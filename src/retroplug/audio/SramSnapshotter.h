@@ -0,0 +1,33 @@
+#pragma once
+
+#include "Constants.h"
+#include "messaging.h"
+#include "util/DataBuffer.h"
+
+class ProcessingContext;
+
+const size_t SRAM_BUFFERS_PER_SYSTEM = 2;
+
+// How long to wait after a snapshot before taking another, so a game writing constantly
+// doesn't copy cart RAM every block.
+const double SRAM_SNAPSHOT_SECONDS = 0.25;
+
+// Copies cart RAM out of systems that have written to it, on a block boundary, and sends the
+// copies to the UI.  The buffers are allocated when the system count is set and reused once the
+// UI has let go of them, so nothing is allocated on the audio thread.
+class SramSnapshotter {
+private:
+	DataBufferPtr _buffers[MAX_SYSTEMS][SRAM_BUFFERS_PER_SYSTEM];
+	bool _dirty[MAX_SYSTEMS] = { false };
+	size_t _samplesSinceSnapshot[MAX_SYSTEMS] = { 0 };
+
+public:
+	// Allocates buffers for any slots below `count` that don't have them yet.  Buffers are kept
+	// if the count goes down.
+	void setSystemCount(size_t count);
+
+	void update(ProcessingContext& ctx, Node* node, size_t frameCount, double sampleRate);
+
+private:
+	DataBuffer<char>* acquire(SystemIndex idx, DataBufferPtr& target);
+};
@@ -0,0 +1,168 @@
+#include "WorkerPool.h"
+
+#include <assert.h>
+#include <algorithm>
+#include <spdlog/spdlog.h>
+
+#include "plugs/SameBoyPlug.h"
+#include "platform/Thread.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#define CPU_RELAX() _mm_pause()
+#elif defined(__aarch64__) || defined(__arm__)
+#define CPU_RELAX() __asm__ __volatile__("yield")
+#else
+#define CPU_RELAX()
+#endif
+
+// Workers spin for this many iterations after finishing a job before they park.  Host blocks
+// arrive every few milliseconds, so workers only spin through the gaps inside a block.
+const size_t WORKER_SPIN_COUNT = 4096;
+
+const uint64_t CURSOR_MASK = 0xFFFF;
+
+void WorkerPool::start(size_t threadCount, size_t activeCount) {
+	stop();
+
+#ifndef RP_WEB
+	if (threadCount == 0) {
+		return;
+	}
+
+	_running = true;
+	_activeCount = std::min(activeCount, threadCount);
+
+	_threads.reserve(threadCount);
+	for (size_t i = 0; i < threadCount; ++i) {
+		_threads.emplace_back(&WorkerPool::workerLoop, this, i);
+		// Core 0 is left for the host, which is where the audio thread tends to end up
+		setupRealtimeThread(_threads.back(), i + 1, "processing worker");
+	}
+
+	spdlog::info("Started {} processing worker threads, {} active", threadCount, (size_t)_activeCount);
+#endif
+}
+
+void WorkerPool::stop() {
+	if (_threads.empty()) {
+		return;
+	}
+
+	_running = false;
+	wakeParked();
+	_activate.signal(_threads.size());
+
+	for (std::thread& thread : _threads) {
+		thread.join();
+	}
+
+	_threads.clear();
+	_activeCount = 0;
+}
+
+void WorkerPool::setActiveCount(size_t activeCount) {
+	activeCount = std::min(activeCount, _threads.size());
+
+	size_t prev = _activeCount.exchange(activeCount, std::memory_order_seq_cst);
+	if (activeCount > prev) {
+		// Any inactive worker may take a wake, so all of them are woken and the ones that are
+		// still inactive go back to sleep
+		_activate.signal(_threads.size() - prev);
+	}
+}
+
+void WorkerPool::dispatch(SameBoyPlug** plugs, size_t plugCount, size_t frameCount) {
+	assert(plugCount <= MAX_SYSTEMS);
+
+	for (size_t i = 0; i < plugCount; ++i) {
+		_jobs[i] = plugs[i];
+	}
+
+	_frameCount = frameCount;
+	_remaining.store((uint32_t)plugCount, std::memory_order_relaxed);
+
+	_generation++;
+	_cursor.store(((uint64_t)_generation << 32) | ((uint64_t)plugCount << 16), std::memory_order_seq_cst);
+
+	wakeParked();
+}
+
+void WorkerPool::wait() {
+	while (runNext()) {}
+
+	while (_remaining.load(std::memory_order_acquire) > 0) {
+		CPU_RELAX();
+	}
+}
+
+bool WorkerPool::runNext() {
+	uint64_t cursor = _cursor.load(std::memory_order_acquire);
+
+	while ((cursor & CURSOR_MASK) < ((cursor >> 16) & CURSOR_MASK)) {
+		if (_cursor.compare_exchange_weak(cursor, cursor + 1, std::memory_order_acq_rel, std::memory_order_acquire)) {
+			_jobs[cursor & CURSOR_MASK]->update(_frameCount);
+			_remaining.fetch_sub(1, std::memory_order_release);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool WorkerPool::hasWork() const {
+	uint64_t cursor = _cursor.load(std::memory_order_acquire);
+	return (cursor & CURSOR_MASK) < ((cursor >> 16) & CURSOR_MASK);
+}
+
+void WorkerPool::wakeParked() {
+	// Posts one wake for each worker that registered before this point.  Wakes are
+	// interchangeable, so it doesn't matter which worker takes which.
+	uint32_t parked = _parked.exchange(0, std::memory_order_seq_cst);
+	if (parked > 0) {
+		_wake.signal(parked);
+	}
+}
+
+void WorkerPool::park() {
+	_parked.fetch_add(1, std::memory_order_seq_cst);
+
+	// Work or a stop that arrived before registering would not have woken this worker
+	if (hasWork() || !_running.load(std::memory_order_seq_cst)) {
+		uint32_t parked = _parked.load(std::memory_order_relaxed);
+		while (parked > 0) {
+			if (_parked.compare_exchange_weak(parked, parked - 1, std::memory_order_seq_cst)) {
+				return;
+			}
+		}
+
+		// A wake has already been posted for this registration, so the wait below takes it
+	}
+
+	_wake.wait();
+}
+
+void WorkerPool::waitActive(size_t idx) {
+	while (idx >= _activeCount.load(std::memory_order_seq_cst) && _running.load(std::memory_order_seq_cst)) {
+		_activate.wait();
+	}
+}
+
+void WorkerPool::workerLoop(size_t idx) {
+	size_t spins = 0;
+
+	while (_running.load(std::memory_order_acquire)) {
+		if (idx >= _activeCount.load(std::memory_order_relaxed)) {
+			waitActive(idx);
+			spins = 0;
+		} else if (runNext()) {
+			spins = 0;
+		} else if (spins < WORKER_SPIN_COUNT) {
+			spins++;
+			CPU_RELAX();
+		} else {
+			park();
+			spins = 0;
+		}
+	}
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "Constants.h"
+#include "platform/Thread.h"
+
+class SameBoyPlug;
+
+// Runs SameBoyPlug::update for a set of systems on pre-spawned worker threads.  The audio
+// thread publishes a block with dispatch(), is free to do other work (such as linked systems),
+// and then joins the block with wait(), processing any jobs the workers have not picked up yet.
+// Nothing is allocated or locked per block.  Workers spin for a short while after each block,
+// then park until the next dispatch wakes them.  Workers past the active count sleep until
+// they're made active again, so the count can change on the audio thread without starting or
+// joining threads.
+class WorkerPool {
+private:
+	std::vector<std::thread> _threads;
+	std::atomic_bool _running = false;
+
+	std::atomic<size_t> _activeCount = 0;
+	Semaphore _activate;
+
+	// Packed block cursor: generation (32 bits) | job count (16 bits) | next job (16 bits).
+	// The generation stops a worker that is late from claiming jobs of a newer block.
+	std::atomic<uint64_t> _cursor = 0;
+	std::atomic<uint32_t> _remaining = 0;
+	uint32_t _generation = 0;
+
+	SameBoyPlug* _jobs[MAX_SYSTEMS] = { nullptr };
+	size_t _frameCount = 0;
+
+	// Workers that are parked, or about to park, on _wake
+	std::atomic<uint32_t> _parked = 0;
+	Semaphore _wake;
+
+public:
+	WorkerPool() {}
+	~WorkerPool() { stop(); }
+
+	// Starts threadCount threads, of which activeCount take jobs
+	void start(size_t threadCount, size_t activeCount);
+
+	void stop();
+
+	size_t getThreadCount() const { return _threads.size(); }
+
+	// Sets how many of the started threads take jobs.  Safe to call from the audio thread.
+	void setActiveCount(size_t activeCount);
+
+	void dispatch(SameBoyPlug** plugs, size_t plugCount, size_t frameCount);
+
+	void wait();
+
+private:
+	bool runNext();
+
+	bool hasWork() const;
+
+	void park();
+
+	void wakeParked();
+
+	// Sleeps until the worker is active again or the pool stops
+	void waitActive(size_t idx);
+
+	void workerLoop(size_t idx);
+};
@@ -5,6 +5,7 @@
 #include "platform/Logger.h"
 #include "platform/Platform.h"
 #include "platform/Menu.h"
+#include "platform/RtGuard.h"
 #include "util/fs.h"
 #include "model/ProcessingContext.h"
 #include "plugs/SameBoyPlug.h"
@@ -57,7 +58,10 @@ bool AudioLuaContext::setup() {
 	s.new_usertype<ProcessingContext>("ProcessingContext",
 		"getSettings", &ProcessingContext::getSettings,
 		"getSystem", &ProcessingContext::getSystem,
-		"getButtonPresses", &ProcessingContext::getButtonPresses
+		"getSystemCount", &ProcessingContext::getSystemCount,
+		"getButtonPresses", &ProcessingContext::getButtonPresses,
+		"rewind", &ProcessingContext::rewind,
+		"scrub", &ProcessingContext::scrub
 	);
 
 	s.new_usertype<SameBoyPlugDesc>("SameBoyPlugDesc",
@@ -66,11 +70,13 @@ bool AudioLuaContext::setup() {
 
 	s.new_usertype<SameBoyPlug>("SameBoyPlug",
 		"sendSerialByte", &SameBoyPlug::sendSerialByte,
+		"getGain", &SameBoyPlug::getGain,
+		"setGain", &SameBoyPlug::setGain,
 		"getDesc", &SameBoyPlug::getDesc,
 		"getSramData", &SameBoyPlug::getSramData,
-		"hashSram", [](SameBoyPlug& plug, size_t start, size_t size) {
-			return (uint32_t)plug.hashSram(start, size);
-		}
+		"getButtonOverflowCount", &SameBoyPlug::getButtonOverflowCount,
+		"getSerialOverflowCount", &SameBoyPlug::getSerialOverflowCount,
+		"getSramGeneration", &SameBoyPlug::getSramGeneration
 	);
 
 	s.new_usertype<TimeInfo>("TimeInfo",
@@ -173,6 +179,7 @@ void AudioLuaContext::setSampleRate(double sampleRate) {
 
 void AudioLuaContext::update(int frameCount) {
 	if (_valid) {
+		rtguard::Scope guard("Lua update");
 		callFunc(_controller, "update", frameCount);
 	}
 }
@@ -185,6 +192,7 @@ void AudioLuaContext::closeProject() {
 
 void AudioLuaContext::onMidi(int offset, int status, int data1, int data2) {
 	if (_valid) {
+		rtguard::Scope guard("Lua onMidi");
 		callFunc(_controller, "onMidi", offset, status, data1, data2);
 	}
 }
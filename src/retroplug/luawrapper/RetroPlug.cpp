@@ -4,6 +4,7 @@
 
 #include "model/Project.h"
 #include "model/AudioContextProxy.h"
+#include "model/StateCodec.h"
 #include "platform/ViewWrapper.h"
 #include "platform/Path.h"
 #include "platform/Shell.h"
@@ -40,6 +41,28 @@ void luawrappers::registerRetroPlug(sol::state& s) {
 		#endif
 	);
 
+	s.create_named_table("statecodec",
+		"isEncoded", [](DataBuffer<char>* data) {
+			return data && StateCodec::isEncoded(data->data(), data->size());
+		},
+
+		"decode", [](DataBuffer<char>* data, DataBuffer<char>* keyframe) {
+			std::vector<char> key;
+			if (keyframe && !StateCodec::decode(keyframe->data(), keyframe->size(), nullptr, 0, key)) {
+				return DataBufferPtr();
+			}
+
+			std::vector<char> state;
+			if (!StateCodec::decode(data->data(), data->size(), key.empty() ? nullptr : key.data(), key.size(), state)) {
+				return DataBufferPtr();
+			}
+
+			DataBufferPtr target = std::make_shared<DataBuffer<char>>(state.size());
+			target->write(state.data(), state.size());
+			return target;
+		}
+	);
+
 	s.new_usertype<SystemDesc>("SystemDesc",
 		"new", sol::factories(
 			[]() { return std::make_shared<SystemDesc>(); },
@@ -55,6 +78,7 @@ void luawrappers::registerRetroPlug(sol::state& s) {
 		"romData", &SystemDesc::romData,
 		"sramData", &SystemDesc::sramData,
 		"stateData", &SystemDesc::stateData,
+		"stateKeyData", &SystemDesc::stateKeyData,
 		"fastBoot", &SystemDesc::fastBoot,
 		"keyInputConfig", &SystemDesc::keyInputConfig,
 		"padInputConfig", &SystemDesc::padInputConfig,
@@ -81,12 +105,39 @@ void luawrappers::registerRetroPlug(sol::state& s) {
 		"setRom", &AudioContextProxy::setRom,
 		"setSram", &AudioContextProxy::setSram,
 		"setState", &AudioContextProxy::setState,
-		"updateSram", &AudioContextProxy::updateSram,
 		"updateSystemSettings", &AudioContextProxy::updateSystemSettings,
 		"updateSelected", &AudioContextProxy::updateSelected,
+		"setProcessingSettings", &AudioContextProxy::setProcessingSettings,
+		"getSystemCount", &AudioContextProxy::getSystemCount,
+		"rewind", &AudioContextProxy::rewind,
+		"scrub", &AudioContextProxy::scrub,
+		"getRewindStats", &AudioContextProxy::getRewindStats,
 		"onMenu", &AudioContextProxy::onMenu
 	);
 
+	s.new_usertype<ProcessingSettings>("ProcessingSettings",
+		sol::constructors<ProcessingSettings()>(),
+		"workerThreads", &ProcessingSettings::workerThreads,
+		"lookaheadBlocks", &ProcessingSettings::lookaheadBlocks,
+		"rewindSeconds", &ProcessingSettings::rewindSeconds,
+		"rewindMemoryMb", &ProcessingSettings::rewindMemoryMb,
+		"sramAutosaveSeconds", &ProcessingSettings::sramAutosaveSeconds,
+		"indexedVideo", &ProcessingSettings::indexedVideo,
+		"systemCount", &ProcessingSettings::systemCount,
+		"bootStates", &ProcessingSettings::bootStates,
+		"bootStatesOnDisk", &ProcessingSettings::bootStatesOnDisk,
+		"timingOverlay", &ProcessingSettings::timingOverlay
+	);
+
+	s.new_usertype<RewindStats>("RewindStats",
+		"snapshotCount", &RewindStats::snapshotCount,
+		"usedBytes", &RewindStats::usedBytes,
+		"storedSeconds", &RewindStats::storedSeconds,
+		"bytesPerSecond", &RewindStats::bytesPerSecond,
+		"lastEncodeMicros", &RewindStats::lastEncodeMicros,
+		"droppedSnapshots", &RewindStats::droppedSnapshots
+	);
+
 	s.new_usertype<ViewWrapper>("ViewWrapper",
 		"requestDialog", &ViewWrapper::requestDialog,
 		"requestMenu", &ViewWrapper::requestMenu
@@ -134,6 +185,7 @@ void luawrappers::registerRetroPlug(sol::state& s) {
 	s.new_usertype<FetchStateResponse>("FetchStateResponse",
 		"srams", &FetchStateResponse::srams,
 		"states", &FetchStateResponse::states,
+		"stateKeys", &FetchStateResponse::stateKeys,
 		"components", &FetchStateResponse::components
 	);
 }
@@ -2,6 +2,7 @@
 
 #include "micromsg/request.h"
 #include "micromsg/node.h"
+#include "micromsg/nodemanager.h"
 #include "Messages.h"
 
 #define DefinePush(name, arg) class name : public micromsg::Push<arg> {};
@@ -9,7 +10,6 @@
 
 namespace calls {
 	DefinePush(LoadRom, LoadRomDesc);
-	DefinePush(TransmitVideo, VideoStream);
 	DefinePush(UpdateProjectSettings, Project::Settings);
 	DefinePush(UpdateSystemSettings, SystemSettings);
 	DefinePush(PressButtons, ButtonPressState);
@@ -18,13 +18,15 @@ namespace calls {
 	DefinePush(ResetSystem, ResetSystemDesc);
 	DefinePush(EnableRendering, bool);
 	DefinePush(SramChanged, SetDataRequest);
+	DefinePush(Rewind, RewindDesc);
+	DefinePush(ProcessTimings, ProcessTimingSnapshotPtr);
 
 	DefineRequest(SwapLuaContext, AudioLuaContextPtr, AudioLuaContextPtr);
 	DefineRequest(SwapSystem, SystemSwapDesc, SystemSwapDesc);
-	DefineRequest(SetRom, SetDataRequest, DataBufferPtr);
+	DefineRequest(SetRom, SetRomRequest, SetRomRequest);
 	DefineRequest(SetSram, SetDataRequest, DataBufferPtr);
 	DefineRequest(SetState, SetDataRequest, DataBufferPtr);
-	DefineRequest(DuplicateSystem, SystemDuplicateDesc, SameBoyPlugPtr);
+	DefineRequest(DuplicateSystem, SystemDuplicateDesc, SystemDuplicateDesc);
 	DefineRequest(TakeSystem, SystemIndex, SameBoyPlugPtr);
 	DefineRequest(FetchState, FetchStateRequest, FetchStateResponse);
 
@@ -32,3 +34,27 @@ namespace calls {
 }
 
 using Node = micromsg::Node<NodeTypes>;
+
+// Registers every call passed between the UI and audio nodes, along with how many of each can be
+// in flight at once.  Per-system calls are sized so a whole project can be loaded in one go.
+inline void registerCalls(micromsg::NodeManager<NodeTypes>& bus) {
+	bus.addCall<calls::LoadRom>(MAX_SYSTEMS);
+	bus.addCall<calls::SwapSystem>(MAX_SYSTEMS);
+	bus.addCall<calls::TakeSystem>(MAX_SYSTEMS);
+	bus.addCall<calls::DuplicateSystem>(1);
+	bus.addCall<calls::ResetSystem>(MAX_SYSTEMS);
+	bus.addCall<calls::UpdateProjectSettings>(4);
+	bus.addCall<calls::UpdateSystemSettings>(MAX_SYSTEMS);
+	bus.addCall<calls::PressButtons>(32);
+	bus.addCall<calls::FetchState>(4);
+	bus.addCall<calls::ContextMenuResult>(1);
+	bus.addCall<calls::SwapLuaContext>(4);
+	bus.addCall<calls::SetActive>(4);
+	bus.addCall<calls::SetRom>(MAX_SYSTEMS);
+	bus.addCall<calls::SetSram>(MAX_SYSTEMS);
+	bus.addCall<calls::SetState>(MAX_SYSTEMS);
+	bus.addCall<calls::EnableRendering>(1);
+	bus.addCall<calls::SramChanged>(MAX_SYSTEMS);
+	bus.addCall<calls::Rewind>(8);
+	bus.addCall<calls::ProcessTimings>(2);
+}
@@ -158,10 +158,17 @@ namespace micromsg {
 
 			if (envelope->callTypeId == 0) {
 				mm_assert_m(envelope->callTypeId != 0, "Call type not found.  Did you remember to register your call?");
+				_alloc->free(envelope);
 				return false;
 			}
 
-			return send(target, envelope);
+			// The target's queue is full
+			if (!send(target, envelope)) {
+				_alloc->free(envelope);
+				return false;
+			}
+
+			return true;
 		}
 
 		template <typename RequestT, std::enable_if_t<IsPushType<RequestT>::value, int> = 0>
@@ -184,10 +191,17 @@ namespace micromsg {
 
 			if (envelope->callTypeId == 0) {
 				mm_assert_m(envelope->callTypeId != 0, "Call type not found.  Did you remember to register your call?");
+				_alloc->free(envelope);
 				return false;
 			}
 
-			return send(target, envelope);
+			// The target's queue is full
+			if (!send(target, envelope)) {
+				_alloc->free(envelope);
+				return false;
+			}
+
+			return true;
 		}
 
 		template <typename RequestT, std::enable_if_t<!IsPushType<RequestT>::value, int> = 0>
@@ -212,13 +226,21 @@ namespace micromsg {
 				mm_assert_m(envelope->callTypeId != 0, "Call type not found.  Did you remember to register your call?");
 
 				if (envelope->callTypeId != 0) {
+					// Set up before sending, as the envelope belongs to the target once it is queued
+					Responder& r = _responderLookup[envelope->callId];
+					r.callTypeId = envelope->callTypeId;
+					r.func = _funcFactory.alloc(std::forward<std::function<void(const typename RequestT::Return&)>>(cb));
+
 					if (send(target, envelope)) {
-						Responder& r = _responderLookup[envelope->callId];
-						r.callTypeId = envelope->callTypeId;
-						r.func = _funcFactory.alloc(std::forward<std::function<void(const typename RequestT::Return&)>>(cb));
 						return true;
 					}
+
+					r.callTypeId = -1;
+					_funcFactory.free(r.func);
 				}
+
+				_responderStack.push_back(envelope->callId);
+				_alloc->free(envelope);
 			}
 
 			return false;
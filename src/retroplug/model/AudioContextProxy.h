@@ -9,18 +9,20 @@
 #include "Constants.h"
 #include "Types.h"
 #include "util/DataBuffer.h"
+#include "util/fs.h"
 #include "micromsg/node.h"
 #include "messaging.h"
 #include "audio/AudioController.h"
 #include "model/Project.h"
 #include "model/ButtonStream.h"
+#include "model/BootStateCache.h"
 #include "model/FileManager.h"
+#include "model/SramWriter.h"
+#include "model/StateCodec.h"
+#include "model/SystemPool.h"
 #include "luawrapper/AudioLuaContext.h"
 #include "plugs/SameBoyPlug.h"
 
-const int MAX_STATE_SIZE = 512 * 1024;
-const int MAX_SRAM_SIZE = 131072;
-
 class AudioContextProxy {
 private:
 	Project _project;
@@ -34,8 +36,18 @@ private:
 
 	AudioController* _audioController;
 
-public:
-	std::function<void(const VideoStream&)> videoCallback;
+	StateEncoder _stateEncoders[MAX_SYSTEMS];
+	SramWriter _sramWriter;
+	SystemPool _systemPool;
+
+	VideoFormat _videoFormat = VideoFormat::Rgba;
+	size_t _systemCount = DEFAULT_SYSTEM_COUNT;
+
+	bool _timingOverlay = false;
+	bool _rewindAllowed = true;
+	ProcessTimingStats _timingStats;
+
+	uint64_t _nextInstanceId = 1;
 
 public:
 	AudioContextProxy(AudioController* audioController): _audioController(audioController) { }
@@ -45,16 +57,16 @@ public:
 		return &_fileManager;
 	}
 
-	void updateSram(SystemIndex idx) {
-		DataBuffer<char>* buffer = _project.systems[idx]->sramData.get();
-		_audioController->getSram(idx, buffer);
-	}
-
 	void setRenderingEnabled(bool enabled) {
 		_node->push<calls::EnableRendering>(NodeTypes::Audio, enabled);
 	}
 
-	void prepareFetch(FetchStateRequest& req) {
+	// When false, the rewind settings from the config are ignored and no history is kept
+	void setRewindAllowed(bool allowed) {
+		_rewindAllowed = allowed;
+	}
+
+	void prepareFetch(FetchStateRequest& req, bool captureStates = false) {
 		// TODO: Instead of using MAX_STATE_SIZE get the actual SRAM size from the emu
 		for (size_t i = 0; i < MAX_SYSTEMS; ++i) {
 			size_t type = (size_t)req.systems[i];
@@ -64,11 +76,31 @@ public:
 			}
 
 			if (type & (size_t)ResourceType::State) {
-				req.states[i] = std::make_shared<DataBuffer<char>>(MAX_STATE_SIZE);
+				if (captureStates) {
+					req.states[i] = _stateEncoders[i].acquireCapture();
+				} else {
+					req.states[i] = std::make_shared<DataBuffer<char>>(MAX_STATE_SIZE);
+				}
 			}
 		}
 	}
 
+	// Replaces the captured states with their encoded versions and the keyframes they need
+	FetchStateResponse encodeStates(const FetchStateRequest& req, const FetchStateResponse& res) {
+		FetchStateResponse encoded = res;
+
+		for (size_t i = 0; i < MAX_SYSTEMS; ++i) {
+			if (res.states[i]) {
+				encoded.states[i] = _stateEncoders[i].encode(res.states[i]->data(), res.states[i]->size());
+				encoded.stateKeys[i] = _stateEncoders[i].getEncodedKeyframe();
+			}
+
+			_stateEncoders[i].releaseCapture(req.states[i]);
+		}
+
+		return encoded;
+	}
+
 	void fetchResources(FetchStateRequest& req, std::function<void(const FetchStateResponse&)> cb) {
 		prepareFetch(req);
 		FetchStateResponse res;
@@ -91,16 +123,18 @@ public:
 			req.systems[i] = resType;
 		}
 
-		prepareFetch(req);
+		prepareFetch(req, true);
 
 		if (immediate) {
 			FetchStateResponse res;
 			_audioController->getLock()->lock();
 			_audioController->fetchState(req, res);
 			_audioController->getLock()->unlock();
-			cb(res);
+			cb(encodeStates(req, res));
 		} else {
-			_node->request<calls::FetchState>(NodeTypes::Audio, req, std::forward<std::function<void(const FetchStateResponse&)>>(cb));
+			_node->request<calls::FetchState>(NodeTypes::Audio, req, [this, req, cb = std::move(cb)](const FetchStateResponse& res) {
+				cb(encodeStates(req, res));
+			});
 		}
 	}
 
@@ -113,13 +147,31 @@ public:
 	void setNode(Node* node) {
 		_node = node;
 
-		node->on<calls::TransmitVideo>([&](const VideoStream& buffer) {
-			videoCallback(buffer);
+		node->on<calls::SramChanged>([&](const SetDataRequest& req) {
+			// Systems may have moved or been replaced since the snapshot was taken, so they are
+			// found by instance rather than slot
+			SystemDescPtr system = findSystem(req.instanceId);
+			if (!system) {
+				return;
+			}
+
+			// Copied rather than kept, so the audio thread gets its buffer back
+			if (!system->sramData) {
+				system->sramData = std::make_shared<DataBuffer<char>>(req.buffer->size());
+			}
+
+			system->sramData->resize(req.buffer->size());
+			system->sramData->write(req.buffer->data(), req.buffer->size());
+
+			// Only systems that already have a .sav file are autosaved
+			if (!system->sramPath.empty()) {
+				_sramWriter.enqueue(system->idx, system->sramPath, req.buffer);
+			}
 		});
 
-		node->on<calls::SramChanged>([&](const SetDataRequest& req) {
-			_project.systems[req.idx]->sramData = req.buffer;
-			spdlog::info("SRAM changed for instance {}", req.idx);
+		node->on<calls::ProcessTimings>([&](const ProcessTimingSnapshotPtr& snapshot) {
+			// Summarized straight away so the audio thread gets its buffer back
+			summarizeTimings(*snapshot, _timingStats);
 		});
 	}
 
@@ -131,6 +183,50 @@ public:
 		_node->push<calls::UpdateProjectSettings>(NodeTypes::Audio, _project.settings);
 	}
 
+	void setProcessingSettings(ProcessingSettings settings) {
+		settings.systemCount = std::clamp(std::max(settings.systemCount, _project.systems.size()), (size_t)1, (size_t)MAX_SYSTEMS);
+		_systemCount = settings.systemCount;
+
+		if (!_rewindAllowed) {
+			settings.rewindSeconds = 0;
+		}
+
+		std::string bootStatePath;
+		if (settings.bootStatesOnDisk && !_configPath.empty()) {
+			bootStatePath = (fs::path(_configPath) / "bootstates").string();
+		}
+
+		BootStateCache::configure(settings.bootStates, bootStatePath);
+		_sramWriter.setInterval(settings.sramAutosaveSeconds);
+		_videoFormat = settings.indexedVideo ? VideoFormat::Indexed : VideoFormat::Rgba;
+		_systemPool.setVideoFormat(_videoFormat);
+		_audioController->setProcessingSettings(settings);
+
+		_timingOverlay = settings.timingOverlay;
+		_timingStats = ProcessTimingStats();
+	}
+
+	size_t getSystemCount() const {
+		return _systemCount;
+	}
+
+	void rewind(SystemIndex idx, double seconds) {
+		_node->push<calls::Rewind>(NodeTypes::Audio, RewindDesc { idx, false, seconds });
+	}
+
+	void scrub(SystemIndex idx, double position) {
+		_node->push<calls::Rewind>(NodeTypes::Audio, RewindDesc { idx, true, position });
+	}
+
+	RewindStats getRewindStats(SystemIndex idx) {
+		return _audioController->getRewindStats(idx);
+	}
+
+	// Null unless the timing overlay is enabled and the audio thread has sent some timings
+	const ProcessTimingStats* getTimingStats() const {
+		return _timingOverlay && _timingStats.blockCount > 0 ? &_timingStats : nullptr;
+	}
+
 	void updateSystemSettings(SystemIndex idx) {
 		SystemSettings settings = SystemSettings{ idx, _project.systems[idx]->sameBoySettings };
 		_node->push<calls::UpdateSystemSettings>(NodeTypes::Audio, settings);
@@ -169,7 +265,47 @@ public:
 	}
 
 	void setRom(SystemIndex idx, DataBufferPtr romData, bool reset) {
-		_node->request<calls::SetRom>(NodeTypes::Audio, SetDataRequest{ idx, romData, reset }, [](const DataBufferPtr&) {});
+		// Systems running the same ROM read it from one shared image
+		SharedRomPtr rom = SameBoyPlug::shareRom(romData->data(), romData->size());
+		uint64_t instanceId = _project.systems[idx]->instanceId;
+
+		_node->request<calls::SetRom>(NodeTypes::Audio, SetRomRequest { idx, rom, reset }, [this, instanceId, reset](const SetRomRequest& res) {
+			if (!res.swapped) {
+				// The desc already holds the new ROM, so the system is loaded again from it
+				spdlog::warn("Couldn't swap the ROM of system {} while it runs, restarting it with the new ROM", res.idx + 1);
+				reloadSystem(instanceId, reset);
+			}
+		});
+	}
+
+	// Loads a system again from its desc, carrying over its SRAM, its audio components and, unless
+	// it's being reset, its state.  Used when a change can't be made to the running system.
+	void reloadSystem(uint64_t instanceId, bool reset) {
+		SystemDescPtr system = findSystem(instanceId);
+		if (!system) {
+			return;
+		}
+
+		FetchStateRequest req;
+		req.systems[system->idx] = reset ? (ResourceType)((size_t)ResourceType::Sram | (size_t)ResourceType::Components) : ResourceType::AllExceptRom;
+
+		fetchResourcesAsync(req, [this, instanceId, reset](const FetchStateResponse& res) {
+			SystemDescPtr system = findSystem(instanceId);
+			if (!system) {
+				return;
+			}
+
+			if (res.srams[system->idx]) {
+				system->sramData = res.srams[system->idx];
+			}
+
+			// The encoder starts again from the fetched state rather than the project's keyframe
+			system->stateData = reset ? nullptr : res.states[system->idx];
+			system->stateKeyData = nullptr;
+			system->audioComponentState = res.components[system->idx];
+
+			loadRom(system);
+		});
 	}
 
 	void setSram(SystemIndex idx, DataBufferPtr sramData, bool reset) {
@@ -182,6 +318,7 @@ public:
 
 	void addSystem(SystemDescPtr& inst) {
 		assert(inst->idx == _project.systems.size());
+		assert(_project.systems.size() < _systemCount);
 		_project.systems.push_back(inst);
 
 		if (inst->sameBoySettings.skipBootRom) {
@@ -199,14 +336,25 @@ public:
 			return SystemState::RomMissing;
 		}
 
-		SameBoyPlugPtr plug = std::make_shared<SameBoyPlug>();
-		plug->setDesc({ inst->romName });
+		SameBoyPlugPtr plug = _systemPool.take();
+		inst->instanceId = _nextInstanceId++;
+		plug->setDesc({ inst->romName, inst->instanceId });
 		plug->loadRom(inst->romData->data(), inst->romData->size(), inst->sameBoySettings, inst->fastBoot);
+		inst->video = plug->getVideo();
 
 		if (inst->stateData) {
 			plug->loadState(inst->stateData->data(), inst->stateData->size());
+
+			// Keep the keyframe the state was saved against so the next saves don't need a new one
+			if (!_stateEncoders[inst->idx].setEncodedKeyframe(inst->stateKeyData)) {
+				_stateEncoders[inst->idx].setKeyframe(inst->stateData->data(), inst->stateData->size());
+			}
+		} else {
+			_stateEncoders[inst->idx].clear();
 		}
 
+		_sramWriter.cancel(inst->idx);
+
 		if (inst->sramData) {
 			plug->loadSram(inst->sramData->data(), inst->sramData->size(), false);
 		} else {
@@ -225,7 +373,7 @@ public:
 	}
 
 	SystemState duplicateSystem(SystemIndex idx, SystemDescPtr& inst) {
-		assert(_project.systems.size() < MAX_SYSTEMS);
+		assert(_project.systems.size() < _systemCount);
 		if (!inst->romData) {
 			inst->state = SystemState::RomMissing;
 			return SystemState::RomMissing;
@@ -234,12 +382,17 @@ public:
 		inst->idx = (SystemIndex)_project.systems.size();
 		inst->fastBoot = true;
 
-		SameBoyPlugPtr plug = std::make_shared<SameBoyPlug>();
-		plug->loadRom(inst->romData->data(), inst->romData->size(), inst->sameBoySettings, inst->fastBoot);
-		plug->setDesc({ inst->romName });
+		// The audio thread copies the source over the new system, so it doesn't need to boot
+		SameBoyPlugPtr plug = _systemPool.take();
+		plug->loadRomForCopy(SameBoyPlug::shareRom(inst->romData->data(), inst->romData->size()), inst->sameBoySettings, inst->fastBoot);
+		inst->instanceId = _nextInstanceId++;
+		plug->setDesc({ inst->romName, inst->instanceId });
+		inst->video = plug->getVideo();
+
+		_stateEncoders[inst->idx].clear();
 
-		SystemDuplicateDesc swap = { (SystemIndex)idx, inst->idx, plug };
-		_node->request<calls::DuplicateSystem>(NodeTypes::Audio, swap, [inst](const SameBoyPlugPtr& d) {
+		SystemDuplicateDesc swap = { (SystemIndex)idx, inst->idx, plug, std::make_shared<DataBuffer<char>>(MAX_STATE_SIZE) };
+		_node->request<calls::DuplicateSystem>(NodeTypes::Audio, swap, [inst](const SystemDuplicateDesc& d) {
 			inst->state = SystemState::Running;
 		});
 
@@ -261,6 +414,12 @@ public:
 			_project.systems[i]->idx = i;
 		}
 
+		// Keyframes are only an optimisation, the next save picks new ones for the moved systems
+		for (SystemIndex i = idx; i < MAX_SYSTEMS; ++i) {
+			_stateEncoders[i].clear();
+			_sramWriter.cancel(i);
+		}
+
 		if (_project.selectedSystem == idx && _project.systems.size() > 0) {
 			_project.selectedSystem = std::min(idx, (int)(_project.systems.size() - 1));
 		}
@@ -283,4 +442,13 @@ public:
 	void onMenuResult(int idx) {
 		_node->push<calls::ContextMenuResult>(NodeTypes::Audio, idx);
 	}
+
+private:
+	SystemDescPtr findSystem(uint64_t instanceId) {
+		auto found = std::find_if(_project.systems.begin(), _project.systems.end(), [&](const SystemDescPtr& system) {
+			return system->instanceId == instanceId;
+		});
+
+		return instanceId != 0 && found != _project.systems.end() ? *found : nullptr;
+	}
 };
@@ -0,0 +1,112 @@
+#include "BootStateCache.h"
+
+#include <fstream>
+#include <mutex>
+#include <unordered_map>
+#include <stdio.h>
+#include <spdlog/spdlog.h>
+
+#include "util/fs.h"
+#include "util/xstring.h"
+
+namespace BootStateCache {
+	// Bumped when the emulator changes in a way that makes stored states invalid
+	const int BOOT_STATE_VERSION = 1;
+
+	static std::mutex _mutex;
+	static bool _enabled = false;
+	static std::string _directory;
+	static std::unordered_map<std::string, BootStatePtr> _states;
+
+	// Doubles as the file name
+	static std::string getKey(uint64_t romHash, GameboyModel model, bool fastBoot) {
+		char key[64];
+		snprintf(key, sizeof(key), "%016llx-%d-%d-v%d.state", (unsigned long long)romHash, (int)model, fastBoot ? 1 : 0, BOOT_STATE_VERSION);
+		return key;
+	}
+
+	static bool readState(const std::string& path, std::vector<char>& target) {
+		std::ifstream f(tstr(path), std::ios::binary | std::ios::ate);
+		if (!f.good()) {
+			return false;
+		}
+
+		target.resize((size_t)f.tellg());
+		f.seekg(0);
+		f.read(target.data(), target.size());
+
+		return !f.fail() && !target.empty();
+	}
+
+	static void writeState(const std::string& path, const std::vector<char>& data) {
+		std::error_code err;
+		fs::create_directories(fs::path(path).parent_path(), err);
+
+		std::ofstream f(tstr(path), std::ios::binary);
+		f.write(data.data(), data.size());
+
+		if (f.fail()) {
+			spdlog::warn("Failed to write boot state to {}", path);
+		}
+	}
+
+	void configure(bool enabled, const std::string& directory) {
+		std::scoped_lock lock(_mutex);
+		_enabled = enabled;
+		_directory = enabled ? directory : "";
+
+		if (!enabled) {
+			_states.clear();
+		}
+	}
+
+	bool enabled() {
+		std::scoped_lock lock(_mutex);
+		return _enabled;
+	}
+
+	BootStatePtr find(uint64_t romHash, GameboyModel model, bool fastBoot) {
+		std::scoped_lock lock(_mutex);
+		if (!_enabled) {
+			return nullptr;
+		}
+
+		std::string key = getKey(romHash, model, fastBoot);
+		auto found = _states.find(key);
+		if (found != _states.end()) {
+			return found->second;
+		}
+
+		if (_directory.empty()) {
+			return nullptr;
+		}
+
+		std::vector<char> data;
+		if (!readState((fs::path(_directory) / key).string(), data)) {
+			return nullptr;
+		}
+
+		BootStatePtr state = std::make_shared<const BootState>(BootState { romHash, model, fastBoot, std::move(data) });
+		_states[key] = state;
+
+		return state;
+	}
+
+	BootStatePtr add(uint64_t romHash, GameboyModel model, bool fastBoot, std::vector<char>&& data) {
+		BootStatePtr state = std::make_shared<const BootState>(BootState { romHash, model, fastBoot, std::move(data) });
+
+		std::scoped_lock lock(_mutex);
+		if (!_enabled) {
+			return state;
+		}
+
+		std::string key = getKey(romHash, model, fastBoot);
+		_states[key] = state;
+
+		if (!_directory.empty()) {
+			writeState((fs::path(_directory) / key).string(), state->data);
+		}
+
+		return state;
+	}
+}
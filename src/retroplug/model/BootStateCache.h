@@ -0,0 +1,33 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "model/Project.h"
+
+// A save state of a system taken the moment its boot ROM handed over to the cartridge
+struct BootState {
+	uint64_t romHash;
+	GameboyModel model;
+	bool fastBoot;
+	std::vector<char> data;
+};
+
+using BootStatePtr = std::shared_ptr<const BootState>;
+
+namespace BootStateCache {
+	// Turns the cache on or off.  States are kept in memory, and also written to and looked for
+	// in `directory` if it isn't empty.  Thread safe, as are the functions below.
+	void configure(bool enabled, const std::string& directory);
+
+	bool enabled();
+
+	// Returns the state for the ROM, model and boot ROM, checking the directory if it isn't in
+	// memory.  Null if there isn't one or the cache is disabled.
+	BootStatePtr find(uint64_t romHash, GameboyModel model, bool fastBoot);
+
+	// Adds a state, replacing any existing state with the same key
+	BootStatePtr add(uint64_t romHash, GameboyModel model, bool fastBoot, std::vector<char>&& data);
+}
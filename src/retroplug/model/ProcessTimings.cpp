@@ -0,0 +1,86 @@
+#include "ProcessTimings.h"
+
+#include <algorithm>
+#include <math.h>
+#include <vector>
+
+const char* getProcessPhaseName(ProcessPhase phase) {
+	switch (phase) {
+		case ProcessPhase::Pull: return "Messages";
+		case ProcessPhase::Lua: return "Lua";
+		case ProcessPhase::Emulation: return "Emulation";
+		case ProcessPhase::Video: return "Video";
+		case ProcessPhase::Mix: return "Mix";
+		case ProcessPhase::Rewind: return "Rewind";
+		case ProcessPhase::Sram: return "SRAM";
+		case ProcessPhase::Total: return "Total";
+		default: return "";
+	}
+}
+
+static PhaseStats summarize(std::vector<float>& samples) {
+	PhaseStats stats;
+	if (samples.empty()) {
+		return stats;
+	}
+
+	std::sort(samples.begin(), samples.end());
+
+	double total = 0;
+	for (float s : samples) {
+		total += s;
+	}
+
+	size_t p99 = (size_t)ceil(0.99 * samples.size()) - 1;
+
+	stats.min = samples.front();
+	stats.mean = total / samples.size();
+	stats.p99 = samples[std::min(p99, samples.size() - 1)];
+	stats.max = samples.back();
+
+	return stats;
+}
+
+void summarizeTimings(const ProcessTimingSnapshot& snapshot, ProcessTimingStats& stats) {
+	stats = ProcessTimingStats();
+	stats.blockCount = std::min(snapshot.blockCount, PROCESS_TIMING_BLOCKS);
+	stats.systemCount = std::min(snapshot.systemCount, (size_t)MAX_SYSTEMS);
+	stats.lookaheadUnderruns = snapshot.lookaheadUnderruns;
+	stats.lookaheadOverflowFrames = snapshot.lookaheadOverflowFrames;
+
+	if (stats.blockCount == 0 || snapshot.sampleRate <= 0) {
+		return;
+	}
+
+	std::vector<float> samples(stats.blockCount);
+	size_t frames = 0;
+
+	for (size_t i = 0; i < stats.blockCount; ++i) {
+		const BlockTiming& block = snapshot.blocks[i];
+		double deadline = block.frameCount / snapshot.sampleRate * 1000000.0;
+
+		if (block.phases[(size_t)ProcessPhase::Total] > deadline) {
+			stats.overruns++;
+		}
+
+		frames += block.frameCount;
+	}
+
+	stats.deadline = (double)frames / stats.blockCount / snapshot.sampleRate * 1000000.0;
+
+	for (size_t phase = 0; phase < PROCESS_PHASE_COUNT; ++phase) {
+		for (size_t i = 0; i < stats.blockCount; ++i) {
+			samples[i] = snapshot.blocks[i].phases[phase];
+		}
+
+		stats.phases[phase] = summarize(samples);
+	}
+
+	for (size_t system = 0; system < stats.systemCount; ++system) {
+		for (size_t i = 0; i < stats.blockCount; ++i) {
+			samples[i] = snapshot.blocks[i].systems[system];
+		}
+
+		stats.systems[system] = summarize(samples);
+	}
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <memory>
+#include <stdint.h>
+
+#include "Constants.h"
+
+// The parts of an audio block that are timed.  Emulation is the wall time from handing systems
+// to the workers until all of them have finished, and includes Video.  Video is the time the
+// systems spent publishing frames, summed across threads.  Mix covers converting the systems'
+// samples and mixing them in to the outputs.  Total is the whole block.
+enum class ProcessPhase {
+	Pull,
+	Lua,
+	Emulation,
+	Video,
+	Mix,
+	Rewind,
+	Sram,
+	Total,
+
+	COUNT
+};
+
+const size_t PROCESS_PHASE_COUNT = (size_t)ProcessPhase::COUNT;
+
+// Number of blocks kept by the profiler, and sent to the UI in each snapshot
+const size_t PROCESS_TIMING_BLOCKS = 512;
+
+// Times are in microseconds
+struct BlockTiming {
+	uint32_t frameCount = 0;
+	float phases[PROCESS_PHASE_COUNT] = { 0 };
+
+	// Time each system spent in update or updateMultiple, including video
+	float systems[MAX_SYSTEMS] = { 0 };
+};
+
+// The most recent blocks, oldest first
+struct ProcessTimingSnapshot {
+	double sampleRate = 0;
+	size_t systemCount = 0;
+	size_t blockCount = 0;
+
+	// Totals since lookahead rendering was started, 0 if it isn't active
+	size_t lookaheadUnderruns = 0;
+	size_t lookaheadOverflowFrames = 0;
+
+	BlockTiming blocks[PROCESS_TIMING_BLOCKS];
+};
+
+using ProcessTimingSnapshotPtr = std::shared_ptr<ProcessTimingSnapshot>;
+
+struct PhaseStats {
+	double min = 0;
+	double mean = 0;
+	double p99 = 0;
+	double max = 0;
+};
+
+// A summary of a snapshot, made on the UI thread
+struct ProcessTimingStats {
+	size_t blockCount = 0;
+	size_t systemCount = 0;
+
+	// Time the host gives each block, from the mean block size
+	double deadline = 0;
+
+	// Blocks that took longer than their own deadline
+	size_t overruns = 0;
+
+	size_t lookaheadUnderruns = 0;
+	size_t lookaheadOverflowFrames = 0;
+
+	PhaseStats phases[PROCESS_PHASE_COUNT];
+	PhaseStats systems[MAX_SYSTEMS];
+};
+
+const char* getProcessPhaseName(ProcessPhase phase);
+
+void summarizeTimings(const ProcessTimingSnapshot& snapshot, ProcessTimingStats& stats);
@@ -1,16 +1,25 @@
 #include "ProcessingContext.h"
 
+#include <assert.h>
+#include <algorithm>
 #include <spdlog/spdlog.h>
 
+#include "audio/AudioMixer.h"
+#include "platform/RtGuard.h"
+
 ProcessingContext::ProcessingContext() {
+	// Reserved up front so changing the system count never reallocates
 	_systems.reserve(MAX_SYSTEMS);
-	for (size_t i = 0; i < MAX_SYSTEMS; ++i) {
-		_systems.push_back(nullptr);
-	}
+	_systems.resize(DEFAULT_SYSTEM_COUNT);
+	_workers = std::make_unique<WorkerPool>();
+
+	spdlog::info("Using {} audio mixing kernel", AudioMixer::getKernelName());
 }
 
 ProcessingContext::~ProcessingContext() {
-	for (size_t i = 0; i < MAX_SYSTEMS; ++i) {
+	_workers->stop();
+
+	for (size_t i = 0; i < _systems.size(); ++i) {
 		if (_systems[i]) {
 			_systems[i]->shutdown();
 		}
@@ -25,7 +34,10 @@ void ProcessingContext::setSystemSettings(SystemIndex idx, SameBoySettings setti
 }
 
 void ProcessingContext::setRenderingEnabled(bool enabled) {
-	for (size_t i = 0; i < MAX_SYSTEMS; ++i) {
+	_renderingEnabled = enabled;
+	enabled = enabled && !isOffline();
+
+	for (size_t i = 0; i < _systems.size(); ++i) {
 		SameBoyPlugPtr inst = _systems[i];
 		if (inst) {
 			inst->disableRendering(!enabled);
@@ -33,8 +45,36 @@ void ProcessingContext::setRenderingEnabled(bool enabled) {
 	}
 }
 
+void ProcessingContext::setOffline(bool offline) {
+	if (offline == isOffline()) {
+		return;
+	}
+
+	_offline = offline;
+	if (offline) {
+		_offlineRequested = true;
+	}
+
+	setRenderingEnabled(_renderingEnabled);
+
+	// Only changes how many of the running threads take jobs.  Until the threads for offline
+	// rendering are started the systems they'd run are picked up by this thread.
+	_workers->setActiveCount(offline ? _offlineWorkerThreads : _processingSettings.workerThreads);
+}
+
+size_t ProcessingContext::getMaxSlotCount(const ProcessingSettings& settings) const {
+	return std::clamp(std::max(settings.systemCount, _systems.size()), (size_t)1, (size_t)MAX_SYSTEMS);
+}
+
+size_t ProcessingContext::getOfflineWorkerThreadCount(const ProcessingSettings& settings) const {
+	// The calling thread runs systems too
+	size_t cores = (size_t)std::thread::hardware_concurrency();
+	size_t spare = std::min(cores > 1 ? cores - 1 : 0, getMaxSlotCount(settings) - 1);
+	return std::max(settings.workerThreads, spare);
+}
+
 void ProcessingContext::fetchState(const FetchStateRequest& req, FetchStateResponse& state) {
-	for (size_t i = 0; i < MAX_SYSTEMS; ++i) {
+	for (size_t i = 0; i < _systems.size(); ++i) {
 		SameBoyPlugPtr inst = _systems[i];
 		if (inst) {
 			if (req.srams[i]) {
@@ -66,21 +106,119 @@ void ProcessingContext::setAudioSettings(const AudioSettings& settings) {
 	_audioSettings = settings;
 }
 
+bool ProcessingContext::rewindSettingsChanged(const ProcessingSettings& settings) const {
+	return settings.rewindSeconds != _processingSettings.rewindSeconds || settings.rewindMemoryMb != _processingSettings.rewindMemoryMb;
+}
+
+void ProcessingContext::prepareProcessingSettings(const ProcessingSettings& settings) {
+	size_t slotCount = getMaxSlotCount(settings);
+
+	if (rewindSettingsChanged(settings)) {
+		if (settings.rewindSeconds > 0) {
+			_pendingRewind = std::make_unique<RewindSet>();
+			_pendingRewind->pool.init(settings.rewindMemoryMb * 1024 * 1024);
+
+			for (size_t i = 0; i < slotCount; ++i) {
+				_pendingRewind->histories[i].init(&_pendingRewind->pool, settings.rewindSeconds, MAX_STATE_SIZE);
+			}
+
+			spdlog::info("Rewind enabled with {} seconds of history and a {}MB budget", settings.rewindSeconds, settings.rewindMemoryMb);
+		}
+	} else if (_rewind) {
+		// The audio thread doesn't touch slots past the current count, so slots being added can
+		// be set up here
+		for (size_t i = _systems.size(); i < slotCount; ++i) {
+			_rewind->histories[i].init(&_rewind->pool, settings.rewindSeconds, MAX_STATE_SIZE);
+		}
+	}
+
+	// Once offline rendering has been asked for, enough threads are kept for it so switching
+	// back and forth doesn't start any
+	_pendingOfflineWorkerThreads = getOfflineWorkerThreadCount(settings);
+	size_t threadCount = _offlineRequested ? _pendingOfflineWorkerThreads : settings.workerThreads;
+
+	if (threadCount != _workers->getThreadCount()) {
+		_pendingWorkers = std::make_unique<WorkerPool>();
+		_pendingWorkers->start(threadCount, 0);
+	}
+}
+
+void ProcessingContext::applyProcessingSettings(const ProcessingSettings& settings) {
+	size_t prevCount = _systems.size();
+	setSystemCount(settings.systemCount);
+
+	if (rewindSettingsChanged(settings)) {
+		// The set being replaced is freed by releaseProcessingSettings
+		std::swap(_rewind, _pendingRewind);
+		std::fill(_rewindSamples, _rewindSamples + MAX_SYSTEMS, 0);
+	} else if (_rewind) {
+		// Removed slots hand their blocks back to the pool here, as the audio thread shares it.
+		// Their buffers are freed by releaseProcessingSettings.
+		for (size_t i = _systems.size(); i < prevCount; ++i) {
+			_rewind->histories[i].clear();
+			_rewindSamples[i] = 0;
+		}
+	}
+
+	_processingSettings = settings;
+
+	_profiler.setEnabled(settings.timingOverlay);
+	for (size_t i = 0; i < _systems.size(); ++i) {
+		if (_systems[i]) {
+			_systems[i]->setTimingEnabled(settings.timingOverlay);
+		}
+	}
+
+	// The pool being replaced has no block in flight, and is joined by releaseProcessingSettings
+	if (_pendingWorkers) {
+		std::swap(_workers, _pendingWorkers);
+	}
+
+	_offlineWorkerThreads = _pendingOfflineWorkerThreads;
+	_workers->setActiveCount(isOffline() ? _offlineWorkerThreads : settings.workerThreads);
+}
+
+void ProcessingContext::releaseProcessingSettings() {
+	_pendingRewind.reset();
+	_pendingWorkers.reset();
+
+	if (_rewind) {
+		for (size_t i = _systems.size(); i < MAX_SYSTEMS; ++i) {
+			_rewind->histories[i].shutdown();
+		}
+	}
+}
+
+void ProcessingContext::setSystemCount(size_t count) {
+	// Slots that still hold a system are kept
+	size_t used = _systems.size();
+	while (used > 0 && !_systems[used - 1]) {
+		used--;
+	}
+
+	count = std::clamp(std::max(count, used), (size_t)1, (size_t)MAX_SYSTEMS);
+	if (count != _systems.size()) {
+		_systems.resize(count);
+		spdlog::info("Running with {} system slots", count);
+	}
+}
+
 SameBoyPlugPtr ProcessingContext::swapSystem(SystemIndex idx, SameBoyPlugPtr instance) {
 	SameBoyPlugPtr old = _systems[idx];
 
 	if (instance) {
 		instance->setSampleRate(_audioSettings.sampleRate);
-		_systems[idx] = instance;
 
-		// TODO: Instantiate this in the UI thread and send with the SwapSystem message
-		if (_audioSettings.frameCount > 0) {
-			_audioBuffers[idx].data = std::make_shared<DataBuffer<float>>(_audioSettings.frameCount * 2);
-			_audioBuffers[idx].frameCount = _audioSettings.frameCount;
+		if (isOffline()) {
+			instance->disableRendering(true);
 		}
-	} else {
-		_audioBuffers[idx].data = nullptr;
-		_audioBuffers[idx].frameCount = 0;
+
+		instance->setTimingEnabled(_profiler.isEnabled());
+	}
+
+	_systems[idx] = instance;
+	if (_rewind) {
+		_rewind->histories[idx].clear();
 	}
 
 	updateLinkTargets();
@@ -88,14 +226,21 @@ SameBoyPlugPtr ProcessingContext::swapSystem(SystemIndex idx, SameBoyPlugPtr ins
 	return old;
 }
 
-SameBoyPlugPtr ProcessingContext::duplicateSystem(SystemIndex sourceIdx, SystemIndex targetIdx, SameBoyPlugPtr system) {
+SameBoyPlugPtr ProcessingContext::duplicateSystem(SystemIndex sourceIdx, SystemIndex targetIdx, SameBoyPlugPtr system, DataBuffer<char>* stateScratch) {
 	SameBoyPlugPtr old = swapSystem(targetIdx, system);
 
+	// The UI loads the same ROM on the same model in to the new system, so the core can be
+	// copied across directly.  If the source has since been reset to another model, fall back to
+	// going through a save state in the scratch the UI sent.  When neither works the copy boots
+	// from power on.
 	SameBoyPlugPtr source = _systems[sourceIdx];
-	char* sourceState = new char[source->saveStateSize()];
-	source->saveState(sourceState, source->saveStateSize());
-	system->loadState(sourceState, source->saveStateSize());
-	delete[] sourceState;
+	if (!system->copyStateFrom(*source)) {
+		size_t stateSize = source->saveStateSize();
+		if (stateScratch && stateScratch->size() >= stateSize && system->saveStateSize() == stateSize) {
+			source->saveState(stateScratch->data(), stateSize);
+			system->loadState(stateScratch->data(), stateSize);
+		}
+	}
 
 	return old;
 }
@@ -110,15 +255,10 @@ SameBoyPlugPtr ProcessingContext::removeSystem(SystemIndex idx) {
 	_systems.erase(_systems.begin() + idx);
 	_systems.push_back(nullptr);
 
-	for (size_t i = 0; i < MAX_SYSTEMS; ++i) {
-		if (!_systems[i]) {
-			_audioBuffers[i].data = nullptr;
-			_audioBuffers[i].frameCount = 0;
-		} else {
-			if (_audioSettings.frameCount > 0) {
-				_audioBuffers[idx].data = std::make_shared<DataBuffer<float>>(_audioSettings.frameCount * 2);
-				_audioBuffers[idx].frameCount = _audioSettings.frameCount;
-			}
+	// Histories are tied to a slot, and every slot after idx has just moved
+	if (_rewind) {
+		for (size_t i = 0; i < _systems.size(); ++i) {
+			_rewind->histories[i].clear();
 		}
 	}
 
@@ -128,47 +268,29 @@ SameBoyPlugPtr ProcessingContext::removeSystem(SystemIndex idx) {
 }
 
 void ProcessingContext::process(float** outputs, size_t frameCount) {
-	_node->pull();
-
-	if (frameCount != _audioSettings.frameCount) {
-		_audioSettings.frameCount = frameCount;
-
-		for (size_t i = 0; i < MAX_SYSTEMS; ++i) {
-			if (_systems[i]) {
-				_audioBuffers[i].data = std::make_shared<DataBuffer<float>>(frameCount * 2);
-				_audioBuffers[i].frameCount = frameCount;
-			}
-		}
+	{
+		rtguard::Scope guard("Node::pull");
+		ProcessProfiler::Scope timer(_profiler, ProcessPhase::Pull);
+		_node->pull();
 	}
 
+	_audioSettings.frameCount = frameCount;
+
 	SameBoyPlug* plugs[MAX_SYSTEMS] = { nullptr };
 	SameBoyPlug* linkedPlugs[MAX_SYSTEMS] = { nullptr };
 
 	size_t totalPlugCount = 0;
 	size_t plugCount = 0;
 	size_t linkedPlugCount = 0;
+	size_t systemCount = _systems.size();
 
-	VideoStream video;
-
-	for (size_t i = 0; i < MAX_SYSTEMS; i++) {
+	for (size_t i = 0; i < systemCount; i++) {
 		SameBoyPlugPtr plugPtr = _systems[i];
 
 		if (plugPtr) {
 			SameBoyPlug* plug = plugPtr.get();
 			plugs[i] = plug;
 
-			VideoBuffer* v = &video.buffers[i];
-			v->dimensions = plug->getDimensions();
-			size_t dataSize = (size_t)(v->dimensions.w * v->dimensions.h * 4);
-
-			if (_alloc->canAlloc<char>(dataSize)) {
-				v->data = _alloc->allocArrayUnique<char>(dataSize);
-			} else {
-				//spdlog::debug("Failed to alloc video buffer");
-			}
-
-			plug->setBuffers(v, &_audioBuffers[i]);
-
 			if (!plug->getSettings().gameLink) {
 				plugs[plugCount++] = plug;
 			} else {
@@ -182,42 +304,108 @@ void ProcessingContext::process(float** outputs, size_t frameCount) {
 		}
 	}
 
-	for (size_t i = 0; i < plugCount; i++) {
-		plugs[i]->update(_audioSettings.frameCount);
+	// Systems without an output pair of their own are mixed in to the main outputs
+	size_t outputPairs = 1;
+	if (_audioSettings.channelCount == 8 && _settings.audioRouting != AudioChannelRouting::StereoMixDown) {
+		outputPairs = _audioSettings.channelCount / 2;
 	}
 
-	if (linkedPlugCount > 0) {
-		linkedPlugs[0]->updateMultiple(linkedPlugs, linkedPlugCount, _audioSettings.frameCount);
-	}
+	// Host blocks are processed in sub-blocks that fit the systems' sample scratch buffers, so
+	// any block size works without allocating.  Queued buttons and serial bytes carry over
+	// between sub-blocks.
+	bool frameCompleted[MAX_SYSTEMS] = { false };
 
-	int chanMultipler = 0;
-	if (_audioSettings.channelCount == 8 && _settings.audioRouting != AudioChannelRouting::StereoMixDown) {
-		chanMultipler = 2;
-	}
+	for (size_t offset = 0; offset < frameCount; offset += PROCESS_BLOCK_SIZE) {
+		size_t subFrameCount = std::min(frameCount - offset, PROCESS_BLOCK_SIZE);
+
+		{
+			ProcessProfiler::Scope timer(_profiler, ProcessPhase::Emulation);
+
+			// Unlinked systems are picked up by the worker pool (if enabled) while the linked systems
+			// run here.  Anything the workers haven't started by the time we wait is run on this thread.
+			_workers->dispatch(plugs, plugCount, subFrameCount);
 
-	bool hasVideo = false;
-	for (const VideoBuffer& b : video.buffers) {
-		if (b.hasData) {
-			hasVideo = true;
-			break;
+			if (linkedPlugCount > 0) {
+				linkedPlugs[0]->updateMultiple(linkedPlugs, linkedPlugCount, subFrameCount);
+			}
+
+			_workers->wait();
 		}
-	}
 
-	if (hasVideo && _node->canPush<calls::TransmitVideo>()) {
-		_node->push<calls::TransmitVideo>(NodeTypes::Ui, std::move(video));
+		if (_profiler.isEnabled()) {
+			for (size_t i = 0; i < systemCount; i++) {
+				if (_systems[i]) {
+					_profiler.addSystem((SystemIndex)i, _systems[i]->getUpdateMicros());
+					_profiler.add(ProcessPhase::Video, _systems[i]->getVideoMicros());
+				}
+			}
+		}
+
+		ProcessProfiler::Scope timer(_profiler, ProcessPhase::Mix);
+
+		for (size_t i = 0; i < systemCount; i++) {
+			const SameBoyPlugPtr& plug = _systems[i];
+			if (plug) {
+				frameCompleted[i] |= plug->getState()->vblankOccurred;
+
+				const int16_t* samples = plug->getAudioSamples();
+				if (samples) {
+					assert(plug->getAudioFrameCount() == subFrameCount);
+					size_t channel = i < outputPairs ? i * 2 : 0;
+					float* left = outputs[channel] + offset;
+					float* right = outputs[channel + 1] + offset;
+					AudioMixer::mixS16Stereo(left, right, samples, subFrameCount, plug->getGain());
+				}
+			}
+		}
 	}
 
-	for (size_t i = 0; i < MAX_SYSTEMS; i++) {
-		if (_audioBuffers[i].data) {
-			float* audio = _audioBuffers[i].data->data();
-			for (size_t j = 0; j < _audioSettings.frameCount; j++) {
-				outputs[i * chanMultipler][j] += audio[j * 2];
-				outputs[i * chanMultipler + 1][j] += audio[j * 2 + 1];
+	if (_rewind) {
+		ProcessProfiler::Scope timer(_profiler, ProcessPhase::Rewind);
+
+		// Snapshots are taken on the first block boundary after a frame once the interval has passed
+		size_t interval = (size_t)(_audioSettings.sampleRate / REWIND_SNAPSHOTS_PER_SECOND);
+
+		for (size_t i = 0; i < systemCount; i++) {
+			SameBoyPlug* plug = _systems[i].get();
+			if (plug && plug->active()) {
+				_rewindSamples[i] += frameCount;
+
+				if (frameCompleted[i] && _rewindSamples[i] >= interval) {
+					_rewind->histories[i].push(plug);
+					_rewindSamples[i] = 0;
+				}
 			}
 		}
 	}
 }
 
+bool ProcessingContext::rewind(SystemIndex idx, double seconds) {
+	SameBoyPlug* plug = _systems[idx].get();
+	if (!plug || !plug->active() || !_rewind) {
+		return false;
+	}
+
+	size_t steps = (size_t)(seconds * REWIND_SNAPSHOTS_PER_SECOND + 0.5);
+	_rewindSamples[idx] = 0;
+
+	return _rewind->histories[idx].restore(plug, steps, true);
+}
+
+bool ProcessingContext::scrub(SystemIndex idx, double position) {
+	SameBoyPlug* plug = _systems[idx].get();
+	if (!plug || !plug->active() || !_rewind) {
+		return false;
+	}
+
+	position = std::clamp(position, 0.0, 1.0);
+	RewindHistory& history = _rewind->histories[idx];
+	size_t steps = (size_t)((1.0 - position) * history.getLength() + 0.5);
+	_rewindSamples[idx] = 0;
+
+	return history.restore(plug, steps, false);
+}
+
 void ProcessingContext::getLinkTargets(std::vector<SameBoyPlugPtr>& targets, SameBoyPlugPtr ignore) {
 	for (size_t i = 0; i < _systems.size(); i++) {
 		if (_systems[i]) {
@@ -1,15 +1,63 @@
 #pragma once
 
+#include <assert.h>
+#include <atomic>
+#include <memory>
+
 #include "plugs/SameBoyPlug.h"
 #include "messaging.h"
 #include "Constants.h"
 #include "Types.h"
 #include "micromsg/allocator/allocator.h"
+#include "audio/ProcessProfiler.h"
+#include "audio/WorkerPool.h"
+#include "model/RewindHistory.h"
+
+// Host blocks are split into sub-blocks of at most this many frames.  Leaves headroom in the
+// sample scratch for the few samples a system can overshoot by.
+const size_t PROCESS_BLOCK_SIZE = AUDIO_SCRATCH_SIZE / 2;
 
 struct AudioSettings {
 	size_t channelCount;
 	size_t frameCount;
 	double sampleRate;
+
+	// The largest block the host will ask for
+	size_t maxFrameCount = 0;
+};
+
+struct ProcessingSettings {
+	// Number of worker threads used to run unlinked systems in parallel.  0 runs all systems
+	// on the audio thread.
+	size_t workerThreads = 0;
+
+	// Number of host blocks to render ahead of the host on a separate thread.  This adds the
+	// same amount of latency, which is reported to the host.  0 renders on the audio thread.
+	size_t lookaheadBlocks = 0;
+
+	// Seconds of rewind history kept per system.  0 disables rewind.
+	size_t rewindSeconds = 0;
+
+	// Memory shared by the rewind histories of all systems
+	size_t rewindMemoryMb = 64;
+
+	// Seconds between writes of changed SRAM to .sav files.  0 disables autosave.
+	double sramAutosaveSeconds = 0;
+
+	// Systems render 8 bit palette indices that are expanded to RGBA when drawn, rather than
+	// RGBA.  Applies to systems loaded after the setting changes.
+	bool indexedVideo = false;
+
+	// Number of system slots, up to MAX_SYSTEMS.  Never drops below the number of slots in use.
+	size_t systemCount = DEFAULT_SYSTEM_COUNT;
+
+	// Systems start from a cached state taken after the boot ROM has run, rather than running it
+	// while muted.  The states can also be stored in the config directory between sessions.
+	bool bootStates = true;
+	bool bootStatesOnDisk = false;
+
+	// Times each phase of every audio block and draws the results over the systems
+	bool timingOverlay = false;
 };
 
 class ProcessingContext {
@@ -19,11 +67,33 @@ private:
 
 	Project::Settings _settings;
 	AudioSettings _audioSettings;
+	ProcessingSettings _processingSettings;
 
-	AudioBuffer _audioBuffers[MAX_SYSTEMS];
 	GameboyButtonStream _buttonPresses[MAX_SYSTEMS];
 
-	micromsg::Allocator* _alloc = nullptr;
+	// Swapped for a new pool when the thread count changes, as threads can't be started or
+	// joined while the audio lock is held
+	std::unique_ptr<WorkerPool> _workers;
+
+	// Worker threads used while rendering offline, worked out with the settings as it asks the
+	// OS for the core count.  They're only started once offline rendering has been asked for.
+	size_t _offlineWorkerThreads = 0;
+	std::atomic_bool _offlineRequested = false;
+
+	bool _renderingEnabled = true;
+	std::atomic_bool _offline = false;
+
+	// Null while rewind is disabled
+	std::unique_ptr<RewindSet> _rewind;
+
+	// Built by prepareProcessingSettings, swapped in by applyProcessingSettings, and freed by
+	// releaseProcessingSettings
+	std::unique_ptr<RewindSet> _pendingRewind;
+	std::unique_ptr<WorkerPool> _pendingWorkers;
+	size_t _pendingOfflineWorkerThreads = 0;
+	size_t _rewindSamples[MAX_SYSTEMS] = { 0 };
+
+	ProcessProfiler _profiler;
 
 public:
 	ProcessingContext();
@@ -31,10 +101,14 @@ public:
 
 	void setNode(Node* node) {
 		_node = node;
-		_alloc = node->getAllocator();
 	}
 
-	SameBoyPlugPtr& getSystem(SystemIndex idx) { return _systems[idx]; }
+	SameBoyPlugPtr& getSystem(SystemIndex idx) {
+		assert((size_t)idx < _systems.size());
+		return _systems[idx];
+	}
+
+	size_t getSystemCount() const { return _systems.size(); }
 
 	const Project::Settings& getSettings() const { return _settings; }
 
@@ -44,6 +118,17 @@ public:
 
 	void setRenderingEnabled(bool enabled);
 
+	// Switches to rendering a bounce faster than realtime.  Video is turned off, and systems are
+	// spread over as many worker threads as there are spare cores, whatever the settings say.
+	// Those threads are started by the next settings change after the first switch.
+	void setOffline(bool offline);
+
+	// True once offline rendering has been asked for, but the threads for it aren't running yet
+	bool needsOfflineWorkers() const { return _offlineRequested.load(std::memory_order_relaxed) && _workers->getThreadCount() < _offlineWorkerThreads; }
+
+	// Safe to call from any thread
+	bool isOffline() const { return _offline.load(std::memory_order_relaxed); }
+
 	GameboyButtonStream* getButtonPresses(SystemIndex idx) {
 		return &_buttonPresses[idx];
 	}
@@ -52,17 +137,58 @@ public:
 
 	void setAudioSettings(const AudioSettings& settings);
 
+	const ProcessingSettings& getProcessingSettings() const { return _processingSettings; }
+
+	// Changing the settings is split in three so nothing is allocated or freed, and no threads
+	// are started or joined, while the audio lock is held.  prepare and release run on the
+	// calling thread, and apply runs under the lock.
+	void prepareProcessingSettings(const ProcessingSettings& settings);
+
+	void applyProcessingSettings(const ProcessingSettings& settings);
+
+	void releaseProcessingSettings();
+
+	// For callers that don't share the context with an audio thread
+	void setProcessingSettings(const ProcessingSettings& settings) {
+		prepareProcessingSettings(settings);
+		applyProcessingSettings(settings);
+		releaseProcessingSettings();
+	}
+
 	SameBoyPlugPtr swapSystem(SystemIndex idx, SameBoyPlugPtr instance);
 
-	SameBoyPlugPtr duplicateSystem(SystemIndex sourceIdx, SystemIndex targetIdx, SameBoyPlugPtr system);
+	// stateScratch is used when the systems can't be copied directly, and must be big enough to
+	// hold a save state
+	SameBoyPlugPtr duplicateSystem(SystemIndex sourceIdx, SystemIndex targetIdx, SameBoyPlugPtr system, DataBuffer<char>* stateScratch);
 
 	void resetSystem(SystemIndex idx, GameboyModel model);
 
 	SameBoyPlugPtr removeSystem(SystemIndex idx);
 
+	// Moves a system back in time and discards the history after that point
+	bool rewind(SystemIndex idx, double seconds);
+
+	// Loads the state at `position` in the rewind history, where 0 is the oldest state and 1 is
+	// the newest.  The history is kept until emulation moves on, so scrubbing can go both ways.
+	bool scrub(SystemIndex idx, double position);
+
+	RewindStats getRewindStats(SystemIndex idx) const { return _rewind ? _rewind->histories[idx].getStats() : RewindStats(); }
+
+	ProcessProfiler& getProfiler() { return _profiler; }
+
 	void process(float** outputs, size_t frameCount);
 
 private:
+	void setSystemCount(size_t count);
+
+	// The number of slots any settings change can leave, as setSystemCount only keeps more than
+	// asked for when they're in use
+	size_t getMaxSlotCount(const ProcessingSettings& settings) const;
+
+	size_t getOfflineWorkerThreadCount(const ProcessingSettings& settings) const;
+
+	bool rewindSettingsChanged(const ProcessingSettings& settings) const;
+
 	void getLinkTargets(std::vector<SameBoyPlugPtr>& targets, SameBoyPlugPtr ignore);
 
 	void updateLinkTargets();
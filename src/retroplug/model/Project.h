@@ -6,6 +6,7 @@
 #include "Types.h"
 #include "Constants.h"
 #include "util/DataBuffer.h"
+#include "util/VideoTripleBuffer.h"
 #include "model/ButtonStream.h"
 
 const std::string PROJECT_VERSION = "1.0.0";
@@ -66,6 +67,9 @@ struct SystemDesc {
 	DataBufferPtr stateData;
 	DataBufferPtr sramData;
 
+	// The encoded keyframe stateData was decoded against, if it was delta encoded
+	DataBufferPtr stateKeyData;
+
 	std::string keyInputConfig;
 	std::string padInputConfig;
 	std::string audioComponentState;
@@ -73,8 +77,14 @@ struct SystemDesc {
 
 	GameboyButtonStream buttons;
 
+	// Frames from the running instance, read by the view
+	VideoTripleBufferPtr video;
+
 	bool fastBoot = false;
 
+	// Changes every time a new instance is loaded for this system
+	uint64_t instanceId = 0;
+
 	SystemDesc() {}
 	SystemDesc(const SystemDesc& other) { *this = other; }
 
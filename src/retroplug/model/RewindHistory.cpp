@@ -0,0 +1,403 @@
+#include "RewindHistory.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <chrono>
+#include <string.h>
+
+#include "plugs/SameBoyPlug.h"
+
+// Literals are ended once this many unchanged bytes are found, shorter gaps cost less to
+// store inline than as a new run.
+const size_t MIN_ZERO_RUN = 8;
+
+void RewindPool::init(size_t bytes) {
+	size_t blockCount = bytes / REWIND_BLOCK_SIZE;
+
+	// Not cleared, so the OS only commits pages as they're used
+	_memory.reset(blockCount > 0 ? new char[blockCount * REWIND_BLOCK_SIZE] : nullptr);
+	_next.assign(blockCount, INVALID_BLOCK);
+	_free.resize(blockCount);
+
+	for (size_t i = 0; i < blockCount; ++i) {
+		_free[i] = (uint32_t)(blockCount - i - 1);
+	}
+}
+
+uint32_t RewindPool::alloc() {
+	if (_free.empty()) {
+		return INVALID_BLOCK;
+	}
+
+	uint32_t block = _free.back();
+	_free.pop_back();
+	_next[block] = INVALID_BLOCK;
+
+	return block;
+}
+
+void RewindPool::freeChain(uint32_t first) {
+	while (first != INVALID_BLOCK) {
+		uint32_t next = _next[first];
+		_free.push_back(first);
+		first = next;
+	}
+}
+
+class ChainWriter {
+private:
+	RewindPool* _pool;
+	uint32_t _block = RewindPool::INVALID_BLOCK;
+	size_t _offset = REWIND_BLOCK_SIZE;
+
+public:
+	uint32_t first = RewindPool::INVALID_BLOCK;
+	size_t size = 0;
+	size_t blockCount = 0;
+
+	ChainWriter(RewindPool* pool): _pool(pool) {}
+
+	bool write(const char* data, size_t count) {
+		while (count > 0) {
+			if (_offset == REWIND_BLOCK_SIZE) {
+				uint32_t block = _pool->alloc();
+				if (block == RewindPool::INVALID_BLOCK) {
+					return false;
+				}
+
+				if (_block == RewindPool::INVALID_BLOCK) {
+					first = block;
+				} else {
+					_pool->next(_block) = block;
+				}
+
+				_block = block;
+				_offset = 0;
+				blockCount++;
+			}
+
+			size_t n = std::min(count, REWIND_BLOCK_SIZE - _offset);
+			memcpy(_pool->data(_block) + _offset, data, n);
+
+			_offset += n;
+			data += n;
+			count -= n;
+			size += n;
+		}
+
+		return true;
+	}
+
+	bool writeVarint(size_t v) {
+		char buf[10];
+		size_t n = 0;
+
+		do {
+			uint8_t b = v & 0x7F;
+			v >>= 7;
+			buf[n++] = (char)(v ? (b | 0x80) : b);
+		} while (v);
+
+		return write(buf, n);
+	}
+};
+
+class ChainReader {
+private:
+	RewindPool* _pool;
+	uint32_t _block;
+	size_t _offset = 0;
+
+public:
+	size_t remaining;
+
+	ChainReader(RewindPool* pool, uint32_t first, size_t size): _pool(pool), _block(first), remaining(size) {}
+
+	// Returns a pointer to up to `count` contiguous bytes, and how many are available
+	const char* next(size_t count, size_t& available) {
+		if (_offset == REWIND_BLOCK_SIZE) {
+			_block = _pool->next(_block);
+			_offset = 0;
+		}
+
+		available = std::min({ count, REWIND_BLOCK_SIZE - _offset, remaining });
+		const char* data = _pool->data(_block) + _offset;
+
+		_offset += available;
+		remaining -= available;
+
+		return data;
+	}
+
+	size_t readVarint() {
+		size_t v = 0;
+		size_t shift = 0;
+
+		while (remaining > 0) {
+			size_t available;
+			uint8_t b = (uint8_t)*next(1, available);
+			v |= (size_t)(b & 0x7F) << shift;
+			shift += 7;
+
+			if (!(b & 0x80)) {
+				break;
+			}
+		}
+
+		return v;
+	}
+};
+
+static size_t skipEqual(const char* a, const char* b, size_t i, size_t size) {
+	while (i + 8 <= size) {
+		uint64_t x, y;
+		memcpy(&x, a + i, 8);
+		memcpy(&y, b + i, 8);
+
+		if (x != y) {
+			break;
+		}
+
+		i += 8;
+	}
+
+	while (i < size && a[i] == b[i]) {
+		i++;
+	}
+
+	return i;
+}
+
+void RewindHistory::init(RewindPool* pool, size_t seconds, size_t maxStateSize) {
+	shutdown();
+
+	_pool = pool;
+	_entries.resize(seconds * REWIND_SNAPSHOTS_PER_SECOND + 1);
+	_current.resize(maxStateSize);
+	_capture.resize(maxStateSize);
+	_work.resize(maxStateSize);
+}
+
+void RewindHistory::shutdown() {
+	if (_pool) {
+		clear();
+	}
+
+	_pool = nullptr;
+	_entries = std::vector<Entry>();
+	_current = std::vector<char>();
+	_capture = std::vector<char>();
+	_work = std::vector<char>();
+	_stateSize = 0;
+}
+
+void RewindHistory::clear() {
+	dropNewest(_count);
+	_head = 0;
+	_scrubSteps = 0;
+	_available = 0;
+}
+
+bool RewindHistory::push(SameBoyPlug* plug) {
+	if (!_pool) {
+		return false;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	size_t size = plug->saveStateSize();
+	if (size == 0 || size > _current.size()) {
+		return false;
+	}
+
+	if (size != _stateSize) {
+		clear();
+		_stateSize = size;
+	}
+
+	if (_scrubSteps > 0) {
+		// Emulation has continued from a scrubbed position, so that's the new present
+		dropNewest(_scrubSteps);
+		std::swap(_current, _work);
+		_scrubSteps = 0;
+	}
+
+	plug->saveState(_capture.data(), size);
+
+	if (_count == _entries.size()) {
+		dropOldest();
+	}
+
+	Entry e;
+	if (_count > 0) {
+		while (!encode(_capture.data(), _current.data(), size, e)) {
+			if (_count <= 1) {
+				// Other systems are holding the whole budget
+				_droppedSnapshots++;
+				return false;
+			}
+
+			dropOldest();
+		}
+	}
+
+	entry(_count) = e;
+	_count++;
+	std::swap(_current, _capture);
+
+	_usedBlocks += e.blockCount;
+	_usedBytes += e.size;
+	_available = _count - 1;
+
+	auto elapsed = std::chrono::steady_clock::now() - start;
+	_lastEncodeMicros = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+
+	return true;
+}
+
+bool RewindHistory::restore(SameBoyPlug* plug, size_t steps, bool commit) {
+	if (!_pool || _count == 0 || plug->saveStateSize() != _stateSize) {
+		return false;
+	}
+
+	steps = std::min(steps, _count - 1);
+
+	memcpy(_work.data(), _current.data(), _stateSize);
+	for (size_t i = 0; i < steps; ++i) {
+		apply(entry(_count - 1 - i), _work.data());
+	}
+
+	plug->loadState(_work.data(), _stateSize);
+
+	if (commit) {
+		dropNewest(steps);
+		std::swap(_current, _work);
+		_scrubSteps = 0;
+	} else {
+		_scrubSteps = steps;
+	}
+
+	return true;
+}
+
+RewindStats RewindHistory::getStats() const {
+	RewindStats stats;
+	stats.snapshotCount = _available.load(std::memory_order_relaxed);
+	stats.usedBytes = _usedBlocks.load(std::memory_order_relaxed) * REWIND_BLOCK_SIZE;
+	stats.storedSeconds = (double)stats.snapshotCount / REWIND_SNAPSHOTS_PER_SECOND;
+	stats.lastEncodeMicros = _lastEncodeMicros.load(std::memory_order_relaxed);
+	stats.droppedSnapshots = _droppedSnapshots.load(std::memory_order_relaxed);
+
+	if (stats.storedSeconds > 0) {
+		stats.bytesPerSecond = _usedBytes.load(std::memory_order_relaxed) / stats.storedSeconds;
+	}
+
+	return stats;
+}
+
+void RewindHistory::dropOldest() {
+	assert(_count > 0);
+
+	Entry& oldest = entry(0);
+	_usedBlocks -= oldest.blockCount;
+	_usedBytes -= oldest.size;
+	_pool->freeChain(oldest.firstBlock);
+	oldest = Entry();
+
+	_head = (_head + 1) % _entries.size();
+	_count--;
+
+	// The new oldest snapshot is only a delta against the one that was just dropped
+	if (_count > 0) {
+		Entry& next = entry(0);
+		_usedBlocks -= next.blockCount;
+		_usedBytes -= next.size;
+		_pool->freeChain(next.firstBlock);
+		next = Entry();
+	}
+
+	_available = _count > 0 ? _count - 1 : 0;
+}
+
+void RewindHistory::dropNewest(size_t count) {
+	assert(count <= _count);
+
+	for (size_t i = 0; i < count; ++i) {
+		Entry& newest = entry(_count - 1);
+		_usedBlocks -= newest.blockCount;
+		_usedBytes -= newest.size;
+		_pool->freeChain(newest.firstBlock);
+		newest = Entry();
+		_count--;
+	}
+
+	_available = _count > 0 ? _count - 1 : 0;
+}
+
+bool RewindHistory::encode(const char* state, const char* prev, size_t size, Entry& target) {
+	ChainWriter writer(_pool);
+	char buf[256];
+
+	size_t i = 0;
+	while (i < size) {
+		size_t start = i;
+		i = skipEqual(state, prev, i, size);
+
+		if (i == size) {
+			break;
+		}
+
+		size_t literalStart = i;
+		size_t literalEnd = i + 1;
+		for (size_t j = literalEnd; j < size && j - literalEnd < MIN_ZERO_RUN; ++j) {
+			if (state[j] != prev[j]) {
+				literalEnd = j + 1;
+			}
+		}
+
+		bool ok = writer.writeVarint(literalStart - start) && writer.writeVarint(literalEnd - literalStart);
+
+		for (size_t pos = literalStart; ok && pos < literalEnd; pos += sizeof(buf)) {
+			size_t n = std::min(sizeof(buf), literalEnd - pos);
+			for (size_t k = 0; k < n; ++k) {
+				buf[k] = state[pos + k] ^ prev[pos + k];
+			}
+
+			ok = writer.write(buf, n);
+		}
+
+		if (!ok) {
+			_pool->freeChain(writer.first);
+			return false;
+		}
+
+		i = literalEnd;
+	}
+
+	target.firstBlock = writer.first;
+	target.size = (uint32_t)writer.size;
+	target.blockCount = (uint32_t)writer.blockCount;
+
+	return true;
+}
+
+void RewindHistory::apply(const Entry& delta, char* state) {
+	ChainReader reader(_pool, delta.firstBlock, delta.size);
+	size_t pos = 0;
+
+	while (reader.remaining > 0) {
+		pos += reader.readVarint();
+		size_t literal = reader.readVarint();
+
+		while (literal > 0) {
+			size_t available;
+			const char* data = reader.next(literal, available);
+			for (size_t k = 0; k < available; ++k) {
+				state[pos + k] ^= data[k];
+			}
+
+			pos += available;
+			literal -= available;
+		}
+	}
+}
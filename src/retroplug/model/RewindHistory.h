@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+#include "Constants.h"
+
+class SameBoyPlug;
+
+const size_t REWIND_BLOCK_SIZE = 4096;
+const size_t REWIND_SNAPSHOTS_PER_SECOND = 10;
+
+// A fixed budget of memory split in to blocks, shared by the rewind histories of all systems.
+// Snapshots are stored as chains of blocks, so nothing is allocated once the pool exists.
+class RewindPool {
+public:
+	static constexpr uint32_t INVALID_BLOCK = 0xFFFFFFFF;
+
+private:
+	std::unique_ptr<char[]> _memory;
+	std::vector<uint32_t> _next;
+	std::vector<uint32_t> _free;
+
+public:
+	void init(size_t bytes);
+
+	size_t getBlockCount() const { return _next.size(); }
+
+	size_t getFreeCount() const { return _free.size(); }
+
+	uint32_t alloc();
+
+	void freeChain(uint32_t first);
+
+	char* data(uint32_t block) { return _memory.get() + (size_t)block * REWIND_BLOCK_SIZE; }
+
+	uint32_t& next(uint32_t block) { return _next[block]; }
+};
+
+struct RewindStats {
+	size_t snapshotCount = 0;
+	size_t usedBytes = 0;
+	double storedSeconds = 0;
+	double bytesPerSecond = 0;
+	uint64_t lastEncodeMicros = 0;
+	size_t droppedSnapshots = 0;
+};
+
+// Rewind history for a single system.  The newest state is kept in full, and every snapshot
+// is stored as the XOR of itself and the snapshot before it, with runs of unchanged bytes
+// skipped.  Because XOR is its own inverse, walking back through the deltas from the newest
+// state reconstructs any earlier one.
+class RewindHistory {
+private:
+	struct Entry {
+		uint32_t firstBlock = RewindPool::INVALID_BLOCK;
+		uint32_t size = 0;
+		uint32_t blockCount = 0;
+	};
+
+	RewindPool* _pool = nullptr;
+
+	std::vector<Entry> _entries;
+	size_t _head = 0;
+	size_t _count = 0;
+
+	std::vector<char> _current;
+	std::vector<char> _capture;
+	std::vector<char> _work;
+	size_t _stateSize = 0;
+
+	// How far back the last scrub went.  The newer snapshots are kept until emulation moves
+	// on, so it's possible to scrub forward again.
+	size_t _scrubSteps = 0;
+
+	std::atomic<size_t> _usedBlocks = 0;
+	std::atomic<size_t> _usedBytes = 0;
+	std::atomic<size_t> _available = 0;
+	std::atomic<uint64_t> _lastEncodeMicros = 0;
+	std::atomic<size_t> _droppedSnapshots = 0;
+
+public:
+	void init(RewindPool* pool, size_t seconds, size_t maxStateSize);
+
+	void shutdown();
+
+	bool isEnabled() const { return _pool != nullptr; }
+
+	void clear();
+
+	// Captures the current state of the system
+	bool push(SameBoyPlug* plug);
+
+	// Number of steps it's possible to go back
+	size_t getLength() const { return _available.load(std::memory_order_relaxed); }
+
+	// Moves the system back `steps` snapshots.  When `commit` is true the newer history is
+	// discarded straight away, otherwise it's discarded the next time a snapshot is pushed.
+	bool restore(SameBoyPlug* plug, size_t steps, bool commit);
+
+	RewindStats getStats() const;
+
+private:
+	Entry& entry(size_t idx) { return _entries[(_head + idx) % _entries.size()]; }
+
+	void dropOldest();
+
+	void dropNewest(size_t count);
+
+	bool encode(const char* state, const char* prev, size_t size, Entry& target);
+
+	void apply(const Entry& delta, char* state);
+};
+
+// A pool and the histories of every slot that share it.  Kept together on the heap so the
+// histories can point at the pool while a new set is built away from the audio thread.
+struct RewindSet {
+	RewindPool pool;
+	RewindHistory histories[MAX_SYSTEMS];
+};
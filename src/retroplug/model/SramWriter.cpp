@@ -0,0 +1,135 @@
+#include "SramWriter.h"
+
+#include <fstream>
+#include <spdlog/spdlog.h>
+
+#include "util/fs.h"
+#include "util/xstring.h"
+
+void SramWriter::setInterval(double seconds) {
+	if (seconds <= 0) {
+		stop();
+		return;
+	}
+
+	std::scoped_lock lock(_mutex);
+	_interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+
+	if (!_running) {
+		_running = true;
+		_thread = std::thread(&SramWriter::run, this);
+		spdlog::info("SRAM autosave enabled, writing every {} seconds", seconds);
+	}
+
+	_cv.notify_one();
+}
+
+void SramWriter::enqueue(SystemIndex idx, const std::string& path, DataBufferPtr buffer) {
+	std::scoped_lock lock(_mutex);
+	if (!_running) {
+		return;
+	}
+
+	_pending[idx].path = path;
+	_pending[idx].buffer = buffer;
+	_cv.notify_one();
+}
+
+void SramWriter::cancel(SystemIndex idx) {
+	std::scoped_lock lock(_mutex);
+	_pending[idx].buffer = nullptr;
+}
+
+void SramWriter::stop() {
+	{
+		std::scoped_lock lock(_mutex);
+		if (!_running) {
+			return;
+		}
+
+		_running = false;
+	}
+
+	_cv.notify_one();
+	_thread.join();
+}
+
+bool SramWriter::writeAtomic(const std::string& path, const DataBuffer<char>* data) {
+	tstring target = tstr(path);
+	tstring temp = target + TSTR(".tmp");
+
+	std::ofstream f(temp, std::ios::binary);
+	if (!f.good()) {
+		return false;
+	}
+
+	f.write(data->data(), data->size());
+	f.close();
+
+	std::error_code err;
+	if (f.fail()) {
+		fs::remove(temp, err);
+		return false;
+	}
+
+	fs::rename(temp, target, err);
+	if (err) {
+		fs::remove(temp, err);
+		return false;
+	}
+
+	return true;
+}
+
+void SramWriter::run() {
+	std::unique_lock lock(_mutex);
+
+	while (true) {
+		Clock::time_point now = Clock::now();
+		Clock::time_point next = Clock::time_point::max();
+		int due = -1;
+
+		for (int i = 0; i < MAX_SYSTEMS; ++i) {
+			if (_pending[i].buffer) {
+				// Everything left is flushed once the writer is stopping
+				Clock::time_point writeAt = _pending[i].lastWrite + _interval;
+				if (!_running || writeAt <= now) {
+					due = i;
+					break;
+				}
+
+				next = std::min(next, writeAt);
+			}
+		}
+
+		if (due != -1) {
+			Pending& pending = _pending[due];
+			std::string path = pending.path;
+			DataBufferPtr buffer = std::move(pending.buffer);
+			pending.buffer = nullptr;
+			pending.lastWrite = now;
+
+			lock.unlock();
+
+			if (!writeAtomic(path, buffer.get())) {
+				spdlog::warn("Failed to autosave SRAM to {}", path);
+			}
+
+			// Hands the buffer back to the audio thread
+			buffer = nullptr;
+
+			lock.lock();
+			continue;
+		}
+
+		if (!_running) {
+			break;
+		}
+
+		if (next == Clock::time_point::max()) {
+			_cv.wait(lock);
+		} else {
+			_cv.wait_until(lock, next);
+		}
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "Constants.h"
+#include "Types.h"
+#include "util/DataBuffer.h"
+
+// Writes SRAM snapshots to .sav files on a background thread.  Snapshots queued for the same
+// system are coalesced so each file is written at most once per interval, and files are
+// written to a temporary path and renamed over the original so a crash mid-write can't leave
+// a truncated save behind.
+class SramWriter {
+private:
+	using Clock = std::chrono::steady_clock;
+
+	struct Pending {
+		std::string path;
+		DataBufferPtr buffer;
+		Clock::time_point lastWrite;
+	};
+
+	std::thread _thread;
+	std::mutex _mutex;
+	std::condition_variable _cv;
+	bool _running = false;
+
+	Pending _pending[MAX_SYSTEMS];
+	Clock::duration _interval = Clock::duration::zero();
+
+public:
+	~SramWriter() { stop(); }
+
+	// Starts the writer thread, or stops it (after writing anything pending) if seconds is 0
+	void setInterval(double seconds);
+
+	bool isEnabled() const { return _running; }
+
+	// Queues buffer to be written to path.  Replaces anything still pending for the system.
+	void enqueue(SystemIndex idx, const std::string& path, DataBufferPtr buffer);
+
+	// Drops anything pending for a system that is being removed or replaced
+	void cancel(SystemIndex idx);
+
+	void stop();
+
+	static bool writeAtomic(const std::string& path, const DataBuffer<char>* data);
+
+private:
+	void run();
+};
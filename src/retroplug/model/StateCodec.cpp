@@ -0,0 +1,468 @@
+#include "StateCodec.h"
+
+#include <algorithm>
+#include <string.h>
+#include <utility>
+#include <xxhash.h>
+
+#include "Constants.h"
+
+const char STATE_MAGIC[4] = { 'R', 'P', 'S', 'T' };
+const uint32_t STATE_VERSION = 1;
+
+const size_t HEADER_SIZE = 32;
+const size_t INDEX_ENTRY_SIZE = 16;
+
+// Sections bigger than this are split, so small changes to cart RAM or WRAM only rewrite a page
+const uint32_t MAX_CHUNK_SIZE = 4096;
+
+// Literals are ended once this many unchanged bytes are found
+const size_t MIN_ZERO_RUN = 8;
+
+// Saves in a row that must be more than half the size of the keyframe before it's replaced
+const size_t KEYFRAME_REPLACE_SAVES = 8;
+
+// Offsets of the buffer descriptors in the data of the BESS CORE block
+const size_t BESS_CORE_RAM = 0x98;
+const size_t BESS_CORE_VRAM = 0xA0;
+const size_t BESS_CORE_MBC_RAM = 0xA8;
+const size_t BESS_CORE_HRAM = 0xB8;
+
+enum class ChunkType : uint8_t {
+	Same,
+	Delta
+};
+
+static uint32_t readU32(const char* data) {
+	uint32_t v;
+	memcpy(&v, data, sizeof(v));
+	return v;
+}
+
+static uint64_t readU64(const char* data) {
+	uint64_t v;
+	memcpy(&v, data, sizeof(v));
+	return v;
+}
+
+static void writeU32(char* target, uint32_t v) {
+	memcpy(target, &v, sizeof(v));
+}
+
+static void writeU64(char* target, uint64_t v) {
+	memcpy(target, &v, sizeof(v));
+}
+
+static void addChunks(std::vector<StateChunk>& chunks, size_t offset, size_t size, StateSection section) {
+	while (size > 0) {
+		uint32_t chunkSize = (uint32_t)std::min(size, (size_t)MAX_CHUNK_SIZE);
+		chunks.push_back({ (uint32_t)offset, chunkSize, section });
+		offset += chunkSize;
+		size -= chunkSize;
+	}
+}
+
+static bool parseSections(const char* state, size_t size, std::vector<StateChunk>& chunks) {
+	const size_t footerSize = 8;
+	if (size < footerSize || memcmp(state + size - 4, "BESS", 4) != 0) {
+		return false;
+	}
+
+	size_t blocksEnd = size - footerSize;
+	size_t pos = readU32(state + blocksEnd);
+	const char* core = nullptr;
+
+	while (pos + 8 <= blocksEnd) {
+		const char* block = state + pos;
+		size_t blockSize = readU32(block + 4);
+
+		if (memcmp(block, "CORE", 4) == 0) {
+			if (blockSize < BESS_CORE_HRAM + 8 || pos + 8 + blockSize > blocksEnd) {
+				return false;
+			}
+
+			core = block + 8;
+			break;
+		}
+
+		if (memcmp(block, "END ", 4) == 0) {
+			break;
+		}
+
+		pos += 8 + blockSize;
+	}
+
+	if (!core) {
+		return false;
+	}
+
+	size_t hramOffset = readU32(core + BESS_CORE_HRAM + 4);
+	size_t cartRamOffset = readU32(core + BESS_CORE_MBC_RAM + 4);
+	if (hramOffset < 4 || hramOffset > cartRamOffset) {
+		return false;
+	}
+
+	// Everything before HRAM (CPU, DMA and MBC registers) is small and changes constantly
+	size_t cursor = hramOffset - 4;
+	addChunks(chunks, 0, cursor, StateSection::Cpu);
+
+	const StateSection sections[] = { StateSection::Hram, StateSection::Timing, StateSection::Apu, StateSection::Rtc, StateSection::Video };
+	for (StateSection section : sections) {
+		if (cursor + 4 > cartRamOffset) {
+			return false;
+		}
+
+		size_t sectionSize = 4 + (size_t)readU32(state + cursor);
+		if (cursor + sectionSize > cartRamOffset) {
+			return false;
+		}
+
+		addChunks(chunks, cursor, sectionSize, section);
+		cursor += sectionSize;
+	}
+
+	addChunks(chunks, cursor, cartRamOffset - cursor, StateSection::Sgb);
+	cursor = cartRamOffset;
+
+	const std::pair<size_t, StateSection> buffers[] = {
+		{ BESS_CORE_MBC_RAM, StateSection::CartRam },
+		{ BESS_CORE_RAM, StateSection::Wram },
+		{ BESS_CORE_VRAM, StateSection::Vram }
+	};
+
+	for (auto& buffer : buffers) {
+		size_t bufferSize = readU32(core + buffer.first);
+		size_t bufferOffset = readU32(core + buffer.first + 4);
+		if (bufferOffset != cursor || cursor + bufferSize > size) {
+			return false;
+		}
+
+		addChunks(chunks, cursor, bufferSize, buffer.second);
+		cursor += bufferSize;
+	}
+
+	addChunks(chunks, cursor, size - cursor, StateSection::Bess);
+
+	return true;
+}
+
+static size_t skipEqual(const char* a, const char* b, size_t i, size_t size) {
+	if (b) {
+		while (i < size && a[i] == b[i]) {
+			i++;
+		}
+	} else {
+		while (i < size && a[i] == 0) {
+			i++;
+		}
+	}
+
+	return i;
+}
+
+static bool isSame(const char* a, const char* b, size_t size) {
+	return skipEqual(a, b, 0, size) == size;
+}
+
+static void writeVarint(std::vector<char>& target, size_t v) {
+	do {
+		uint8_t b = v & 0x7F;
+		v >>= 7;
+		target.push_back((char)(v ? (b | 0x80) : b));
+	} while (v);
+}
+
+static bool readVarint(const char*& data, const char* end, size_t& v) {
+	v = 0;
+	for (size_t shift = 0; data < end && shift < 64; shift += 7) {
+		uint8_t b = (uint8_t)*data++;
+		v |= (size_t)(b & 0x7F) << shift;
+
+		if (!(b & 0x80)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Appends the XOR of `state` and `reference` (or zeroes) as pairs of skipped and literal byte
+// counts, followed by the literal bytes.
+static void encodeDelta(const char* state, const char* reference, size_t size, std::vector<char>& target) {
+	size_t i = 0;
+	while (i < size) {
+		size_t start = i;
+		i = skipEqual(state, reference, i, size);
+
+		if (i == size) {
+			break;
+		}
+
+		size_t literalStart = i;
+		size_t literalEnd = i + 1;
+		for (size_t j = literalEnd; j < size && j - literalEnd < MIN_ZERO_RUN; ++j) {
+			char ref = reference ? reference[j] : 0;
+			if (state[j] != ref) {
+				literalEnd = j + 1;
+			}
+		}
+
+		writeVarint(target, literalStart - start);
+		writeVarint(target, literalEnd - literalStart);
+
+		for (size_t pos = literalStart; pos < literalEnd; ++pos) {
+			target.push_back(reference ? state[pos] ^ reference[pos] : state[pos]);
+		}
+
+		i = literalEnd;
+	}
+}
+
+static bool applyDelta(const char* data, size_t dataSize, char* target, size_t size) {
+	const char* end = data + dataSize;
+	size_t pos = 0;
+
+	while (data < end) {
+		size_t skip, literal;
+		if (!readVarint(data, end, skip) || !readVarint(data, end, literal)) {
+			return false;
+		}
+
+		pos += skip;
+		if (pos > size || literal > size - pos || literal > (size_t)(end - data)) {
+			return false;
+		}
+
+		for (size_t i = 0; i < literal; ++i) {
+			target[pos + i] ^= data[i];
+		}
+
+		pos += literal;
+		data += literal;
+	}
+
+	return true;
+}
+
+namespace StateCodec {
+	void getChunks(const char* state, size_t size, std::vector<StateChunk>& chunks) {
+		chunks.clear();
+
+		if (!parseSections(state, size, chunks)) {
+			chunks.clear();
+			addChunks(chunks, 0, size, StateSection::Unknown);
+		}
+	}
+
+	bool isEncoded(const char* data, size_t size) {
+		return size >= HEADER_SIZE && memcmp(data, STATE_MAGIC, sizeof(STATE_MAGIC)) == 0;
+	}
+
+	uint64_t getKeyframeHash(const char* data, size_t size) {
+		return isEncoded(data, size) ? readU64(data + 16) : 0;
+	}
+
+	bool decode(const char* data, size_t size, const char* keyframe, size_t keyframeSize, std::vector<char>& target) {
+		if (!isEncoded(data, size) || readU32(data + 4) != STATE_VERSION) {
+			return false;
+		}
+
+		size_t stateSize = readU32(data + 8);
+		size_t chunkCount = readU32(data + 12);
+		uint64_t keyframeHash = readU64(data + 16);
+		uint64_t stateHash = readU64(data + 24);
+
+		if (keyframeHash != 0) {
+			if (!keyframe || keyframeSize != stateSize || XXH3_64bits(keyframe, keyframeSize) != keyframeHash) {
+				return false;
+			}
+
+			target.assign(keyframe, keyframe + keyframeSize);
+		} else {
+			target.assign(stateSize, 0);
+		}
+
+		if (chunkCount > (size - HEADER_SIZE) / INDEX_ENTRY_SIZE) {
+			return false;
+		}
+
+		const char* index = data + HEADER_SIZE;
+		size_t payloadOffset = HEADER_SIZE + chunkCount * INDEX_ENTRY_SIZE;
+
+		for (size_t i = 0; i < chunkCount; ++i) {
+			const char* entry = index + i * INDEX_ENTRY_SIZE;
+			size_t offset = readU32(entry);
+			size_t chunkSize = readU32(entry + 4);
+			size_t payloadSize = readU32(entry + 8);
+			ChunkType type = (ChunkType)entry[12];
+
+			if (offset + chunkSize > stateSize || payloadSize > size - payloadOffset) {
+				return false;
+			}
+
+			if (type == ChunkType::Delta) {
+				if (!applyDelta(data + payloadOffset, payloadSize, target.data() + offset, chunkSize)) {
+					return false;
+				}
+			} else if (type != ChunkType::Same) {
+				return false;
+			}
+
+			payloadOffset += payloadSize;
+		}
+
+		return XXH3_64bits(target.data(), target.size()) == stateHash;
+	}
+}
+
+DataBufferPtr StateEncoder::acquireCapture() {
+	if (_captureBusy) {
+		return std::make_shared<DataBuffer<char>>(MAX_STATE_SIZE);
+	}
+
+	if (_capture.empty()) {
+		_capture.resize(MAX_STATE_SIZE);
+	}
+
+	_captureBusy = true;
+	return std::make_shared<DataBuffer<char>>(_capture.data(), _capture.size());
+}
+
+void StateEncoder::releaseCapture(const DataBufferPtr& buffer) {
+	if (buffer && buffer->data() == _capture.data()) {
+		_captureBusy = false;
+	}
+}
+
+void StateEncoder::setKeyframe(const char* state, size_t size) {
+	_keyframe.assign(state, state + size);
+	_keyframeHash = XXH3_64bits(state, size);
+
+	encodeChunks(state, size, nullptr, false);
+	_encodedKeyframe = writeOutput(size, 0, _keyframeHash);
+
+	// The cached chunks were encoded against the old keyframe
+	_last.clear();
+	_oversizedSaves = 0;
+}
+
+bool StateEncoder::setEncodedKeyframe(const DataBufferPtr& encoded) {
+	std::vector<char> keyframe;
+	if (!encoded || StateCodec::getKeyframeHash(encoded->data(), encoded->size()) != 0
+		|| !StateCodec::decode(encoded->data(), encoded->size(), nullptr, 0, keyframe)) {
+		return false;
+	}
+
+	_keyframe = std::move(keyframe);
+	_keyframeHash = XXH3_64bits(_keyframe.data(), _keyframe.size());
+	_encodedKeyframe = encoded;
+	_last.clear();
+	_oversizedSaves = 0;
+
+	return true;
+}
+
+void StateEncoder::clear() {
+	_keyframe = std::vector<char>();
+	_keyframeHash = 0;
+	_encodedKeyframe = nullptr;
+	_last = std::vector<char>();
+	_oversizedSaves = 0;
+}
+
+DataBufferPtr StateEncoder::encode(const char* state, size_t size) {
+	if (_keyframe.size() != size) {
+		setKeyframe(state, size);
+	}
+
+	encodeChunks(state, size, _keyframe.data(), true);
+
+	// Every new keyframe has to be stored as well, so a single save that wanders far from the
+	// keyframe isn't enough to replace it
+	if (_payload.size() > _encodedKeyframe->size() / 2) {
+		if (++_oversizedSaves >= KEYFRAME_REPLACE_SAVES) {
+			setKeyframe(state, size);
+			encodeChunks(state, size, _keyframe.data(), false);
+		}
+	} else {
+		_oversizedSaves = 0;
+	}
+
+	_last.assign(state, state + size);
+
+	return writeOutput(size, _keyframeHash, XXH3_64bits(state, size));
+}
+
+void StateEncoder::encodeChunks(const char* state, size_t size, const char* keyframe, bool useCache) {
+	std::vector<StateChunk> chunks;
+	StateCodec::getChunks(state, size, chunks);
+
+	bool cacheValid = useCache && _last.size() == size && chunks.size() == _chunks.size();
+	for (size_t i = 0; cacheValid && i < chunks.size(); ++i) {
+		cacheValid = chunks[i].offset == _chunks[i].offset && chunks[i].size == _chunks[i].size;
+	}
+
+	std::vector<char> payload;
+	std::vector<uint32_t> offsets(chunks.size());
+	std::vector<uint32_t> sizes(chunks.size());
+	std::vector<uint8_t> types(chunks.size());
+
+	for (size_t i = 0; i < chunks.size(); ++i) {
+		const StateChunk& chunk = chunks[i];
+		const char* data = state + chunk.offset;
+		const char* reference = keyframe ? keyframe + chunk.offset : nullptr;
+		size_t start = payload.size();
+
+		if (cacheValid && memcmp(data, _last.data() + chunk.offset, chunk.size) == 0) {
+			// Unchanged since the last save, so the previous encoding still applies
+			const char* cached = _payload.data() + _payloadOffsets[i];
+			payload.insert(payload.end(), cached, cached + _payloadSizes[i]);
+			types[i] = _payloadTypes[i];
+		} else if (isSame(data, reference, chunk.size)) {
+			types[i] = (uint8_t)ChunkType::Same;
+		} else {
+			encodeDelta(data, reference, chunk.size, payload);
+			types[i] = (uint8_t)ChunkType::Delta;
+		}
+
+		offsets[i] = (uint32_t)start;
+		sizes[i] = (uint32_t)(payload.size() - start);
+	}
+
+	_chunks = std::move(chunks);
+	_payload = std::move(payload);
+	_payloadOffsets = std::move(offsets);
+	_payloadSizes = std::move(sizes);
+	_payloadTypes = std::move(types);
+}
+
+DataBufferPtr StateEncoder::writeOutput(size_t stateSize, uint64_t keyframeHash, uint64_t stateHash) {
+	size_t indexSize = _chunks.size() * INDEX_ENTRY_SIZE;
+	DataBufferPtr output = std::make_shared<DataBuffer<char>>(HEADER_SIZE + indexSize + _payload.size());
+	char* target = output->data();
+
+	memcpy(target, STATE_MAGIC, sizeof(STATE_MAGIC));
+	writeU32(target + 4, STATE_VERSION);
+	writeU32(target + 8, (uint32_t)stateSize);
+	writeU32(target + 12, (uint32_t)_chunks.size());
+	writeU64(target + 16, keyframeHash);
+	writeU64(target + 24, stateHash);
+
+	char* index = target + HEADER_SIZE;
+	for (size_t i = 0; i < _chunks.size(); ++i) {
+		char* entry = index + i * INDEX_ENTRY_SIZE;
+		writeU32(entry, _chunks[i].offset);
+		writeU32(entry + 4, _chunks[i].size);
+		writeU32(entry + 8, _payloadSizes[i]);
+		entry[12] = (char)_payloadTypes[i];
+		entry[13] = (char)_chunks[i].section;
+		entry[14] = 0;
+		entry[15] = 0;
+	}
+
+	if (!_payload.empty()) {
+		memcpy(index + indexSize, _payload.data(), _payload.size());
+	}
+
+	return output;
+}
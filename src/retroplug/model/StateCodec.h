@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "util/DataBuffer.h"
+
+enum class StateSection : uint8_t {
+	Unknown,
+	Cpu,
+	Hram,
+	Timing,
+	Apu,
+	Rtc,
+	Video,
+	Sgb,
+	CartRam,
+	Wram,
+	Vram,
+	Bess
+};
+
+struct StateChunk {
+	uint32_t offset;
+	uint32_t size;
+	StateSection section;
+};
+
+// Save states are stored as a chunk index followed by the chunks that differ from a reference
+// keyframe.  Changed chunks are the XOR of the state and the keyframe with runs of unchanged
+// bytes skipped.  A state encoded without a keyframe is encoded against zeroes, which is how
+// keyframes themselves are stored.
+namespace StateCodec {
+	// Splits a SameBoy state in to its sections using the BESS footer.  Large sections are split
+	// further so a single changed byte doesn't rewrite all of cart RAM.
+	void getChunks(const char* state, size_t size, std::vector<StateChunk>& chunks);
+
+	bool isEncoded(const char* data, size_t size);
+
+	// Hash of the keyframe the data was encoded against, or 0 if it doesn't need one
+	uint64_t getKeyframeHash(const char* data, size_t size);
+
+	// Decodes `data` in to `target`.  `keyframe` must be the decoded keyframe the state was
+	// encoded against, and can be null if the state doesn't need one.
+	bool decode(const char* data, size_t size, const char* keyframe, size_t keyframeSize, std::vector<char>& target);
+}
+
+// Encodes the states of a single system for a project.  The keyframe is the state from an
+// earlier save (or the keyframe the system was loaded with) and is only replaced when the
+// deltas against it stay too large for several saves.  Chunks that haven't changed since the
+// last save reuse their previous encoding.
+class StateEncoder {
+private:
+	std::vector<char> _keyframe;
+	uint64_t _keyframeHash = 0;
+	DataBufferPtr _encodedKeyframe;
+	size_t _oversizedSaves = 0;
+
+	std::vector<char> _capture;
+	bool _captureBusy = false;
+
+	std::vector<char> _last;
+	std::vector<StateChunk> _chunks;
+	std::vector<uint32_t> _payloadOffsets;
+	std::vector<uint32_t> _payloadSizes;
+	std::vector<uint8_t> _payloadTypes;
+	std::vector<char> _payload;
+
+public:
+	// Returns a buffer for the audio thread to write a state in to.  The same memory is reused
+	// for every save, unless a previous fetch is still using it.
+	DataBufferPtr acquireCapture();
+
+	void releaseCapture(const DataBufferPtr& buffer);
+
+	// Uses `state` as the keyframe for the next save
+	void setKeyframe(const char* state, size_t size);
+
+	// Keeps using a keyframe from an earlier session.  Returns false if it can't be decoded.
+	bool setEncodedKeyframe(const DataBufferPtr& encoded);
+
+	void clear();
+
+	// Encodes `state` against the current keyframe.  The keyframe is replaced first if the
+	// deltas have been larger than half of it for KEYFRAME_REPLACE_SAVES saves in a row.
+	DataBufferPtr encode(const char* state, size_t size);
+
+	// The current keyframe, encoded so it can be decoded without a reference
+	DataBufferPtr getEncodedKeyframe() const { return _encodedKeyframe; }
+
+private:
+	void encodeChunks(const char* state, size_t size, const char* keyframe, bool useCache);
+
+	DataBufferPtr writeOutput(size_t stateSize, uint64_t keyframeHash, uint64_t stateHash);
+};
@@ -0,0 +1,82 @@
+#include "SystemPool.h"
+
+void SystemPool::setVideoFormat(VideoFormat format) {
+	std::vector<SameBoyPlugPtr> stale;
+
+	{
+		std::scoped_lock lock(_mutex);
+		if (format != _videoFormat) {
+			_videoFormat = format;
+			stale.swap(_ready);
+		}
+
+		if (!_running) {
+			_running = true;
+			_thread = std::thread(&SystemPool::run, this);
+		}
+	}
+
+	_cv.notify_one();
+}
+
+SameBoyPlugPtr SystemPool::take() {
+	VideoFormat format;
+
+	{
+		std::scoped_lock lock(_mutex);
+		format = _videoFormat;
+
+		if (!_ready.empty()) {
+			SameBoyPlugPtr plug = std::move(_ready.back());
+			_ready.pop_back();
+			_cv.notify_one();
+			return plug;
+		}
+	}
+
+	return create(format);
+}
+
+void SystemPool::stop() {
+	{
+		std::scoped_lock lock(_mutex);
+		if (!_running) {
+			return;
+		}
+
+		_running = false;
+	}
+
+	_cv.notify_one();
+	_thread.join();
+	_ready.clear();
+}
+
+SameBoyPlugPtr SystemPool::create(VideoFormat format) {
+	SameBoyPlugPtr plug = std::make_shared<SameBoyPlug>(format);
+	plug->prepare(GameboyModel::Auto);
+	return plug;
+}
+
+void SystemPool::run() {
+	std::unique_lock lock(_mutex);
+
+	while (_running) {
+		if (_ready.size() >= SYSTEM_POOL_SIZE) {
+			_cv.wait(lock);
+			continue;
+		}
+
+		VideoFormat format = _videoFormat;
+		lock.unlock();
+
+		SameBoyPlugPtr plug = create(format);
+
+		lock.lock();
+
+		// The format may have changed while the system was being created
+		if (format == _videoFormat) {
+			_ready.push_back(std::move(plug));
+		}
+	}
+}
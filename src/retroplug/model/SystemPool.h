@@ -0,0 +1,41 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "plugs/SameBoyPlug.h"
+
+// How many prepared systems to keep ready
+const size_t SYSTEM_POOL_SIZE = 2;
+
+// Keeps a few systems allocated and initialised on a background thread, so loading a ROM or
+// duplicating a system only has to load the ROM in to one that is already set up.
+class SystemPool {
+private:
+	std::thread _thread;
+	std::mutex _mutex;
+	std::condition_variable _cv;
+	bool _running = false;
+
+	VideoFormat _videoFormat = VideoFormat::Rgba;
+	std::vector<SameBoyPlugPtr> _ready;
+
+public:
+	~SystemPool() { stop(); }
+
+	// Starts the pool thread if it isn't running.  Prepared systems that render in another format
+	// are thrown away.
+	void setVideoFormat(VideoFormat format);
+
+	// Returns a prepared system, or creates one on the calling thread if none are ready
+	SameBoyPlugPtr take();
+
+	void stop();
+
+private:
+	static SameBoyPlugPtr create(VideoFormat format);
+
+	void run();
+};
@@ -0,0 +1,10 @@
+#pragma once
+
+// Runtime checks for instruction set extensions, used to pick SIMD kernels.  Always false on
+// CPUs the extension doesn't exist for.
+namespace cpu {
+	bool hasSse2();
+
+	// Also checks the OS saves the upper halves of the YMM registers
+	bool hasAvx2();
+}
@@ -0,0 +1,335 @@
+#include "RtGuard.h"
+
+#ifdef RP_RT_GUARD
+
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <stdint.h>
+#include <stdlib.h>
+#include <vector>
+#include <spdlog/spdlog.h>
+
+#if defined(RP_POSIX)
+#include <dlfcn.h>
+#endif
+
+#if defined(RP_LINUX)
+#include <pthread.h>
+
+extern "C" {
+	void* __libc_malloc(size_t size);
+	void* __libc_calloc(size_t count, size_t size);
+	void* __libc_realloc(void* ptr, size_t size);
+	void* __libc_memalign(size_t alignment, size_t size);
+	void __libc_free(void* ptr);
+}
+
+// Dynamic TLS can allocate on first access, which would recurse straight back into malloc
+#define RT_THREAD_LOCAL __attribute__((tls_model("initial-exec"))) thread_local
+#define RAW_MALLOC __libc_malloc
+#define RAW_FREE __libc_free
+#define RAW_ALIGNED_MALLOC(size, alignment) __libc_memalign(alignment, size)
+#define RAW_ALIGNED_FREE __libc_free
+#elif defined(RP_WINDOWS)
+#include <malloc.h>
+
+#define RT_THREAD_LOCAL thread_local
+#define RAW_MALLOC malloc
+#define RAW_FREE free
+#define RAW_ALIGNED_MALLOC(size, alignment) _aligned_malloc(size, alignment)
+#define RAW_ALIGNED_FREE _aligned_free
+#else
+static void* posixAlignedMalloc(size_t size, size_t alignment) {
+	void* p = nullptr;
+	return posix_memalign(&p, std::max(alignment, sizeof(void*)), size) == 0 ? p : nullptr;
+}
+
+#define RT_THREAD_LOCAL thread_local
+#define RAW_MALLOC malloc
+#define RAW_FREE free
+#define RAW_ALIGNED_MALLOC posixAlignedMalloc
+#define RAW_ALIGNED_FREE free
+#endif
+
+#define CALL_SITE() __builtin_return_address(0)
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#undef CALL_SITE
+#define CALL_SITE() _ReturnAddress()
+#endif
+
+namespace rtguard {
+	const size_t MAX_SITES = 512;
+	const size_t TYPE_COUNT = (size_t)ViolationType::COUNT;
+
+	struct Site {
+		std::atomic<void*> callSite;
+		std::atomic<const char*> scope;
+		std::atomic<size_t> count;
+	};
+
+	// Fixed open addressed tables so recording never allocates
+	static Site s_sites[TYPE_COUNT][MAX_SITES];
+	static std::atomic<size_t> s_counts[TYPE_COUNT];
+	static std::atomic<size_t> s_droppedSites;
+
+	static RT_THREAD_LOCAL int t_depth = 0;
+	static RT_THREAD_LOCAL const char* t_scope = nullptr;
+	static RT_THREAD_LOCAL bool t_recording = false;
+
+	static void record(ViolationType type, void* callSite) {
+		if (t_depth == 0 || t_recording) {
+			return;
+		}
+
+		t_recording = true;
+		s_counts[(size_t)type].fetch_add(1, std::memory_order_relaxed);
+
+		Site* sites = s_sites[(size_t)type];
+		size_t idx = ((uintptr_t)callSite >> 2) & (MAX_SITES - 1);
+
+		size_t probe = 0;
+		for (; probe < MAX_SITES; ++probe) {
+			Site& site = sites[idx];
+			void* existing = site.callSite.load(std::memory_order_acquire);
+
+			if (existing == nullptr && site.callSite.compare_exchange_strong(existing, callSite)) {
+				site.scope.store(t_scope, std::memory_order_relaxed);
+				existing = callSite;
+			}
+
+			if (existing == callSite) {
+				site.count.fetch_add(1, std::memory_order_relaxed);
+				break;
+			}
+
+			idx = (idx + 1) & (MAX_SITES - 1);
+		}
+
+		if (probe == MAX_SITES) {
+			s_droppedSites.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		t_recording = false;
+	}
+
+	Scope::Scope(const char* name) : _prev(t_scope) {
+		t_scope = name;
+		t_depth++;
+	}
+
+	Scope::~Scope() {
+		t_depth--;
+		t_scope = _prev;
+	}
+
+	bool isEnabled() {
+		return true;
+	}
+
+	size_t getViolationCount(ViolationType type) {
+		return s_counts[(size_t)type].load(std::memory_order_relaxed);
+	}
+
+	size_t getViolations(Violation* target, size_t maxCount) {
+		size_t count = 0;
+
+		for (size_t type = 0; type < TYPE_COUNT; ++type) {
+			for (size_t i = 0; i < MAX_SITES && count < maxCount; ++i) {
+				const Site& site = s_sites[type][i];
+				size_t siteCount = site.count.load(std::memory_order_relaxed);
+
+				if (siteCount > 0) {
+					target[count++] = Violation {
+						(ViolationType)type,
+						site.scope.load(std::memory_order_relaxed),
+						site.callSite.load(std::memory_order_relaxed),
+						siteCount
+					};
+				}
+			}
+		}
+
+		return count;
+	}
+
+	void resetViolations() {
+		for (size_t type = 0; type < TYPE_COUNT; ++type) {
+			s_counts[type] = 0;
+
+			for (size_t i = 0; i < MAX_SITES; ++i) {
+				s_sites[type][i].count = 0;
+				s_sites[type][i].scope = nullptr;
+				s_sites[type][i].callSite = nullptr;
+			}
+		}
+
+		s_droppedSites = 0;
+	}
+
+	static const char* typeName(ViolationType type) {
+		switch (type) {
+			case ViolationType::Alloc: return "allocation";
+			case ViolationType::Free: return "free";
+			case ViolationType::Lock: return "mutex lock";
+			default: return "unknown";
+		}
+	}
+
+	void dumpViolations() {
+		size_t allocs = getViolationCount(ViolationType::Alloc);
+		size_t frees = getViolationCount(ViolationType::Free);
+		size_t locks = getViolationCount(ViolationType::Lock);
+
+		if (allocs + frees + locks == 0) {
+			spdlog::info("RT guard: no real-time violations recorded");
+			return;
+		}
+
+		spdlog::warn("RT guard: {} allocations, {} frees, {} mutex locks on the audio thread", allocs, frees, locks);
+
+		std::vector<Violation> violations(TYPE_COUNT * MAX_SITES);
+		violations.resize(getViolations(violations.data(), violations.size()));
+
+		for (const Violation& v : violations) {
+			const char* scope = v.scope ? v.scope : "?";
+
+#if defined(RP_POSIX)
+			Dl_info info;
+			if (dladdr(v.callSite, &info) && info.dli_sname) {
+				size_t offset = (size_t)((char*)v.callSite - (char*)info.dli_saddr);
+				spdlog::warn("  {} x{} in {}: {}+0x{:x} ({})", typeName(v.type), v.count, scope, info.dli_sname, offset, info.dli_fname);
+				continue;
+			}
+#endif
+
+			spdlog::warn("  {} x{} in {}: {}", typeName(v.type), v.count, scope, v.callSite);
+		}
+
+		if (s_droppedSites > 0) {
+			spdlog::warn("  {} violations from call sites that didn't fit in the table", s_droppedSites.load());
+		}
+	}
+}
+
+using rtguard::ViolationType;
+
+// Every replaceable form is defined, as the sized and aligned deletes would otherwise go
+// straight to the default implementations without being recorded
+static void* allocate(size_t size, void* callSite) {
+	rtguard::record(ViolationType::Alloc, callSite);
+	return RAW_MALLOC(size ? size : 1);
+}
+
+static void* allocateAligned(size_t size, std::align_val_t alignment, void* callSite) {
+	rtguard::record(ViolationType::Alloc, callSite);
+	return RAW_ALIGNED_MALLOC(size ? size : 1, (size_t)alignment);
+}
+
+static void release(void* p, void* callSite) {
+	if (p) {
+		rtguard::record(ViolationType::Free, callSite);
+		RAW_FREE(p);
+	}
+}
+
+static void releaseAligned(void* p, void* callSite) {
+	if (p) {
+		rtguard::record(ViolationType::Free, callSite);
+		RAW_ALIGNED_FREE(p);
+	}
+}
+
+static void* checked(void* p) {
+	if (!p) {
+		throw std::bad_alloc();
+	}
+
+	return p;
+}
+
+void* operator new(size_t size) { return checked(allocate(size, CALL_SITE())); }
+void* operator new[](size_t size) { return checked(allocate(size, CALL_SITE())); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return allocate(size, CALL_SITE()); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return allocate(size, CALL_SITE()); }
+
+void* operator new(size_t size, std::align_val_t alignment) { return checked(allocateAligned(size, alignment, CALL_SITE())); }
+void* operator new[](size_t size, std::align_val_t alignment) { return checked(allocateAligned(size, alignment, CALL_SITE())); }
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return allocateAligned(size, alignment, CALL_SITE()); }
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return allocateAligned(size, alignment, CALL_SITE()); }
+
+void operator delete(void* p) noexcept { release(p, CALL_SITE()); }
+void operator delete[](void* p) noexcept { release(p, CALL_SITE()); }
+void operator delete(void* p, size_t) noexcept { release(p, CALL_SITE()); }
+void operator delete[](void* p, size_t) noexcept { release(p, CALL_SITE()); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { release(p, CALL_SITE()); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { release(p, CALL_SITE()); }
+
+void operator delete(void* p, std::align_val_t) noexcept { releaseAligned(p, CALL_SITE()); }
+void operator delete[](void* p, std::align_val_t) noexcept { releaseAligned(p, CALL_SITE()); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { releaseAligned(p, CALL_SITE()); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { releaseAligned(p, CALL_SITE()); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { releaseAligned(p, CALL_SITE()); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { releaseAligned(p, CALL_SITE()); }
+
+#if defined(RP_LINUX)
+// glibc exports its allocator under __libc_* names, so the C allocation functions and mutex
+// locking can be interposed directly.
+extern "C" {
+	void* malloc(size_t size) {
+		rtguard::record(ViolationType::Alloc, CALL_SITE());
+		return __libc_malloc(size);
+	}
+
+	void* calloc(size_t count, size_t size) {
+		rtguard::record(ViolationType::Alloc, CALL_SITE());
+		return __libc_calloc(count, size);
+	}
+
+	void* realloc(void* ptr, size_t size) {
+		rtguard::record(ViolationType::Alloc, CALL_SITE());
+		return __libc_realloc(ptr, size);
+	}
+
+	void free(void* ptr) {
+		if (ptr) {
+			rtguard::record(ViolationType::Free, CALL_SITE());
+		}
+
+		__libc_free(ptr);
+	}
+
+	using MutexLockFunc = int(*)(pthread_mutex_t*);
+	static std::atomic<MutexLockFunc> s_mutexLock;
+
+	int pthread_mutex_lock(pthread_mutex_t* mutex) {
+		rtguard::record(ViolationType::Lock, CALL_SITE());
+
+		MutexLockFunc func = s_mutexLock.load(std::memory_order_relaxed);
+		if (!func) {
+			func = (MutexLockFunc)dlsym(RTLD_NEXT, "pthread_mutex_lock");
+			s_mutexLock.store(func, std::memory_order_relaxed);
+		}
+
+		return func(mutex);
+	}
+}
+#endif
+
+#else
+
+namespace rtguard {
+	bool isEnabled() { return false; }
+
+	size_t getViolationCount(ViolationType type) { return 0; }
+
+	size_t getViolations(Violation* target, size_t maxCount) { return 0; }
+
+	void resetViolations() {}
+
+	void dumpViolations() {}
+}
+
+#endif
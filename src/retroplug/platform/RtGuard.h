@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stddef.h>
+
+// Real-time safety checks for the audio thread.  When built with RP_RT_GUARD (premake
+// --rt-guard), allocations, frees and mutex locks that happen while a Scope is active on the
+// current thread are counted per call site.  Allocations are caught through operator new/delete
+// everywhere, malloc/free and pthread mutexes are only hooked on Linux.  Without RP_RT_GUARD
+// scopes compile away and every count is 0.
+namespace rtguard {
+	enum class ViolationType {
+		Alloc,
+		Free,
+		Lock,
+		COUNT
+	};
+
+	struct Violation {
+		ViolationType type;
+		const char* scope;
+		void* callSite;
+		size_t count;
+	};
+
+#ifdef RP_RT_GUARD
+	class Scope {
+	private:
+		const char* _prev;
+
+	public:
+		Scope(const char* name);
+		~Scope();
+	};
+#else
+	class Scope {
+	public:
+		Scope(const char*) {}
+	};
+#endif
+
+	bool isEnabled();
+
+	size_t getViolationCount(ViolationType type);
+
+	// Copies up to maxCount call sites into target and returns how many were written
+	size_t getViolations(Violation* target, size_t maxCount);
+
+	void resetViolations();
+
+	// Logs every recorded call site.  Allocates, so don't call it from a guarded scope.
+	void dumpViolations();
+}
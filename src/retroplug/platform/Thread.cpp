@@ -0,0 +1,108 @@
+#include "Thread.h"
+
+#include <spdlog/spdlog.h>
+
+#if defined(RP_WINDOWS)
+#include <limits.h>
+#include <windows.h>
+#elif defined(RP_POSIX)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#if defined(RP_MACOS)
+#include <dispatch/dispatch.h>
+#elif !defined(RP_WINDOWS)
+#include <errno.h>
+#include <semaphore.h>
+#endif
+
+void setupRealtimeThread(std::thread& thread, size_t core, const char* name) {
+	size_t coreCount = std::max(std::thread::hardware_concurrency(), 1u);
+	core = core % coreCount;
+
+#if defined(RP_WINDOWS)
+	HANDLE handle = (HANDLE)thread.native_handle();
+	SetThreadAffinityMask(handle, (DWORD_PTR)1 << core);
+
+	if (!SetThreadPriority(handle, THREAD_PRIORITY_TIME_CRITICAL)) {
+		spdlog::warn("Failed to set real-time priority for {}", name);
+	}
+#elif defined(RP_POSIX)
+	pthread_t handle = thread.native_handle();
+
+#if defined(RP_LINUX)
+	cpu_set_t cpus;
+	CPU_ZERO(&cpus);
+	CPU_SET(core, &cpus);
+	pthread_setaffinity_np(handle, sizeof(cpu_set_t), &cpus);
+#endif
+
+	sched_param param = {};
+	param.sched_priority = sched_get_priority_max(SCHED_FIFO) - 1;
+	if (pthread_setschedparam(handle, SCHED_FIFO, &param) != 0) {
+		spdlog::warn("Failed to set real-time priority for {}", name);
+	}
+#endif
+}
+
+// macOS doesn't support unnamed POSIX semaphores
+#if defined(RP_WINDOWS)
+Semaphore::Semaphore() {
+	_handle = CreateSemaphore(NULL, 0, LONG_MAX, NULL);
+}
+
+Semaphore::~Semaphore() {
+	CloseHandle((HANDLE)_handle);
+}
+
+void Semaphore::signal(size_t count) {
+	if (count > 0) {
+		ReleaseSemaphore((HANDLE)_handle, (LONG)count, NULL);
+	}
+}
+
+void Semaphore::wait() {
+	WaitForSingleObject((HANDLE)_handle, INFINITE);
+}
+#elif defined(RP_MACOS)
+Semaphore::Semaphore() {
+	_handle = (void*)dispatch_semaphore_create(0);
+}
+
+Semaphore::~Semaphore() {
+	dispatch_release((dispatch_semaphore_t)_handle);
+}
+
+void Semaphore::signal(size_t count) {
+	for (size_t i = 0; i < count; ++i) {
+		dispatch_semaphore_signal((dispatch_semaphore_t)_handle);
+	}
+}
+
+void Semaphore::wait() {
+	dispatch_semaphore_wait((dispatch_semaphore_t)_handle, DISPATCH_TIME_FOREVER);
+}
+#else
+Semaphore::Semaphore() {
+	sem_t* sem = new sem_t;
+	sem_init(sem, 0, 0);
+	_handle = sem;
+}
+
+Semaphore::~Semaphore() {
+	sem_t* sem = (sem_t*)_handle;
+	sem_destroy(sem);
+	delete sem;
+}
+
+void Semaphore::signal(size_t count) {
+	for (size_t i = 0; i < count; ++i) {
+		sem_post((sem_t*)_handle);
+	}
+}
+
+void Semaphore::wait() {
+	while (sem_wait((sem_t*)_handle) != 0 && errno == EINTR) {}
+}
+#endif
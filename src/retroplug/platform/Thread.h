@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stddef.h>
+#include <thread>
+
+// Pins a thread to a core and raises it to real-time priority.  Failures are logged and
+// otherwise ignored, the thread still runs at normal priority.
+void setupRealtimeThread(std::thread& thread, size_t core, const char* name);
+
+// A counting semaphore for parking threads.  signal() doesn't allocate or lock, so it can be
+// called from the audio thread.
+class Semaphore {
+private:
+	void* _handle;
+
+public:
+	Semaphore();
+	~Semaphore();
+
+	Semaphore(const Semaphore&) = delete;
+	Semaphore& operator=(const Semaphore&) = delete;
+
+	void signal(size_t count = 1);
+
+	void wait();
+};
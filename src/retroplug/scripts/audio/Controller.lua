@@ -8,7 +8,6 @@ local midi = require("midi")
 local componentutil = require("util.component")
 local ConfigLoader = require("ConfigLoader")
 local InputConfig = require("InputConfigParser")
-local const = require("const")
 local serpent = require("serpent")
 
 local Controller = class()
@@ -55,7 +54,7 @@ function Controller:loadConfigFromPath(path)
 end
 
 function Controller:initProject()
-	for i = 1, const.MAX_SYSTEMS, 1 do
+	for i = 1, self._model:getSystemCount(), 1 do
 		local instModel = self._model:getSystem(i - 1)
 		if instModel ~= nil then
 			local state = componentutil.createState(self._components)
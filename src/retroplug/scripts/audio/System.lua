@@ -26,10 +26,20 @@ function System:sendSerialByte(offset, byte)
 	self._model:sendSerialByte(offset, byte)
 end
 
+-- Button presses and serial bytes dropped since the system was created, because more arrived in
+-- a block than the queues hold
+function System:buttonOverflowCount()
+	return self._model:getButtonOverflowCount()
+end
+
+function System:serialOverflowCount()
+	return self._model:getSerialOverflowCount()
+end
+
 function System:sramHasChanged()
-	local hash = self.model:hashSram(0, 0)
-	if hash ~= self._sramHash then
-		self._sramHash = hash
+	local generation = self._model:getSramGeneration()
+	if generation ~= self._sramGeneration then
+		self._sramGeneration = generation
 		return true
 	end
 
@@ -34,7 +34,18 @@ local configSchema = s.Record {
 		midiRouting = s.OneOf("oneChannelPerInstance", "fourChannelsPerInstance", "sendToAll"),
 		layout = s.OneOf("auto", "column", "grid", "row"),
 		includeRom = s.Boolean
-	}
+	},
+	audio = s.Optional(s.Record {
+		workerThreads = s.Optional(s.NumberFrom(0, 16)),
+		lookaheadBlocks = s.Optional(s.NumberFrom(0, 8)),
+		rewindSeconds = s.Optional(s.NumberFrom(0, 600)),
+		rewindMemoryMb = s.Optional(s.NumberFrom(1, 2048)),
+		sramAutosaveSeconds = s.Optional(s.NumberFrom(0, 3600)),
+		indexedVideo = s.Optional(s.Boolean),
+		systemCount = s.Optional(s.NumberFrom(1, 16)),
+		bootStates = s.Optional(s.OneOf("off", "memory", "disk")),
+		timingOverlay = s.Optional(s.Boolean)
+	})
 }
 
 function module.loadConfigFromString(code)
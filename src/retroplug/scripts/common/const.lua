@@ -1,7 +1,8 @@
 local SemVer = require("SemVer")
 
 return {
-	MAX_SYSTEMS = 4,
+	MAX_SYSTEMS = 16,
+	DEFAULT_SYSTEM_COUNT = 4,
 	NO_VALID_INDEX = -1,
 	VERSION = SemVer(0, 3, 0),
 	SRAM_SIZE = 0x20000
@@ -7,7 +7,6 @@ local fs = require("fs")
 local Globals = require("Globals")
 
 local NO_ACTIVE_SYSTEM = 0
-local MAX_SYSTEMS = 4
 
 local MainMenu = {}
 
@@ -93,7 +92,7 @@ local function projectMenu(menu)
 			:select("Include ROM", settings.includeRom, function(v) settings.includeRom = v end)
 			:parent()
 		:separator()
-		:subMenu("Add System", #Project.systems < MAX_SYSTEMS)
+		:subMenu("Add System", #Project.systems < Project.getSystemCount())
 			:action("Load ROM...", loadRom(NO_ACTIVE_SYSTEM, GameboyModel.Auto))
 			:action("Duplicate Selected", function()
 				Project.duplicateSystem(Project.getSelectedIndex())
@@ -142,6 +141,12 @@ local function systemMenu(menu, system)
 			:action("CGB E (default)", function() system:reset(GameboyModel.CgbE) end)
 			:action("DMG B", function() system:reset(GameboyModel.DmgB) end)
 			:parent()
+		:subMenu("Rewind", system:rewindLength() > 0)
+			:action("1 Second", function() system:rewind(1) end)
+			:action("5 Seconds", function() system:rewind(5) end)
+			:action("10 Seconds", function() system:rewind(10) end)
+			:action("30 Seconds", function() system:rewind(30) end)
+			:parent()
 		:separator()
 		:action("New .sav", function() system:clearSram(true) end)
 		:action("Load .sav...", loadSram(system, true))
@@ -1,4 +1,3 @@
-local const = require("const")
 local projectutil = require("util.project")
 local propertyutil = require("util.property")
 local inpututil = require("util.input")
@@ -67,7 +66,7 @@ local function setSystem(system)
 	local idx = desc.idx + 1
 
 	if idx == 0 then
-		assert(#_data.systems < const.MAX_SYSTEMS)
+		assert(#_data.systems < _ctx:getSystemCount())
 		idx = #_data.systems + 1
 	end
 
@@ -84,7 +83,7 @@ local function setSystem(system)
 end
 
 function Project.addSystem(systemType)
-	assert(#_data.systems < 4)
+	assert(#_data.systems < _ctx:getSystemCount())
 
 	local desc = SystemDesc.new()
 	desc.idx = #_data.systems
@@ -107,7 +106,7 @@ function Project.addSystem(systemType)
 end
 
 function Project.setSelected(idx)
-	if idx <= const.MAX_SYSTEMS then
+	if idx <= _ctx:getSystemCount() then
 		_native.selectedSystem = idx - 1
 		_data.system = _data.systems[idx]
 		_ctx:updateSelected()
@@ -146,7 +145,14 @@ function Project.load(data)
 	util.copyStringFields(projectData.settings, projectutil.ProjectSettingsFields, _native.settings)
 	_ctx:updateSettings()
 
-	for _, system in ipairs(systems) do
+	local systemCount = _ctx:getSystemCount()
+	if #systems > systemCount then
+		log.warn("Project has " .. #systems .. " systems but only " .. systemCount .. " are configured, the rest will not be loaded")
+	end
+
+	for i, system in ipairs(systems) do
+		if i > systemCount then break end
+
 		for k, v in pairs(Project._componentState) do
 			if system.state[k] == nil then
 				system.state[k] = util.deepcopy(v)
@@ -197,8 +203,12 @@ function Project.save(path, pretty, immediate)
 	end)
 end
 
+function Project.getSystemCount()
+	return _ctx:getSystemCount()
+end
+
 function Project.duplicateSystem(idx)
-	assert(#_data.systems < const.MAX_SYSTEMS)
+	assert(#_data.systems < _ctx:getSystemCount())
 	local system = _data.systems[idx]
 	local newSystem = system:clone()
 	local newIdx = #_data.systems
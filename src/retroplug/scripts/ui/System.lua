@@ -221,6 +221,18 @@ function System:reset(model)
 	_ctx:resetSystem(self._desc.idx, model)
 end
 
+function System:rewind(seconds)
+	_ctx:rewind(self._desc.idx, seconds)
+end
+
+function System:scrub(position)
+	_ctx:scrub(self._desc.idx, position)
+end
+
+function System:rewindLength()
+	return _ctx:getRewindStats(self._desc.idx).storedSeconds
+end
+
 function System:updateSettings()
 	_ctx:updateSystemSettings(self._desc.idx)
 end
@@ -6,6 +6,7 @@ local createNativeMenu = require("MenuHelper")
 local dialog = require("dialog")
 local fs = require("fs")
 local ConfigLoader = require("ConfigLoader")
+local const = require("const")
 local class = require("class")
 local InputConfig = require("InputConfigParser")
 local Globals = require("Globals")
@@ -57,10 +58,29 @@ function View:initProject()
 
 	Globals.inputConfigs = self._inputConfig.configs
 
+	self:updateProcessingSettings()
+
 	self.model = Model()
 	self.model:setup()
 end
 
+function View:updateProcessingSettings()
+	local audio = self._config.audio or {}
+	local settings = ProcessingSettings.new()
+	settings.workerThreads = audio.workerThreads or 0
+	settings.lookaheadBlocks = audio.lookaheadBlocks or 0
+	settings.rewindSeconds = audio.rewindSeconds or 0
+	settings.rewindMemoryMb = audio.rewindMemoryMb or 64
+	settings.sramAutosaveSeconds = audio.sramAutosaveSeconds or 0
+	settings.indexedVideo = audio.indexedVideo or false
+	settings.systemCount = audio.systemCount or const.DEFAULT_SYSTEM_COUNT
+	settings.bootStates = audio.bootStates ~= "off"
+	settings.bootStatesOnDisk = audio.bootStates == "disk"
+	settings.timingOverlay = audio.timingOverlay or false
+
+	Globals.audioContext:setProcessingSettings(settings)
+end
+
 local function keyToString(key)
 	for k, v in pairs(Key) do
 		if v == key then
@@ -94,12 +114,6 @@ function View:onMouseDown(x, y, mod)
 
 	if mod.right == true then
 		local selectedIdx = Project.getSelectedIndex()
-		if selectedIdx > 0 then
-			local selected = Project.getSelected()
-			if selected.desc.state ~= SystemState.RomMissing then
-				Globals.audioContext:updateSram(selectedIdx - 1)
-			end
-		end
 
 		local menu = Menu()
 		mainMenu.generateMenu(menu)
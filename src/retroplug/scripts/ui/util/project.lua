@@ -171,9 +171,22 @@ local function loadSystemResources(projectData, inst, idx, zip)
 	if zip ~= nil then
 		t.rom = zip:read(idxStr .. ".gb")
 		t.state = zip:read(idxStr .. ".state")
+		t.stateKey = zip:read(idxStr .. ".key")
 		t.sram = zip:read(idxStr .. ".sav")
 	end
 
+	if t.stateKey ~= nil and isNullPtr(t.stateKey) then t.stateKey = nil end
+
+	if t.state ~= nil and not isNullPtr(t.state) and statecodec.isEncoded(t.state) then
+		t.state = statecodec.decode(t.state, t.stateKey)
+		if isNullPtr(t.state) then
+			t.state = nil
+			log.warn("Failed to decode save state")
+		end
+	else
+		t.stateKey = nil
+	end
+
 	if inst._stateData ~= nil then
 		if st == SaveStateType.Sram then
 			t.sram = inst._stateData
@@ -224,6 +237,7 @@ local function createProjectSystems(projectData, zip)
 			if res.state then
 				log.info("Loading from save state")
 				system.stateData = res.state
+				system.stateKeyData = res.stateKey
 			elseif res.sram then
 				log.info("Loading from SRAM (specified state")
 				system.sramData = res.sram
@@ -235,6 +249,7 @@ local function createProjectSystems(projectData, zip)
 			elseif res.state then
 				log.info("Loading from save state (specified SRAM)")
 				system.stateData = res.state
+				system.stateKeyData = res.stateKey
 			end
 		end
 
@@ -332,6 +347,11 @@ local function saveProject(path, projectData, systems, systemStates, zipSettings
 			if ok == false then return Error("Failed to add system state") end
 		end
 
+		if systemStates.stateKeys[i] ~= nil then
+			ok = zip:add(idx .. ".key", systemStates.stateKeys[i])
+			if ok == false then return Error("Failed to add system state keyframe") end
+		end
+
 		if includeRom == true and not isNullPtr(system.desc.romData) then
 			ok = zip:add(idx .. ".gb", system.desc.romData)
 			if ok == false then return Error("Failed to add system ROM") end
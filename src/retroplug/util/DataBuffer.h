@@ -12,6 +12,7 @@ private:
 	T* _dataPtr = nullptr;
 	size_t _reserved = 0;
 	size_t _size = 0;
+	size_t _capacity = 0;
 	bool _ownsData = false;
 
 public:
@@ -19,7 +20,7 @@ public:
 	DataBuffer(const DataBuffer& other) { *this = other; }
 	DataBuffer(DataBuffer&& other) { *this = std::move(other); }
 	DataBuffer(size_t size) { resize(size); }
-	DataBuffer(T* data, size_t size, bool ownsData = false) : _dataPtr(data), _reserved(size), _ownsData(ownsData) {}
+	DataBuffer(T* data, size_t size, bool ownsData = false) : _dataPtr(data), _reserved(size), _capacity(size), _ownsData(ownsData) {}
 	~DataBuffer() { destroy(); }
 
 	T get(size_t idx) { assert(idx < _reserved); return _dataPtr[idx]; }
@@ -64,18 +65,21 @@ public:
 		memset(_dataPtr, 0, _size * sizeof(T));
 	}
 
+	// Shrinking keeps the allocation, so a buffer can be resized back up to its capacity
+	// without allocating again.
 	void reserve(size_t size) {
-		assert(_reserved == 0 || _ownsData);
-		if (size > _reserved) {
+		assert(_capacity == 0 || _ownsData || size <= _capacity);
+		if (size > _capacity) {
 			T* data = new T[size];
 
 			if (_reserved > 0) {
-				memcpy(data, _dataPtr, size * sizeof(T));
+				memcpy(data, _dataPtr, _reserved * sizeof(T));
 				destroy();
 			}
 
 			_dataPtr = data;
 			_reserved = size;
+			_capacity = size;
 			_ownsData = true;
 		} else if (_dataPtr) {
 			_reserved = size;
@@ -92,10 +96,13 @@ public:
 			delete[] _dataPtr;
 			_dataPtr = nullptr;
 			_reserved = 0;
+			_capacity = 0;
 			_ownsData = false;
 		}
 	}
 
+	size_t capacity() const { return _capacity; }
+
 	size_t copyFrom(DataBuffer* other) {
 		size_t writeAmount = std::min(_reserved, other->size());
 		memcpy(_dataPtr, other->_dataPtr, writeAmount * sizeof(T));
@@ -133,11 +140,13 @@ public:
 		_ownsData = other._ownsData;
 		_reserved = other._reserved;
 		_size = other._size;
+		_capacity = other._capacity;
 		
 		other._dataPtr = nullptr;
 		other._ownsData = false;
 		other._reserved = 0;
 		other._size = 0;
+		other._capacity = 0;
 
 		return *this;
 	}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <assert.h>
+#include <stddef.h>
+
+// A fixed capacity queue of events that is kept sorted by sample offset.  T is expected to have
+// an int `offset` member.  Offsets are stored relative to a running base, so moving all events
+// back at the end of a block is a single subtraction rather than a pass over the queue.  Nothing
+// is allocated after construction - when the ring is full new events are dropped and counted.
+template <typename T, const size_t Capacity>
+class EventRing {
+private:
+	static_assert((Capacity & (Capacity - 1)) == 0, "EventRing capacity must be a power of 2");
+
+	static constexpr int MAX_BASE_OFFSET = 1 << 30;
+
+	T _items[Capacity];
+	size_t _head = 0;
+	size_t _count = 0;
+	int _base = 0;
+	size_t _overflowCount = 0;
+
+public:
+	bool push(T item) {
+		if (_count == Capacity) {
+			_overflowCount++;
+			return false;
+		}
+
+		item.offset += _base;
+
+		// Events almost always arrive in order, so this rarely moves anything
+		size_t pos = _count;
+		while (pos > 0 && at(pos - 1).offset > item.offset) {
+			at(pos) = at(pos - 1);
+			pos--;
+		}
+
+		at(pos) = item;
+		_count++;
+
+		return true;
+	}
+
+	T pop() {
+		assert(_count > 0);
+		T item = at(0);
+		item.offset -= _base;
+
+		_head = (_head + 1) & (Capacity - 1);
+		_count--;
+
+		return item;
+	}
+
+	int frontOffset() const { assert(_count > 0); return at(0).offset - _base; }
+
+	T back() const {
+		assert(_count > 0);
+		T item = at(_count - 1);
+		item.offset -= _base;
+		return item;
+	}
+
+	bool empty() const { return _count == 0; }
+
+	size_t size() const { return _count; }
+
+	size_t capacity() const { return Capacity; }
+
+	size_t overflowCount() const { return _overflowCount; }
+
+	void clear() {
+		_head = 0;
+		_count = 0;
+		_base = 0;
+	}
+
+	// Shifts the offsets of all queued events back by `frames`
+	void rebase(int frames) {
+		if (_count == 0) {
+			_base = 0;
+			return;
+		}
+
+		_base += frames;
+
+		if (_base > MAX_BASE_OFFSET) {
+			for (size_t i = 0; i < _count; ++i) {
+				at(i).offset -= _base;
+			}
+
+			_base = 0;
+		}
+	}
+
+private:
+	T& at(size_t idx) { return _items[(_head + idx) & (Capacity - 1)]; }
+
+	const T& at(size_t idx) const { return _items[(_head + idx) & (Capacity - 1)]; }
+};
@@ -0,0 +1,88 @@
+#include "PixelExpander.h"
+
+#include <algorithm>
+
+#include "platform/Cpu.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define RP_EXPANDER_X86
+#include <immintrin.h>
+#endif
+
+#if defined(RP_EXPANDER_X86) && (defined(__GNUC__) || defined(__clang__))
+#define RP_TARGET(x) __attribute__((target(x)))
+#else
+#define RP_TARGET(x)
+#endif
+
+using ExpandKernel = void(*)(const uint8_t*, const uint32_t*, uint32_t*, size_t);
+
+static void expandScalar(const uint8_t* indices, const uint32_t* palette, uint32_t* target, size_t count) {
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		target[i] = palette[indices[i]];
+		target[i + 1] = palette[indices[i + 1]];
+		target[i + 2] = palette[indices[i + 2]];
+		target[i + 3] = palette[indices[i + 3]];
+	}
+
+	for (; i < count; ++i) {
+		target[i] = palette[indices[i]];
+	}
+}
+
+#ifdef RP_EXPANDER_X86
+RP_TARGET("avx2")
+static void expandAvx2(const uint8_t* indices, const uint32_t* palette, uint32_t* target, size_t count) {
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		// 8 indices -> 8 x 32 bit offsets -> one gather from the palette
+		__m256i offsets = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(indices + i)));
+		__m256i colors = _mm256_i32gather_epi32((const int*)palette, offsets, 4);
+		_mm256_storeu_si256((__m256i*)(target + i), colors);
+	}
+
+	expandScalar(indices + i, palette, target + i, count - i);
+}
+#endif
+
+struct KernelDesc {
+	ExpandKernel func;
+	const char* name;
+};
+
+static KernelDesc selectKernel() {
+#ifdef RP_EXPANDER_X86
+	if (cpu::hasAvx2()) {
+		return { expandAvx2, "AVX2" };
+	}
+#endif
+
+	return { expandScalar, "Scalar" };
+}
+
+static const KernelDesc& getKernel() {
+	static KernelDesc kernel = selectKernel();
+	return kernel;
+}
+
+namespace PixelExpander {
+	void expand(const uint8_t* indices, const uint32_t* palette, uint32_t* target, size_t count) {
+		getKernel().func(indices, palette, target, count);
+	}
+
+	void expandFrame(const IndexedFrame* frame, uint32_t* target, size_t stride, size_t top, size_t bottom) {
+		ExpandKernel kernel = getKernel().func;
+		uint32_t lastPalette = std::max(frame->paletteCount, 1u) - 1;
+
+		bottom = std::min(bottom, INDEXED_FRAME_HEIGHT);
+		for (size_t y = top; y < bottom; ++y) {
+			uint32_t paletteIdx = std::min((uint32_t)frame->linePalettes[y], lastPalette);
+			kernel(frame->pixels + y * INDEXED_FRAME_WIDTH, frame->palettes[paletteIdx], target + y * stride, INDEXED_FRAME_WIDTH);
+		}
+	}
+
+	const char* getKernelName() {
+		return getKernel().name;
+	}
+}
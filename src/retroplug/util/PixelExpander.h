@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "util/VideoTripleBuffer.h"
+
+namespace PixelExpander {
+	// Looks up count palette indices and writes the colours to target.  The fastest kernel the
+	// CPU supports is chosen the first time this is called.
+	void expand(const uint8_t* indices, const uint32_t* palette, uint32_t* target, size_t count);
+
+	// Expands lines top to bottom (exclusive) of a frame, using each line's palette.  target is the
+	// first line of the output and stride is the distance between its lines in pixels.
+	void expandFrame(const IndexedFrame* frame, uint32_t* target, size_t stride, size_t top = 0, size_t bottom = INDEXED_FRAME_HEIGHT);
+
+	// Name of the kernel in use, for logging
+	const char* getKernelName();
+}
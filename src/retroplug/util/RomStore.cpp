@@ -0,0 +1,45 @@
+#include "RomStore.h"
+
+#include <algorithm>
+#include <mutex>
+#include <string.h>
+#include <unordered_map>
+#include <xxhash.h>
+
+SharedRom::SharedRom(const char* data, size_t size, size_t paddedSize, uint64_t hash)
+	: _data(paddedSize, 0xFF), _romSize(size), _hash(hash)
+{
+	memcpy(_data.data(), data, std::min(size, paddedSize));
+}
+
+namespace RomStore {
+	static std::mutex _mutex;
+	static std::unordered_multimap<uint64_t, std::weak_ptr<const SharedRom>> _roms;
+
+	SharedRomPtr acquire(const char* data, size_t size, size_t paddedSize) {
+		uint64_t hash = XXH3_64bits(data, size);
+
+		std::scoped_lock lock(_mutex);
+
+		auto range = _roms.equal_range(hash);
+		for (auto it = range.first; it != range.second;) {
+			SharedRomPtr rom = it->second.lock();
+			if (!rom) {
+				it = _roms.erase(it);
+				continue;
+			}
+
+			// Hashes are only used to find candidates, the contents decide
+			if (rom->romSize() == size && rom->size() == paddedSize && memcmp(rom->data(), data, size) == 0) {
+				return rom;
+			}
+
+			++it;
+		}
+
+		SharedRomPtr rom = std::make_shared<const SharedRom>(data, size, paddedSize, hash);
+		_roms.emplace(hash, rom);
+
+		return rom;
+	}
+}
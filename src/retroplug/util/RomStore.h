@@ -0,0 +1,36 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+// A ROM image, padded to the size the core maps, that every system running it reads from
+class SharedRom {
+private:
+	std::vector<uint8_t> _data;
+	size_t _romSize;
+	uint64_t _hash;
+
+public:
+	SharedRom(const char* data, size_t size, size_t paddedSize, uint64_t hash);
+
+	const uint8_t* data() const { return _data.data(); }
+
+	// The padded size
+	size_t size() const { return _data.size(); }
+
+	// The size of the ROM before padding
+	size_t romSize() const { return _romSize; }
+
+	uint64_t hash() const { return _hash; }
+};
+
+using SharedRomPtr = std::shared_ptr<const SharedRom>;
+
+namespace RomStore {
+	// Returns the stored image with the same contents, adding one if there isn't one.  The store
+	// is shared by every plugin instance in the process, and an image is freed once the last
+	// system using it lets go.  Thread safe.
+	SharedRomPtr acquire(const char* data, size_t size, size_t paddedSize);
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+
+enum class VideoFormat {
+	// 32 bit RGBA pixels
+	Rgba,
+
+	// An IndexedFrame: 8 bit palette indices plus the palettes they refer to
+	Indexed
+};
+
+const size_t INDEXED_FRAME_WIDTH = 160;
+const size_t INDEXED_FRAME_HEIGHT = 144;
+
+// Background and object palettes followed by black and white, matching the indices SameBoy
+// renders in indexed mode
+const size_t INDEXED_PALETTE_SIZE = 0x42;
+
+// Frame layout for VideoFormat::Indexed.  Each line refers to one of the palettes.  A palette is
+// only added when the colours change between lines, so most frames carry just one.
+struct IndexedFrame {
+	uint8_t pixels[INDEXED_FRAME_WIDTH * INDEXED_FRAME_HEIGHT];
+	uint8_t linePalettes[INDEXED_FRAME_HEIGHT];
+	uint32_t paletteCount;
+	uint32_t palettes[INDEXED_FRAME_HEIGHT][INDEXED_PALETTE_SIZE];
+};
+
+// A range of lines that differ from the previous frame.  bottom is exclusive.
+struct DirtyRows {
+	uint32_t top = 0;
+	uint32_t bottom = 0;
+
+	bool empty() const { return top >= bottom; }
+
+	DirtyRows merge(DirtyRows other) const {
+		if (empty()) return other;
+		if (other.empty()) return *this;
+		return DirtyRows { top < other.top ? top : other.top, bottom > other.bottom ? bottom : other.bottom };
+	}
+};
+
+// Hands finished video frames from the emulator to the UI without locks or copies.  The emulator
+// renders straight in to the back buffer and publishes it at vblank, which swaps it with the
+// middle buffer.  The UI swaps its front buffer with the middle buffer when a new frame has been
+// published.  Neither side ever waits, and a buffer is never written while the UI is reading it.
+// There must be at most one writer and one reader at a time.
+class VideoTripleBuffer {
+private:
+	static constexpr uint8_t INDEX_MASK = 0x3;
+	static constexpr uint8_t FRESH_BIT = 0x4;
+
+	// Frames are padded to a cache line so the writer and reader never share one
+	static constexpr size_t FRAME_ALIGNMENT = 64;
+
+	VideoFormat _format;
+	size_t _frameSize;
+	size_t _stride;
+	std::unique_ptr<uint8_t[]> _data;
+
+	uint8_t _back = 0;
+	std::atomic<uint8_t> _middle = { 1 };
+	uint8_t _front = 2;
+	bool _frontValid = false;
+
+	DirtyRows _rows[3];
+	DirtyRows _lastPublished;
+
+	std::atomic<uint32_t> _frameCount = { 0 };
+
+public:
+	VideoTripleBuffer(VideoFormat format, size_t frameSize)
+		: _format(format),
+		_frameSize(frameSize),
+		_stride((frameSize + FRAME_ALIGNMENT - 1) & ~(FRAME_ALIGNMENT - 1)),
+		_data(std::make_unique<uint8_t[]>(_stride * 3)) {}
+
+	VideoFormat format() const { return _format; }
+
+	size_t frameSize() const { return _frameSize; }
+
+	// Writer side.  The buffer the emulator should be rendering in to.
+	uint8_t* getBackBuffer() { return _data.get() + _back * _stride; }
+
+	// Writer side.  Counts a frame the emulator finished, whether or not it gets published, so the
+	// reader can tell a static screen from a stalled one.
+	void countFrame() { _frameCount.fetch_add(1, std::memory_order_relaxed); }
+
+	// Writer side.  Makes the back buffer the latest frame and returns the buffer to render the
+	// next frame in to.  rows are the lines that changed since the previously published frame.
+	// A published frame the reader hasn't picked up yet is recycled, and its rows are carried over
+	// so the reader still sees every line that changed since its last acquire().
+	uint8_t* publish(DirtyRows rows) {
+		// If the reader takes the frame after this check the rows are only over reported
+		if (_middle.load(std::memory_order_relaxed) & FRESH_BIT) {
+			rows = rows.merge(_lastPublished);
+		}
+
+		_rows[_back] = rows;
+		_lastPublished = rows;
+
+		uint8_t prev = _middle.exchange(_back | FRESH_BIT, std::memory_order_acq_rel);
+		_back = prev & INDEX_MASK;
+		return getBackBuffer();
+	}
+
+	// Reader side.  Moves the latest published frame to the front, returning false if nothing
+	// has been published since the last call.
+	bool acquire() {
+		if (!(_middle.load(std::memory_order_relaxed) & FRESH_BIT)) {
+			return false;
+		}
+
+		uint8_t prev = _middle.exchange(_front, std::memory_order_acq_rel);
+		_front = prev & INDEX_MASK;
+		_frontValid = true;
+		return true;
+	}
+
+	// Reader side.  The frame returned by the last successful acquire().  Always a complete frame.
+	const uint8_t* getFrontBuffer() const { return _data.get() + _front * _stride; }
+
+	// Reader side.  The lines of the front buffer that changed since the previous acquire().
+	DirtyRows getFrontRows() const { return _rows[_front]; }
+
+	// Reader side.  False until the first frame has been acquired.
+	bool hasFrontBuffer() const { return _frontValid; }
+
+	// Reader side.  Increases with every frame the emulator finishes, including unchanged ones.
+	uint32_t getFrameCount() const { return _frameCount.load(std::memory_order_relaxed); }
+};
+
+using VideoTripleBufferPtr = std::shared_ptr<VideoTripleBuffer>;
@@ -286,6 +286,9 @@ static void render(GB_gameboy_t *gb)
     }
     assert(gb->apu_output.sample_callback);
     gb->apu_output.sample_callback(gb, &filtered_output);
+    if (gb->run_samples_remaining && --gb->run_samples_remaining == 0) {
+        gb->run_stop_requested = true;
+    }
     if (unlikely(gb->apu_output.output_file)) {
 #ifdef GB_BIG_ENDIAN
         if (gb->apu_output.output_format == GB_AUDIO_FORMAT_WAV) {
@@ -2489,6 +2489,13 @@ next_command:
     }
 }
 
+bool GB_debugger_is_idle(GB_gameboy_t *gb)
+{
+    if (gb->debug_disable) return true;
+    return gb->undo_state && !gb->debug_stopped && !gb->breakpoints &&
+           !gb->debug_next_command && !gb->debug_fin_command;
+}
+
 void GB_debugger_handle_async_commands(GB_gameboy_t *gb)
 {
     char *input = NULL;
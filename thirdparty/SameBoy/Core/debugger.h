@@ -9,6 +9,7 @@
 #ifdef GB_INTERNAL
 #ifdef GB_DISABLE_DEBUGGER
 #define GB_debugger_run(gb) (void)0
+#define GB_debugger_is_idle(gb) true
 #define GB_debugger_handle_async_commands(gb) (void)0
 #define GB_debugger_ret_hook(gb) (void)0
 #define GB_debugger_call_hook(gb, addr) (void)addr
@@ -18,6 +19,8 @@
 
 #else
 internal void GB_debugger_run(GB_gameboy_t *gb);
+/* True if GB_debugger_run would currently do nothing, so it can be skipped between instructions */
+internal bool GB_debugger_is_idle(GB_gameboy_t *gb);
 internal void GB_debugger_handle_async_commands(GB_gameboy_t *gb);
 internal void GB_debugger_call_hook(GB_gameboy_t *gb, uint16_t call_addr);
 internal void GB_debugger_ret_hook(GB_gameboy_t *gb);
@@ -138,7 +138,10 @@ void GB_display_vblank(GB_gameboy_t *gb, GB_vblank_type_t type)
     
     if (!gb->disable_rendering && ((!(gb->io_registers[GB_IO_LCDC] & GB_LCDC_ENABLE) || is_ppu_stopped) || gb->frame_skip_state == GB_FRAMESKIP_LCD_TURNED_ON)) {
         /* LCD is off, set screen to white or black (if LCD is on in stop mode) */
-        if (!GB_is_sgb(gb)) {
+        if (gb->indexed_screen) {
+            memset(gb->indexed_screen, GB_is_cgb(gb)? GB_INDEXED_WHITE : (is_ppu_stopped? 0 : 4), WIDTH * LINES);
+        }
+        else if (!GB_is_sgb(gb)) {
             uint32_t color = 0;
             if (GB_is_cgb(gb)) {
                 color = GB_convert_rgb15(gb, 0x7FFF, false);
@@ -163,7 +166,7 @@ void GB_display_vblank(GB_gameboy_t *gb, GB_vblank_type_t type)
         }
     }
     
-    if (!gb->disable_rendering && gb->border_mode == GB_BORDER_ALWAYS && !GB_is_sgb(gb)) {
+    if (!gb->disable_rendering && gb->border_mode == GB_BORDER_ALWAYS && !GB_is_sgb(gb) && !gb->indexed_screen) {
         GB_borrow_sgb_border(gb);
         uint32_t border_colors[16 * 4];
         
@@ -658,7 +661,14 @@ static void render_pixel_if_possible(GB_gameboy_t *gb)
 
     uint8_t icd_pixel = 0;
     uint32_t *dest = NULL;
-    if (!gb->sgb) {
+    uint8_t *indexed_dest = NULL;
+    if (gb->indexed_screen) {
+        indexed_dest = gb->indexed_screen + gb->lcd_x + gb->current_line * WIDTH;
+        if (gb->lcd_x == 0 && gb->indexed_line_callback) {
+            gb->indexed_line_callback(gb, gb->current_line);
+        }
+    }
+    else if (!gb->sgb) {
         if (gb->border_mode != GB_BORDER_ALWAYS) {
             dest = gb->screen + gb->lcd_x + gb->current_line * WIDTH;
         }
@@ -685,6 +695,9 @@ static void render_pixel_if_possible(GB_gameboy_t *gb)
                 icd_pixel = pixel;
             }
         }
+        else if (indexed_dest) {
+            *indexed_dest = gb->cgb_palettes_ppu_blocked? GB_INDEXED_BLACK : fifo_item->palette * 4 + pixel;
+        }
         else if (gb->cgb_palettes_ppu_blocked) {
             *dest = gb->rgb_encode_callback(gb, 0, 0, 0);
         }
@@ -709,6 +722,9 @@ static void render_pixel_if_possible(GB_gameboy_t *gb)
                 icd_pixel = pixel;
             }
         }
+        else if (indexed_dest) {
+            *indexed_dest = gb->cgb_palettes_ppu_blocked? GB_INDEXED_BLACK : GB_INDEXED_OBJECT_BASE + oam_fifo_item->palette * 4 + pixel;
+        }
         else if (gb->cgb_palettes_ppu_blocked) {
             *dest = gb->rgb_encode_callback(gb, 0, 0, 0);
         }
@@ -1045,7 +1061,7 @@ static inline void get_tile_data(const GB_gameboy_t *gb, uint8_t tile_x, uint8_t
 static void render_line(GB_gameboy_t *gb)
 {
     if (gb->disable_rendering) return;
-    if (!gb->screen) return;
+    if (!gb->screen && !gb->indexed_screen) return;
     if (gb->current_line > 144) return; // Corrupt save state
     
     struct {
@@ -1109,8 +1125,15 @@ static void render_line(GB_gameboy_t *gb)
     
     
     uint32_t *restrict p = gb->screen;
+    uint8_t *restrict indexed_p = NULL;
     typeof(object_buffer[0]) *object_buffer_pointer = object_buffer + 8;
-    if (gb->border_mode == GB_BORDER_ALWAYS) {
+    if (gb->indexed_screen) {
+        indexed_p = gb->indexed_screen + WIDTH * gb->current_line;
+        if (gb->indexed_line_callback) {
+            gb->indexed_line_callback(gb, gb->current_line);
+        }
+    }
+    else if (gb->border_mode == GB_BORDER_ALWAYS) {
         p += (BORDERED_WIDTH - (WIDTH)) / 2 + BORDERED_WIDTH * (BORDERED_HEIGHT - LINES) / 2;
         p += BORDERED_WIDTH * gb->current_line;
     }
@@ -1119,14 +1142,23 @@ static void render_line(GB_gameboy_t *gb)
     }
     
     if (unlikely(gb->background_disabled) || (!gb->cgb_mode && !(gb->io_registers[GB_IO_LCDC] & GB_LCDC_BG_EN))) {
-        uint32_t bg = gb->background_palettes_rgb[gb->cgb_mode? 0 : (gb->io_registers[GB_IO_BGP] & 3)];
+        uint8_t bg_index = gb->cgb_mode? 0 : (gb->io_registers[GB_IO_BGP] & 3);
+        uint32_t bg = gb->background_palettes_rgb[bg_index];
         for (unsigned i = 160; i--;) {
             if (unlikely(object_buffer_pointer->pixel)) {
                 uint8_t pixel = object_buffer_pointer->pixel;
                 if (!gb->cgb_mode) {
                     pixel = ((gb->io_registers[GB_IO_OBP0 + object_buffer_pointer->palette] >> (pixel << 1)) & 3);
                 }
-                *(p++) = gb->object_palettes_rgb[pixel + (object_buffer_pointer->palette & 7) * 4];
+                if (indexed_p) {
+                    *(indexed_p++) = GB_INDEXED_OBJECT_BASE + pixel + (object_buffer_pointer->palette & 7) * 4;
+                }
+                else {
+                    *(p++) = gb->object_palettes_rgb[pixel + (object_buffer_pointer->palette & 7) * 4];
+                }
+            }
+            else if (indexed_p) {
+                *(indexed_p++) = bg_index;
             }
             else {
                 *(p++) = bg;
@@ -1158,13 +1190,23 @@ if (unlikely(object_buffer_pointer->pixel) && (pixel == 0 || !(object_buffer_poi
     if (!gb->cgb_mode) {\
         pixel = ((gb->io_registers[GB_IO_OBP0 + object_buffer_pointer->palette] >> (pixel << 1)) & 3);\
     }\
-    *(p++) = gb->object_palettes_rgb[pixel + (object_buffer_pointer->palette & 7) * 4];\
+    if (indexed_p) {\
+        *(indexed_p++) = GB_INDEXED_OBJECT_BASE + pixel + (object_buffer_pointer->palette & 7) * 4;\
+    }\
+    else {\
+        *(p++) = gb->object_palettes_rgb[pixel + (object_buffer_pointer->palette & 7) * 4];\
+    }\
 }\
 else {\
     if (!gb->cgb_mode) {\
         pixel = ((gb->io_registers[GB_IO_BGP] >> (pixel << 1)) & 3);\
     }\
-    *(p++) = gb->background_palettes_rgb[pixel + (attributes & 7) * 4];\
+    if (indexed_p) {\
+        *(indexed_p++) = pixel + (attributes & 7) * 4;\
+    }\
+    else {\
+        *(p++) = gb->background_palettes_rgb[pixel + (attributes & 7) * 4];\
+    }\
 }\
 pixels++;\
 object_buffer_pointer++\
@@ -1548,6 +1590,13 @@ void GB_display_run(GB_gameboy_t *gb, unsigned cycles, bool force)
         // TODO: Timing of things in this scenario is almost completely untested
         if (gb->current_line < LINES && !GB_is_sgb(gb) && !gb->disable_rendering) {
             GB_log(gb, "The ROM is preventing line %d from fully rendering, this could damage a real device's LCD display.\n", gb->current_line);
+            if (gb->indexed_screen) {
+                uint8_t index = GB_is_cgb(gb)? GB_INDEXED_WHITE : 4;
+                while (gb->lcd_x < 160) {
+                    gb->indexed_screen[gb->lcd_x + gb->current_line * WIDTH] = index;
+                    gb->lcd_x++;
+                }
+            }
             uint32_t *dest = NULL;
             if (gb->border_mode != GB_BORDER_ALWAYS) {
                 dest = gb->screen + gb->lcd_x + gb->current_line * WIDTH;
@@ -1875,6 +1924,11 @@ skip_slow_mode_3:
                 gb->data_for_sel_glitch = gb->current_tile_data[1];
             }
             */
+            while (gb->lcd_x != 160 && !gb->disable_rendering && gb->indexed_screen && !gb->sgb) {
+                uint8_t *dest = gb->indexed_screen + gb->lcd_x + gb->current_line * WIDTH;
+                *dest = (gb->lcd_x == 0)? 0 : dest[-1];
+                gb->lcd_x++;
+            }
             while (gb->lcd_x != 160 && !gb->disable_rendering && gb->screen && !gb->sgb) {
                 /* Oh no! The PPU and LCD desynced! Fill the rest of the line with the last color. */
                 uint32_t *dest = NULL;
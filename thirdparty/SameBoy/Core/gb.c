@@ -3,6 +3,7 @@
 #include <stdlib.h>
 #include <stddef.h>
 #include <string.h>
+#include <limits.h>
 #include <errno.h>
 #include <stdarg.h>
 #ifndef _WIN32
@@ -21,6 +22,10 @@
 
 void GB_attributed_logv(GB_gameboy_t *gb, GB_log_attributes attributes, const char *fmt, va_list args)
 {
+    if (gb->log_disabled) {
+        return;
+    }
+    
     char *string = NULL;
     vasprintf(&string, fmt, args);
     if (string) {
@@ -158,6 +163,15 @@ GB_gameboy_t *GB_alloc(void)
     return ret;
 }
 
+static void free_rom(GB_gameboy_t *gb)
+{
+    if (gb->rom && !gb->rom_is_shared) {
+        free(gb->rom);
+    }
+    gb->rom = NULL;
+    gb->rom_is_shared = false;
+}
+
 GB_gameboy_t *GB_init(GB_gameboy_t *gb, GB_model_t model)
 {
     memset(gb, 0, sizeof(*gb));
@@ -205,9 +219,7 @@ void GB_free(GB_gameboy_t *gb)
     if (gb->mbc_ram) {
         free(gb->mbc_ram);
     }
-    if (gb->rom) {
-        free(gb->rom);
-    }
+    free_rom(gb);
     if (gb->breakpoints) {
         free(gb->breakpoints);
     }
@@ -321,9 +333,7 @@ int GB_load_rom(GB_gameboy_t *gb, const char *path)
         gb->rom_size = 0x8000;
     }
     fseek(f, 0, SEEK_SET);
-    if (gb->rom) {
-        free(gb->rom);
-    }
+    free_rom(gb);
     gb->rom = malloc(gb->rom_size);
     memset(gb->rom, 0xFF, gb->rom_size); /* Pad with 0xFFs */
     fread(gb->rom, 1, gb->rom_size, f);
@@ -433,9 +443,7 @@ int GB_load_gbs_from_buffer(GB_gameboy_t *gb, const uint8_t *buffer, size_t size
         gb->rom_size = 0x8000;
     }
 
-    if (gb->rom) {
-        free(gb->rom);
-    }
+    free_rom(gb);
 
     gb->rom = malloc(gb->rom_size);
     memset(gb->rom, 0xFF, gb->rom_size); /* Pad with 0xFFs */
@@ -526,8 +534,10 @@ int GB_load_isx(GB_gameboy_t *gb, const char *path)
     
     uint8_t *old_rom = gb->rom;
     uint32_t old_size = gb->rom_size;
+    bool old_shared = gb->rom_is_shared;
     gb->rom = NULL;
     gb->rom_size = 0;
+    gb->rom_is_shared = false;
     
     while (true) {
         uint8_t record_type = 0;
@@ -704,7 +714,7 @@ done:;
         }
     }
     
-    if (old_rom) {
+    if (old_rom && !old_shared) {
         free(old_rom);
     }
     
@@ -715,6 +725,7 @@ error:
         free(gb->rom);
         gb->rom = old_rom;
         gb->rom_size = old_size;
+        gb->rom_is_shared = old_shared;
     }
     fclose(f);
     gb->tried_loading_sgb_border = false;
@@ -723,19 +734,23 @@ error:
     return -1;
 }
 
-void GB_load_rom_from_buffer(GB_gameboy_t *gb, const uint8_t *buffer, size_t size)
+size_t GB_get_padded_rom_size(size_t size)
 {
-    gb->rom_size = (size + 0x3FFF) & ~0x3FFF;
-    while (gb->rom_size & (gb->rom_size - 1)) {
-        gb->rom_size |= gb->rom_size >> 1;
-        gb->rom_size++;
+    size_t padded = (size + 0x3FFF) & ~0x3FFF;
+    while (padded & (padded - 1)) {
+        padded |= padded >> 1;
+        padded++;
     }
-    if (gb->rom_size == 0) {
-        gb->rom_size = 0x8000;
-    }
-    if (gb->rom) {
-        free(gb->rom);
+    if (padded == 0) {
+        padded = 0x8000;
     }
+    return padded;
+}
+
+void GB_load_rom_from_buffer(GB_gameboy_t *gb, const uint8_t *buffer, size_t size)
+{
+    gb->rom_size = GB_get_padded_rom_size(size);
+    free_rom(gb);
     gb->rom = malloc(gb->rom_size);
     memset(gb->rom, 0xFF, gb->rom_size);
     memcpy(gb->rom, buffer, size);
@@ -745,6 +760,43 @@ void GB_load_rom_from_buffer(GB_gameboy_t *gb, const uint8_t *buffer, size_t siz
     load_default_border(gb);
 }
 
+bool GB_load_rom_shared(GB_gameboy_t *gb, const uint8_t *buffer, size_t size)
+{
+    if (size == 0 || GB_get_padded_rom_size(size) != size) {
+        return false;
+    }
+    free_rom(gb);
+    gb->rom = (uint8_t *)buffer;
+    gb->rom_size = size;
+    gb->rom_is_shared = true;
+    GB_configure_cart(gb);
+    gb->tried_loading_sgb_border = false;
+    gb->has_sgb_border = false;
+    load_default_border(gb);
+    return true;
+}
+
+bool GB_replace_rom_shared(GB_gameboy_t *gb, const uint8_t *buffer, size_t size)
+{
+    if (size != gb->rom_size) {
+        return false;
+    }
+    free_rom(gb);
+    gb->rom = (uint8_t *)buffer;
+    gb->rom_size = size;
+    gb->rom_is_shared = true;
+    return true;
+}
+
+void GB_unshare_rom(GB_gameboy_t *gb)
+{
+    if (!gb->rom_is_shared) return;
+    uint8_t *rom = malloc(gb->rom_size);
+    memcpy(rom, gb->rom, gb->rom_size);
+    gb->rom = rom;
+    gb->rom_is_shared = false;
+}
+
 typedef struct {
     uint8_t seconds;
     uint8_t padding1[3];
@@ -1179,6 +1231,48 @@ unsigned GB_run(GB_gameboy_t *gb)
     return gb->cycles_since_run;
 }
 
+uint64_t GB_run_until(GB_gameboy_t *gb, uint64_t cycles, unsigned samples)
+{
+    uint64_t total = 0;
+    gb->run_stop_requested = false;
+    gb->run_samples_remaining = samples;
+
+    while (!gb->run_stop_requested) {
+#ifdef GB_FAST_INTERPRETER
+        if (!gb->fast_interpreter_disabled && !(gb->sgb && gb->sgb->intro_animation < 96) && GB_debugger_is_idle(gb)) {
+            /* Same as GB_run, minus the per-instruction debugger checks it has just ruled out */
+            gb->vblank_just_occured = false;
+            gb->cycles_since_run = 0;
+            GB_cpu_run_fast(gb, cycles ? (unsigned)MIN(cycles - total, UINT_MAX) : UINT_MAX);
+            if (gb->cycles_since_run) {
+                if (gb->vblank_just_occured) {
+                    GB_debugger_handle_async_commands(gb);
+                    GB_rewind_push(gb);
+                }
+                total += gb->cycles_since_run;
+                if (cycles && total >= cycles) break;
+                continue;
+            }
+        }
+#endif
+        total += GB_run(gb);
+        if (cycles && total >= cycles) break;
+    }
+
+    gb->run_samples_remaining = 0;
+    return total;
+}
+
+void GB_request_run_stop(GB_gameboy_t *gb)
+{
+    gb->run_stop_requested = true;
+}
+
+void GB_set_fast_interpreter_enabled(GB_gameboy_t *gb, bool enabled)
+{
+    gb->fast_interpreter_disabled = !enabled;
+}
+
 uint64_t GB_run_frame(GB_gameboy_t *gb)
 {
     /* Configure turbo temporarily, the user wants to handle FPS capping manually. */
@@ -1209,6 +1303,20 @@ uint32_t *GB_get_pixels_output(GB_gameboy_t *gb)
     return gb->screen;
 }
 
+void GB_set_pixels_output_indexed(GB_gameboy_t *gb, uint8_t *output, GB_lcd_line_callback_t line_callback)
+{
+    gb->indexed_screen = output;
+    gb->indexed_line_callback = output? line_callback : NULL;
+}
+
+void GB_get_indexed_palette(GB_gameboy_t *gb, uint32_t *palette)
+{
+    memcpy(palette, gb->background_palettes_rgb, sizeof(gb->background_palettes_rgb));
+    memcpy(palette + GB_INDEXED_OBJECT_BASE, gb->object_palettes_rgb, sizeof(gb->object_palettes_rgb));
+    palette[GB_INDEXED_BLACK] = gb->rgb_encode_callback? gb->rgb_encode_callback(gb, 0, 0, 0) : 0;
+    palette[GB_INDEXED_WHITE] = GB_convert_rgb15(gb, 0x7FFF, false);
+}
+
 void GB_set_vblank_callback(GB_gameboy_t *gb, GB_vblank_callback_t callback)
 {
     gb->vblank_callback = callback;
@@ -1219,6 +1327,11 @@ void GB_set_log_callback(GB_gameboy_t *gb, GB_log_callback_t callback)
     gb->log_callback = callback;
 }
 
+void GB_set_log_disabled(GB_gameboy_t *gb, bool disabled)
+{
+    gb->log_disabled = disabled;
+}
+
 void GB_set_input_callback(GB_gameboy_t *gb, GB_input_callback_t callback)
 {
 #ifndef GB_DISABLE_DEBUGGER
@@ -1396,12 +1509,23 @@ bool GB_is_hle_sgb(GB_gameboy_t *gb)
     return (gb->model & ~GB_MODEL_PAL_BIT) == GB_MODEL_SGB || gb->model == GB_MODEL_SGB2;
 }
 
+bool GB_is_boot_rom_finished(GB_gameboy_t *gb)
+{
+    return gb->boot_rom_finished;
+}
+
 void GB_set_turbo_mode(GB_gameboy_t *gb, bool on, bool no_frame_skip)
 {
     gb->turbo = on;
     gb->turbo_dont_skip = no_frame_skip;
 }
 
+void GB_set_mbc_ram_dirty_bitmap(GB_gameboy_t *gb, uint64_t *bitmap, size_t word_count)
+{
+    gb->mbc_ram_dirty = bitmap;
+    gb->mbc_ram_dirty_words = bitmap? word_count : 0;
+}
+
 void GB_set_rendering_disabled(GB_gameboy_t *gb, bool disabled)
 {
     gb->disable_rendering = disabled;
@@ -677,6 +677,7 @@ struct GB_gameboy_internal_s {
         /* ROM */
         uint8_t *rom;
         uint32_t rom_size;
+        bool rom_is_shared;
         const GB_cartridge_t *cartridge_type;
         enum {
             GB_STANDARD_MBC1_WIRING,
@@ -690,9 +691,12 @@ struct GB_gameboy_internal_s {
         uint8_t *ram;
         uint8_t *vram;
         uint8_t *mbc_ram;
+        uint64_t *mbc_ram_dirty;
+        size_t mbc_ram_dirty_words;
 
         /* I/O */
         uint32_t *screen;
+        uint8_t *indexed_screen;
         uint32_t background_palettes_rgb[0x20];
         uint32_t object_palettes_rgb[0x20];
         const GB_palette_t *dmg_palette;
@@ -725,6 +729,7 @@ struct GB_gameboy_internal_s {
         /* Callbacks */
         void *user_data;
         GB_log_callback_t log_callback;
+        bool log_disabled;
         GB_input_callback_t input_callback;
         GB_input_callback_t async_input_callback;
         GB_rgb_encode_callback_t rgb_encode_callback;
@@ -748,6 +753,7 @@ struct GB_gameboy_internal_s {
         GB_workboy_get_time_callback workboy_get_time_callback;
         GB_execution_callback_t execution_callback;
         GB_lcd_line_callback_t lcd_line_callback;
+        GB_lcd_line_callback_t indexed_line_callback;
         GB_lcd_status_callback_t lcd_status_callback;
         /*** Debugger ***/
         volatile bool debug_stopped, debug_disable;
@@ -819,6 +825,9 @@ struct GB_gameboy_internal_s {
         uint8_t boot_rom[0x900];
         bool vblank_just_occured; // For slow operations involving syscalls; these should only run once per vblank
         unsigned cycles_since_run; // How many cycles have passed since the last call to GB_run(), in 8MHz units
+        bool run_stop_requested; // Makes GB_run_until return after the current instruction
+        unsigned run_samples_remaining; // Samples left before GB_run_until returns, 0 if unlimited
+        bool fast_interpreter_disabled; // Keeps GB_run_until on the one instruction per GB_run path
         double clock_multiplier;
         GB_rumble_mode_t rumble_mode;
         uint32_t rumble_on_cycles;
@@ -879,6 +888,7 @@ bool GB_is_cgb(const GB_gameboy_t *gb);
 bool GB_is_cgb_in_cgb_mode(GB_gameboy_t *gb);
 bool GB_is_sgb(GB_gameboy_t *gb); // Returns true if the model is SGB or SGB2
 bool GB_is_hle_sgb(GB_gameboy_t *gb); // Returns true if the model is SGB or SGB2 and the SFC/SNES side is HLE'd
+bool GB_is_boot_rom_finished(GB_gameboy_t *gb); // Returns true once the boot ROM has handed over to the cartridge
 GB_model_t GB_get_model(GB_gameboy_t *gb);
 void GB_reset(GB_gameboy_t *gb);
 void GB_quick_reset(GB_gameboy_t *gb); // Similar to the cart reset line
@@ -888,6 +898,19 @@ void GB_switch_model_and_reset(GB_gameboy_t *gb, GB_model_t model);
 unsigned GB_run(GB_gameboy_t *gb);
 /* Returns the time passed since the last frame, in nanoseconds */
 uint64_t GB_run_frame(GB_gameboy_t *gb);
+/* Runs until at least `cycles` 8MHz ticks have passed, `samples` audio samples have been output
+   or GB_request_run_stop is called from a callback, whichever comes first.  A limit of 0 is
+   ignored.  Returns the time passed, in 8MHz ticks. */
+uint64_t GB_run_until(GB_gameboy_t *gb, uint64_t cycles, unsigned samples);
+/* Makes the current GB_run_until call return once the current instruction has finished */
+void GB_request_run_stop(GB_gameboy_t *gb);
+/* Returns the 8MHz ticks until this instance, clocking a serial transfer itself, next shifts a
+   bit out and in.  Returns UINT64_MAX if it isn't clocking a transfer. */
+uint64_t GB_get_ticks_until_serial_bit(GB_gameboy_t *gb);
+/* When built with GB_FAST_INTERPRETER, GB_run_until runs many instructions per dispatch loop
+   whenever nothing needs per-instruction handling.  Emulation is the same either way; this is
+   on by default, and can be turned off to compare against the regular interpreter. */
+void GB_set_fast_interpreter_enabled(GB_gameboy_t *gb, bool enabled);
 
 typedef enum {
     GB_DIRECT_ACCESS_ROM,
@@ -907,6 +930,11 @@ typedef enum {
 /* Returns a mutable pointer to various hardware memories. If that memory is banked, the current bank
    is returned at *bank, even if only a portion of the memory is banked. */
 void *GB_get_direct_access(GB_gameboy_t *gb, GB_direct_access_t access, size_t *size, uint16_t *bank);
+
+#define GB_MBC_RAM_PAGE_SHIFT 8
+/* Sets a bit in bitmap for every (1 << GB_MBC_RAM_PAGE_SHIFT) byte page of cart RAM the emulated game
+   writes to. The bitmap is owned by the caller and is never cleared by the core. Pass NULL to disable. */
+void GB_set_mbc_ram_dirty_bitmap(GB_gameboy_t *gb, uint64_t *bitmap, size_t word_count);
 GB_registers_t *GB_get_registers(GB_gameboy_t *gb);
 
 void *GB_get_user_data(GB_gameboy_t *gb);
@@ -916,6 +944,18 @@ int GB_load_boot_rom(GB_gameboy_t *gb, const char *path);
 void GB_load_boot_rom_from_buffer(GB_gameboy_t *gb, const unsigned char *buffer, size_t size);
 int GB_load_rom(GB_gameboy_t *gb, const char *path);
 void GB_load_rom_from_buffer(GB_gameboy_t *gb, const uint8_t *buffer, size_t size);
+/* The size a ROM of the given size is padded to (with 0xFF) when loaded. */
+size_t GB_get_padded_rom_size(size_t size);
+/* Loads a ROM that is already padded to GB_get_padded_rom_size, without copying it. The buffer is
+   shared read-only and must outlive its use by gb. The core makes a private copy before anything
+   modifies the ROM, see GB_unshare_rom. Returns false if the size isn't a padded size. */
+bool GB_load_rom_shared(GB_gameboy_t *gb, const uint8_t *buffer, size_t size);
+/* Like GB_load_rom_shared, but only replaces the ROM contents. The cartridge isn't reconfigured,
+   so the new ROM must be the same size and type. */
+bool GB_replace_rom_shared(GB_gameboy_t *gb, const uint8_t *buffer, size_t size);
+/* Gives gb its own copy of a shared ROM, so it can be written through GB_get_direct_access. Does
+   nothing if the ROM isn't shared. */
+void GB_unshare_rom(GB_gameboy_t *gb);
 int GB_load_isx(GB_gameboy_t *gb, const char *path);
 int GB_load_gbs_from_buffer(GB_gameboy_t *gb, const uint8_t *buffer, size_t size, GB_gbs_info_t *info);
 int GB_load_gbs(GB_gameboy_t *gb, const char *path, GB_gbs_info_t *info);
@@ -936,12 +976,27 @@ void GB_attributed_log(GB_gameboy_t *gb, GB_log_attributes attributes, const cha
 
 void GB_set_pixels_output(GB_gameboy_t *gb, uint32_t *output);
 uint32_t *GB_get_pixels_output(GB_gameboy_t *gb);
+
+#define GB_INDEXED_OBJECT_BASE 0x20
+#define GB_INDEXED_BLACK 0x40
+#define GB_INDEXED_WHITE 0x41
+#define GB_INDEXED_PALETTE_SIZE 0x42
+/* Renders one palette index per pixel in to output instead of RGB. Indices below GB_INDEXED_OBJECT_BASE
+   are background palette entries, the next 0x20 are object palette entries, and GB_INDEXED_BLACK and
+   GB_INDEXED_WHITE are fixed colors. Borders and SGB rendering are not supported. Pass NULL to go back
+   to RGB output. line_callback (optional) is called before the first pixel of each line is written, which
+   is the point to capture the colors the line's indices refer to. */
+void GB_set_pixels_output_indexed(GB_gameboy_t *gb, uint8_t *output, GB_lcd_line_callback_t line_callback);
+/* Writes the GB_INDEXED_PALETTE_SIZE colors the indices currently refer to in to palette */
+void GB_get_indexed_palette(GB_gameboy_t *gb, uint32_t *palette);
 void GB_set_border_mode(GB_gameboy_t *gb, GB_border_mode_t border_mode);
     
 void GB_set_infrared_input(GB_gameboy_t *gb, bool state);
     
 void GB_set_vblank_callback(GB_gameboy_t *gb, GB_vblank_callback_t callback);
 void GB_set_log_callback(GB_gameboy_t *gb, GB_log_callback_t callback);
+/* Drops log output before it's formatted, for frontends that aren't showing it */
+void GB_set_log_disabled(GB_gameboy_t *gb, bool disabled);
 void GB_set_input_callback(GB_gameboy_t *gb, GB_input_callback_t callback);
 void GB_set_async_input_callback(GB_gameboy_t *gb, GB_input_callback_t callback);
 void GB_set_rgb_encode_callback(GB_gameboy_t *gb, GB_rgb_encode_callback_t callback);
@@ -159,6 +159,8 @@ void GB_configure_cart(GB_gameboy_t *gb)
     memset(GB_GET_SECTION(gb, mbc), 0, GB_SECTION_SIZE(mbc));
     gb->cartridge_type = &GB_cart_defs[gb->rom[0x147]];
     if (gb->cartridge_type->mbc_type == GB_MMM01) {
+        /* The banks are rearranged in place */
+        GB_unshare_rom(gb);
         uint8_t *temp = malloc(0x8000);
         memcpy(temp, gb->rom, 0x8000);
         memmove(gb->rom, gb->rom + 0x8000, gb->rom_size - 0x8000);
@@ -1177,10 +1177,24 @@ static void write_mbc7_ram(GB_gameboy_t *gb, uint16_t addr, uint8_t value)
     }
 }
 
+static inline void mark_mbc_ram_dirty(GB_gameboy_t *gb, uint32_t offset)
+{
+    if (gb->mbc_ram_dirty) {
+        uint32_t page = offset >> GB_MBC_RAM_PAGE_SHIFT;
+        if ((page >> 6) < gb->mbc_ram_dirty_words) {
+            gb->mbc_ram_dirty[page >> 6] |= 1ULL << (page & 63);
+        }
+    }
+}
+
 static void write_mbc_ram(GB_gameboy_t *gb, uint16_t addr, uint8_t value)
 {
     if (gb->cartridge_type->mbc_type == GB_MBC7) {
         write_mbc7_ram(gb, addr, value);
+        /* The EEPROM is tiny and written through a serial protocol, so treat it as a whole */
+        for (uint32_t offset = 0; offset < gb->mbc_ram_size; offset += 1 << GB_MBC_RAM_PAGE_SHIFT) {
+            mark_mbc_ram_dirty(gb, offset);
+        }
         return;
     }
     
@@ -1245,7 +1259,9 @@ static void write_mbc_ram(GB_gameboy_t *gb, uint16_t addr, uint8_t value)
         effective_bank &= 0x3;
     }
 
-    gb->mbc_ram[((addr & 0x1FFF) + effective_bank * 0x2000) & (gb->mbc_ram_size - 1)] = value;
+    uint32_t offset = ((addr & 0x1FFF) + effective_bank * 0x2000) & (gb->mbc_ram_size - 1);
+    gb->mbc_ram[offset] = value;
+    mark_mbc_ram_dirty(gb, offset);
 }
 
 static void write_ram(GB_gameboy_t *gb, uint16_t addr, uint8_t value)
@@ -1340,6 +1340,87 @@ static int load_state_internal(GB_gameboy_t *gb, virtual_file_t *file)
     return 0;
 }
 
+bool GB_copy_state(GB_gameboy_t *gb, const GB_gameboy_t *source)
+{
+    if (gb->model != source->model ||
+        gb->rom_size != source->rom_size ||
+        gb->ram_size != source->ram_size ||
+        gb->vram_size != source->vram_size ||
+        gb->mbc_ram_size != source->mbc_ram_size ||
+        !gb->sgb != !source->sgb) {
+        return false;
+    }
+    
+    /* Unlike a save state, the unsaved timing state is copied too, so both instances carry on
+       identically. Pointers, callbacks, the debugger, rewind, cheats and the frontend's run
+       settings belong to gb and are kept. */
+    uint8_t *rom = gb->rom;
+    bool rom_is_shared = gb->rom_is_shared;
+    uint8_t *ram = gb->ram;
+    uint8_t *vram = gb->vram;
+    uint8_t *mbc_ram = gb->mbc_ram;
+    uint64_t *mbc_ram_dirty = gb->mbc_ram_dirty;
+    size_t mbc_ram_dirty_words = gb->mbc_ram_dirty_words;
+    uint32_t *screen = gb->screen;
+    uint8_t *indexed_screen = gb->indexed_screen;
+    const GB_palette_t *dmg_palette = gb->dmg_palette;
+    FILE *output_file = gb->apu_output.output_file;
+    GB_sample_callback_t sample_callback = gb->apu_output.sample_callback;
+    GB_sgb_t *sgb = gb->sgb;
+    bool turbo = gb->turbo;
+    bool turbo_dont_skip = gb->turbo_dont_skip;
+    bool disable_rendering = gb->disable_rendering;
+    bool fast_interpreter_disabled = gb->fast_interpreter_disabled;
+    double clock_multiplier = gb->clock_multiplier;
+    GB_rumble_mode_t rumble_mode = gb->rumble_mode;
+    
+#define COPY_FIELDS(first, end) memcpy((uint8_t *)gb + (first), (const uint8_t *)source + (first), (end) - (first))
+    COPY_FIELDS(0, offsetof(GB_gameboy_t, user_data));
+    COPY_FIELDS(offsetof(GB_gameboy_t, sgb_intro_jingle_phases), offsetof(GB_gameboy_t, cheat_count));
+    COPY_FIELDS(offsetof(GB_gameboy_t, turbo), sizeof(GB_gameboy_t));
+#undef COPY_FIELDS
+    
+    gb->rom = rom;
+    gb->rom_is_shared = rom_is_shared;
+    gb->ram = ram;
+    gb->vram = vram;
+    gb->mbc_ram = mbc_ram;
+    gb->mbc_ram_dirty = mbc_ram_dirty;
+    gb->mbc_ram_dirty_words = mbc_ram_dirty_words;
+    gb->screen = screen;
+    gb->indexed_screen = indexed_screen;
+    gb->dmg_palette = dmg_palette;
+    gb->apu_output.output_file = output_file;
+    gb->apu_output.sample_callback = sample_callback;
+    gb->sgb = sgb;
+    gb->turbo = turbo;
+    gb->turbo_dont_skip = turbo_dont_skip;
+    gb->disable_rendering = disable_rendering;
+    gb->fast_interpreter_disabled = fast_interpreter_disabled;
+    gb->clock_multiplier = clock_multiplier;
+    gb->rumble_mode = rumble_mode;
+    
+    if (gb->sgb) {
+        memcpy(gb->sgb, source->sgb, sizeof(*gb->sgb));
+    }
+    
+    memcpy(gb->mbc_ram, source->mbc_ram, gb->mbc_ram_size);
+    memcpy(gb->ram, source->ram, gb->ram_size);
+    memcpy(gb->vram, source->vram, gb->vram_size);
+    
+    /* Any of the cart RAM may have changed, so every page is reported as written */
+    if (gb->mbc_ram_dirty) {
+        size_t pages = (gb->mbc_ram_size + (1 << GB_MBC_RAM_PAGE_SHIFT) - 1) >> GB_MBC_RAM_PAGE_SHIFT;
+        for (size_t i = 0; i < pages && (i >> 6) < gb->mbc_ram_dirty_words; i++) {
+            gb->mbc_ram_dirty[i >> 6] |= 1ULL << (i & 63);
+        }
+    }
+    
+    sanitize_state(gb);
+    
+    return true;
+}
+
 int GB_load_state(GB_gameboy_t *gb, const char *path)
 {
     FILE *f = fopen(path, "rb");
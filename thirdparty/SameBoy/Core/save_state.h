@@ -33,6 +33,10 @@ void GB_save_state_to_buffer(GB_gameboy_t *gb, uint8_t *buffer);
 int GB_load_state(GB_gameboy_t *gb, const char *path);
 int GB_load_state_from_buffer(GB_gameboy_t *gb, const uint8_t *buffer, size_t length);
 bool GB_is_save_state(const char *path);
+/* Makes gb an exact copy of source's emulation state, without serializing it or allocating. Both
+   instances must be the same model with the same ROM loaded. Returns false, leaving gb untouched,
+   if their memory layouts differ. */
+bool GB_copy_state(GB_gameboy_t *gb, const GB_gameboy_t *source);
 #ifdef GB_INTERNAL
 static inline uint32_t state_magic(void)
 {
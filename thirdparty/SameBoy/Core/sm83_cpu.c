@@ -1569,7 +1569,7 @@ static void cb_prefix(GB_gameboy_t *gb, uint8_t opcode)
     }
 }
 
-static opcode_t *opcodes[256] = {
+static opcode_t *const opcodes[256] = {
 /*  X0          X1          X2          X3          X4          X5          X6          X7                */
 /*  X8          X9          Xa          Xb          Xc          Xd          Xe          Xf                */
     nop,        ld_rr_d16,  ld_drr_a,   inc_rr,     inc_hr,     dec_hr,     ld_hr_d8,   rlca,       /* 0X */
@@ -1719,3 +1719,79 @@ void GB_cpu_run(GB_gameboy_t *gb)
     
     flush_pending_cycles(gb);
 }
+
+#ifdef GB_FAST_INTERPRETER
+/* Everything GB_cpu_run does before fetching an opcode is a no-op when this is true */
+static inline bool can_run_fast(GB_gameboy_t *gb)
+{
+    if (unlikely(gb->stopped || gb->halted || gb->ime_toggle || gb->debug_stopped || gb->execution_callback)) {
+        return false;
+    }
+    /* Pending interrupts, or the joypad interrupt's timing sync */
+    if (gb->ime && (gb->interrupt_enable & (gb->io_registers[GB_IO_IF] | 0x10) & 0x1F)) {
+        return false;
+    }
+    return true;
+}
+
+/* Each opcode gets its own label and its own copy of the fetch and indirect jump, so the branch
+   predictor sees which opcode tends to follow which, rather than one shared jump for them all. */
+#define FAST_FETCH() do { \
+    if (unlikely(!can_run_fast(gb))) return; \
+    gb->just_halted = false; \
+    opcode = gb->hdma_open_bus = cycle_read(gb, gb->pc++); \
+    if (unlikely(gb->hdma_on)) { \
+        GB_hdma_run(gb); \
+    } \
+    if (unlikely(gb->halt_bug)) { \
+        gb->pc--; \
+        gb->halt_bug = false; \
+    } \
+    goto *dispatch[opcode]; \
+} while (0)
+
+/* What GB_cpu_run and GB_run do after every instruction */
+#define FAST_NEXT() do { \
+    flush_pending_cycles(gb); \
+    if (!(gb->io_registers[GB_IO_IF] & 0x10) && (gb->io_registers[GB_IO_JOYP] & 0x30) != 0x30) { \
+        gb->joyp_accessed = true; \
+    } \
+    if (gb->vblank_just_occured || gb->run_stop_requested || gb->cycles_since_run >= cycles) return; \
+    FAST_FETCH(); \
+} while (0)
+
+#define FAST_OP(x) op_##x: opcodes[0x##x](gb, 0x##x); FAST_NEXT();
+#define FAST_OP_ROW(h) \
+    FAST_OP(h##0) FAST_OP(h##1) FAST_OP(h##2) FAST_OP(h##3) FAST_OP(h##4) FAST_OP(h##5) FAST_OP(h##6) FAST_OP(h##7) \
+    FAST_OP(h##8) FAST_OP(h##9) FAST_OP(h##A) FAST_OP(h##B) FAST_OP(h##C) FAST_OP(h##D) FAST_OP(h##E) FAST_OP(h##F)
+
+#define FAST_LABEL_ROW(h) \
+    &&op_##h##0, &&op_##h##1, &&op_##h##2, &&op_##h##3, &&op_##h##4, &&op_##h##5, &&op_##h##6, &&op_##h##7, \
+    &&op_##h##8, &&op_##h##9, &&op_##h##A, &&op_##h##B, &&op_##h##C, &&op_##h##D, &&op_##h##E, &&op_##h##F,
+
+void GB_cpu_run_fast(GB_gameboy_t *gb, unsigned cycles)
+{
+    static const void *const dispatch[256] = {
+        FAST_LABEL_ROW(0) FAST_LABEL_ROW(1) FAST_LABEL_ROW(2) FAST_LABEL_ROW(3)
+        FAST_LABEL_ROW(4) FAST_LABEL_ROW(5) FAST_LABEL_ROW(6) FAST_LABEL_ROW(7)
+        FAST_LABEL_ROW(8) FAST_LABEL_ROW(9) FAST_LABEL_ROW(A) FAST_LABEL_ROW(B)
+        FAST_LABEL_ROW(C) FAST_LABEL_ROW(D) FAST_LABEL_ROW(E) FAST_LABEL_ROW(F)
+    };
+    uint8_t opcode;
+
+    /* GB_cpu_run leaves nothing pending between instructions */
+    assert(!gb->pending_cycles);
+    FAST_FETCH();
+
+    FAST_OP_ROW(0) FAST_OP_ROW(1) FAST_OP_ROW(2) FAST_OP_ROW(3)
+    FAST_OP_ROW(4) FAST_OP_ROW(5) FAST_OP_ROW(6) FAST_OP_ROW(7)
+    FAST_OP_ROW(8) FAST_OP_ROW(9) FAST_OP_ROW(A) FAST_OP_ROW(B)
+    FAST_OP_ROW(C) FAST_OP_ROW(D) FAST_OP_ROW(E) FAST_OP_ROW(F)
+}
+
+#undef FAST_FETCH
+#undef FAST_NEXT
+#undef FAST_OP
+#undef FAST_OP_ROW
+#undef FAST_LABEL_ROW
+#endif
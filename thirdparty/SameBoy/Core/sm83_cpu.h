@@ -6,6 +6,12 @@
 void GB_cpu_disassemble(GB_gameboy_t *gb, uint16_t pc, uint16_t count);
 #ifdef GB_INTERNAL
 internal void GB_cpu_run(GB_gameboy_t *gb);
+#ifdef GB_FAST_INTERPRETER
+/* Runs instructions back to back until `cycles` 8MHz ticks have passed, a VBlank occurs, a stop
+   is requested or the CPU needs GB_cpu_run (interrupts, HALT, STOP, callbacks, debugging).
+   Adds to cycles_since_run, which is left unchanged if no instruction could be run. */
+internal void GB_cpu_run_fast(GB_gameboy_t *gb, unsigned cycles);
+#endif
 #endif
 
 #endif /* sm83_cpu_h */
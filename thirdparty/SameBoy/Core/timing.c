@@ -199,6 +199,24 @@ void GB_serial_master_edge(GB_gameboy_t *gb)
 }
 
 
+uint64_t GB_get_ticks_until_serial_bit(GB_gameboy_t *gb)
+{
+    if (gb->stopped || (gb->io_registers[GB_IO_SC] & 0x81) != 0x81) {
+        return UINT64_MAX;
+    }
+    
+    /* The master clock toggles every time the mask bit of DIV falls, and a bit is shifted when
+       it goes low */
+    unsigned period = gb->serial_mask * 2;
+    unsigned cycles = period - (gb->div_counter & (period - 1));
+    if (!gb->serial_master_clock) {
+        cycles += period;
+    }
+    
+    /* DIV counts at the CPU's speed */
+    return (uint64_t)cycles << !gb->cgb_double_speed;
+}
+
 void GB_set_internal_div_counter(GB_gameboy_t *gb, uint16_t value)
 {
     /* TIMA increases when a specific high-bit becomes a low-bit. */